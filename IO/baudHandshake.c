@@ -0,0 +1,190 @@
+// *******************************************************
+//
+//  baudHandshake.c
+//
+//  The board's side of the Uart baud rate handshake, kept apart from the hardware so it can be run on the host by
+//  tools/baudTest.c. uart.c feeds it the BAUD commands and does the rate changes it asks for.
+//
+//      host "BAUD?"       board "BAUD? <rate> <rate> ..."   the rates the board's clock can make, fastest first
+//      host "BAUD <rate>" board "BAUD OK <rate>"            both ends switch once this has gone out
+//      host "BAUD SYNC"   board "BAUD SYNC"                 sent at the new rate, confirms the link
+//  If the confirmation doesn't arrive within UART_BAUD_SYNC_TIMEOUT_MS the board goes back to BAUD_RATE. A rate it
+//  doesn't offer or a sync it isn't waiting for gets "BAUD REFUSED".
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "baudHandshake.h"
+
+static const uint32_t baudRates[] = {2500000, 2000000, 1250000, 1000000, 921600, 460800, 230400, 115200, 57600,
+                                     38400, 19200}; // the rates offered in the handshake, where the clock can make them
+
+/** Checks whether the system clock can make a baud rate closely enough. Past 1/16 of the clock the UART runs at
+8 times oversampling instead of 16, UARTConfigSetExpClk() switches over by itself
+@param clock the system clock in Hz
+@param rate the baud rate
+@return true if the rate is within UART_BAUD_MAX_ERROR_PERMILLE of the rate the divisor gives */
+static bool
+isBaudRateAvailable (uint32_t clock, uint32_t rate)
+{
+    uint32_t oversample = (rate * 16 > clock) ? 8 : 16;
+    uint32_t divisor; // in 64ths, the fractional divisor resolution
+    uint32_t actual;
+    uint32_t error;
+
+    if (rate * 8 > clock) {
+        return false;
+    }
+
+    divisor = (uint32_t)(((uint64_t)clock * 64 / oversample + rate / 2) / rate);
+    actual = (uint32_t)((uint64_t)clock * 64 / oversample / divisor);
+    error = (actual > rate) ? actual - rate : rate - actual;
+    return (uint64_t)error * 1000 <= (uint64_t)rate * UART_BAUD_MAX_ERROR_PERMILLE;
+}
+
+/** Appends text to a reply, cutting it short if the reply is full
+@param reply the reply
+@param size the size of reply
+@param length the length of the reply so far
+@param text the text to add
+@return the new length */
+static uint16_t
+appendText (char* reply, uint16_t size, uint16_t length, const char* text)
+{
+    while (*text != '\0' && length + 1 < size) {
+        reply[length++] = *text++;
+    }
+    reply[length] = '\0';
+    return length;
+}
+
+/** Appends a number to a reply, cutting it short if the reply is full
+@param reply the reply
+@param size the size of reply
+@param length the length of the reply so far
+@param number the number to add
+@return the new length */
+static uint16_t
+appendNumber (char* reply, uint16_t size, uint16_t length, uint32_t number)
+{
+    char digits[11];
+    uint8_t count = sizeof(digits) - 1;
+
+    digits[count] = '\0';
+    do {
+        digits[--count] = '0' + number % 10;
+        number /= 10;
+    } while (number > 0);
+    return appendText(reply, size, length, &digits[count]);
+}
+
+/** Initialises the handshake at BAUD_RATE
+@param handshake the handshake
+@param clock the system clock in Hz */
+void
+baudHandshakeInit (baudHandshake_t* handshake, uint32_t clock)
+{
+    handshake->clock = clock;
+    handshake->rate = BAUD_RATE;
+    handshake->pendingRate = BAUD_RATE;
+    handshake->state = UART_BAUD_FIXED;
+    handshake->elapsedMs = 0;
+}
+
+/** Writes the reply to "BAUD?", every rate the clock can make fastest first
+@param handshake the handshake
+@param reply where to write the reply line
+@param size the size of reply, UART_BAUD_OFFER_LENGTH fits every rate */
+void
+baudHandshakeOffer (const baudHandshake_t* handshake, char* reply, uint16_t size)
+{
+    uint16_t length;
+    uint8_t i;
+
+    length = appendText(reply, size, 0, "BAUD?");
+    for (i = 0; i < sizeof(baudRates) / sizeof(baudRates[0]); i++) {
+        if (isBaudRateAvailable(handshake->clock, baudRates[i])) {
+            length = appendText(reply, size, length, " ");
+            length = appendNumber(reply, size, length, baudRates[i]);
+        }
+    }
+    appendText(reply, size, length, "\r\n");
+}
+
+/** Takes the rate the host picked from the offer. The switch waits for the reply to go out, see baudHandshakeTick()
+@param handshake the handshake
+@param rate the baud rate
+@param reply where to write the reply line, "BAUD OK <rate>" or "BAUD REFUSED"
+@param size the size of reply
+@return false if the rate isn't one the board offers */
+bool
+baudHandshakeAccept (baudHandshake_t* handshake, uint32_t rate, char* reply, uint16_t size)
+{
+    uint16_t length;
+    uint8_t i;
+
+    for (i = 0; i < sizeof(baudRates) / sizeof(baudRates[0]); i++) {
+        if (baudRates[i] == rate && isBaudRateAvailable(handshake->clock, rate)) {
+            length = appendText(reply, size, 0, "BAUD OK ");
+            length = appendNumber(reply, size, length, rate);
+            appendText(reply, size, length, "\r\n");
+            handshake->pendingRate = rate;
+            handshake->state = UART_BAUD_SWITCHING;
+            return true;
+        }
+    }
+
+    appendText(reply, size, 0, "BAUD REFUSED\r\n");
+    return false;
+}
+
+/** Takes the host's sync at the new rate. A sync is only answered in kind while a new rate is waiting for it, anything
+else is refused so a stray sync can't confirm a rate that was never switched to
+@param handshake the handshake
+@param reply where to write the reply line, "BAUD SYNC" or "BAUD REFUSED"
+@param size the size of reply
+@return false if no new rate was waiting to be confirmed */
+bool
+baudHandshakeSync (baudHandshake_t* handshake, char* reply, uint16_t size)
+{
+    if (handshake->state != UART_BAUD_VERIFYING) {
+        appendText(reply, size, 0, "BAUD REFUSED\r\n");
+        return false;
+    }
+
+    handshake->state = UART_BAUD_FIXED;
+    appendText(reply, size, 0, "BAUD SYNC\r\n");
+    return true;
+}
+
+/** Runs the rate switch. The switch happens once the reply has gone out, and the rate falls back to BAUD_RATE if the
+host doesn't confirm it within UART_BAUD_SYNC_TIMEOUT_MS
+@param handshake the handshake
+@param txIdle true once everything queued to send has gone out
+@param dtMs the time since the last call in milliseconds
+@return the rate to set the link to, 0 to leave it as it is */
+uint32_t
+baudHandshakeTick (baudHandshake_t* handshake, bool txIdle, uint32_t dtMs)
+{
+    if (handshake->state == UART_BAUD_SWITCHING) {
+        if (txIdle) {
+            handshake->rate = handshake->pendingRate;
+            handshake->elapsedMs = 0;
+            handshake->state = UART_BAUD_VERIFYING;
+            return handshake->rate;
+        }
+    } else if (handshake->state == UART_BAUD_VERIFYING) {
+        handshake->elapsedMs += dtMs;
+        if (handshake->elapsedMs >= UART_BAUD_SYNC_TIMEOUT_MS) {
+            handshake->rate = BAUD_RATE;
+            handshake->state = UART_BAUD_FIXED;
+            return handshake->rate;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+// *******************************************************
+//
+//  baudHandshake.h
+//
+//  The board's side of the Uart baud rate handshake, kept apart from the hardware so it can be run on the host by
+//  tools/baudTest.c. uart.c feeds it the BAUD commands and does the rate changes it asks for.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef IO_BAUDHANDSHAKE_H_
+#define IO_BAUDHANDSHAKE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "uart.h"
+
+typedef struct {
+    uint32_t clock; // the system clock the UART divides down, decides which rates can be made
+    uint32_t rate; // the rate the link is running at
+    uint32_t pendingRate; // the rate being switched to
+    uint8_t state; // the handshake progress from uartBaudStates
+    uint32_t elapsedMs; // the time spent waiting for the host to confirm the new rate
+} baudHandshake_t; // the rate handshake
+
+
+/** Initialises the handshake at BAUD_RATE
+@param handshake the handshake
+@param clock the system clock in Hz */
+void
+baudHandshakeInit (baudHandshake_t* handshake, uint32_t clock);
+
+/** Writes the reply to "BAUD?", every rate the clock can make fastest first
+@param handshake the handshake
+@param reply where to write the reply line
+@param size the size of reply, UART_BAUD_OFFER_LENGTH fits every rate */
+void
+baudHandshakeOffer (const baudHandshake_t* handshake, char* reply, uint16_t size);
+
+/** Takes the rate the host picked from the offer. The switch waits for the reply to go out, see baudHandshakeTick()
+@param handshake the handshake
+@param rate the baud rate
+@param reply where to write the reply line, "BAUD OK <rate>" or "BAUD REFUSED"
+@param size the size of reply
+@return false if the rate isn't one the board offers */
+bool
+baudHandshakeAccept (baudHandshake_t* handshake, uint32_t rate, char* reply, uint16_t size);
+
+/** Takes the host's sync at the new rate. A sync is only answered in kind while a new rate is waiting for it, anything
+else is refused so a stray sync can't confirm a rate that was never switched to
+@param handshake the handshake
+@param reply where to write the reply line, "BAUD SYNC" or "BAUD REFUSED"
+@param size the size of reply
+@return false if no new rate was waiting to be confirmed */
+bool
+baudHandshakeSync (baudHandshake_t* handshake, char* reply, uint16_t size);
+
+/** Runs the rate switch. The switch happens once the reply has gone out, and the rate falls back to BAUD_RATE if the
+host doesn't confirm it within UART_BAUD_SYNC_TIMEOUT_MS
+@param handshake the handshake
+@param txIdle true once everything queued to send has gone out
+@param dtMs the time since the last call in milliseconds
+@return the rate to set the link to, 0 to leave it as it is */
+uint32_t
+baudHandshakeTick (baudHandshake_t* handshake, bool txIdle, uint32_t dtMs);
+
+#endif /* IO_BAUDHANDSHAKE_H_ */
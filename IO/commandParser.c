@@ -0,0 +1,232 @@
+// *******************************************************
+//
+//  commandParser.c
+//
+//  Parses the command lines sent over the Uart one char at a time as they arrive. Nothing is allocated and the line
+//  itself is never stored, only the command word, an optional second word and the numbers after them.
+//
+//  A line is a command word, then optionally a second word, then numbers, e.g. "GAIN ALT 15 40 0". Once the line
+//  ends the words and the amount of numbers are looked up in the command table. Anything that doesn't fit, an
+//  unknown char, a word or number too long, too many numbers, throws the rest of the line away as an error.
+//
+//  Author: Dan Ronen, Jackson Allred, Pieter Leigh
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "commandParser.h"
+
+//********************************************************
+// Constants
+//********************************************************
+enum parserStates {PARSE_START = 0, PARSE_WORD, PARSE_SPACE, PARSE_SUB_WORD, PARSE_NUMBER, PARSE_DISCARD};
+
+typedef struct {
+    const char* word; // the command word
+    const char* subWord; // the second word, empty for none
+    uint8_t args; // the amount of numbers after the words
+    uint8_t type; // the command from commandTypes
+} commandSpec_t; // a line the parser accepts
+
+static const commandSpec_t commandSpecs[] = {
+    {"ALT", "", 1, COMMAND_ALT},
+    {"YAW", "", 1, COMMAND_YAW},
+    {"GAIN", "ALT", 3, COMMAND_GAIN_ALT},
+    {"GAIN", "YAW", 3, COMMAND_GAIN_YAW},
+    {"TELEMETRY", "", 1, COMMAND_TELEMETRY_RATE},
+    {"TELEMETRY", "BINARY", 0, COMMAND_TELEMETRY_BINARY},
+    {"TELEMETRY", "TEXT", 0, COMMAND_TELEMETRY_TEXT},
+    {"MODE", "FLY", 0, COMMAND_MODE_FLY},
+    {"MODE", "LAND", 0, COMMAND_MODE_LAND},
+    {"MODE", "SWITCH", 0, COMMAND_MODE_SWITCH},
+    {"PWM", "", 1, COMMAND_PWM},
+    {"SWEEP", "", 0, COMMAND_SWEEP},
+    {"BAUD?", "", 0, COMMAND_BAUD_OFFER},
+    {"BAUD", "", 1, COMMAND_BAUD},
+    {"BAUD", "SYNC", 0, COMMAND_BAUD_SYNC},
+    {"RECORD", "", 0, COMMAND_RECORD_TRIGGER},
+    {"RECORD", "DUMP", 0, COMMAND_RECORD_DUMP},
+    {"RECORD", "ARM", 0, COMMAND_RECORD_ARM},
+}; // every command line the parser accepts
+
+//********************************************************
+// Functions
+//********************************************************
+
+/** Compares two words
+@param a the first word
+@param b the second word
+@return true if they are the same */
+static bool
+wordsMatch (const char* a, const char* b)
+{
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/** Checks whether a char can be part of a word
+@param c the char, already upper case
+@return true if it is a letter or the question mark of BAUD? */
+static bool
+isWordChar (char c)
+{
+    return (c >= 'A' && c <= 'Z') || c == '?';
+}
+
+/** Adds a char to the word being parsed
+@param parser the parser
+@param word the word
+@param c the char
+@return the state to parse the next char in */
+static uint8_t
+addWordChar (commandParser_t* parser, char* word, char c)
+{
+    if (parser->wordLength >= COMMAND_WORD_LENGTH) {
+        return PARSE_DISCARD;
+    }
+    word[parser->wordLength++] = c;
+    word[parser->wordLength] = '\0';
+    return parser->state;
+}
+
+/** Finishes the number being parsed
+@param parser the parser
+@return false if there are already too many numbers */
+static bool
+finishNumber (commandParser_t* parser)
+{
+    if (parser->argCount >= COMMAND_MAX_ARGS) {
+        return false;
+    }
+    parser->args[parser->argCount++] = parser->negative ? -parser->number : parser->number;
+    return true;
+}
+
+/** Looks the finished line up in the command table
+@param parser the parser
+@param command the struct to write the command into
+@return COMMAND_PARSE_DONE if the line is a command, otherwise COMMAND_PARSE_ERROR */
+static uint8_t
+finishLine (commandParser_t* parser, command_t* command)
+{
+    uint8_t i;
+    uint8_t arg;
+
+    if (parser->state == PARSE_NUMBER && (parser->digits == 0 || !finishNumber(parser))) {
+        return COMMAND_PARSE_ERROR;
+    }
+
+    for (i = 0; i < sizeof(commandSpecs) / sizeof(commandSpecs[0]); i++) {
+        if (wordsMatch(commandSpecs[i].word, parser->word) && wordsMatch(commandSpecs[i].subWord, parser->subWord)
+                && commandSpecs[i].args == parser->argCount) {
+            command->type = commandSpecs[i].type;
+            for (arg = 0; arg < COMMAND_MAX_ARGS; arg++) {
+                command->args[arg] = (arg < parser->argCount) ? parser->args[arg] : 0;
+            }
+            return COMMAND_PARSE_DONE;
+        }
+    }
+    return COMMAND_PARSE_ERROR;
+}
+
+/** Initialises a parser at the start of a line
+@param parser the parser */
+void
+initCommandParser (commandParser_t* parser)
+{
+    parser->state = PARSE_START;
+    parser->word[0] = '\0';
+    parser->subWord[0] = '\0';
+    parser->wordLength = 0;
+    parser->argCount = 0;
+}
+
+/** Parses the next char of a command line. Lines end at a carriage return or line feed, words are case insensitive
+and separated by spaces
+@param parser the parser
+@param c the char
+@param command the struct to write the command into once a line is finished
+@return COMMAND_PARSE_DONE if the char finished a good command, COMMAND_PARSE_ERROR if it finished a line that isn't
+one, otherwise COMMAND_PARSE_PENDING */
+uint8_t
+commandParserFeed (commandParser_t* parser, char c, command_t* command)
+{
+    uint8_t result;
+
+    if (c == '\r' || c == '\n') {
+        if (parser->state == PARSE_START) {
+            return COMMAND_PARSE_PENDING; // the other half of a \r\n, or an empty line
+        }
+        result = (parser->state == PARSE_DISCARD) ? COMMAND_PARSE_ERROR : finishLine(parser, command);
+        initCommandParser(parser);
+        return result;
+    }
+
+    if (c >= 'a' && c <= 'z') {
+        c -= 'a' - 'A';
+    }
+
+    switch (parser->state) {
+        case PARSE_START:
+            if (c == ' ') {
+                break;
+            }
+            if (isWordChar(c)) {
+                parser->state = PARSE_WORD;
+                parser->state = addWordChar(parser, parser->word, c);
+            } else {
+                parser->state = PARSE_DISCARD;
+            }
+            break;
+        case PARSE_WORD:
+        case PARSE_SUB_WORD:
+            if (c == ' ') {
+                parser->state = PARSE_SPACE;
+            } else if (isWordChar(c)) {
+                parser->state = addWordChar(parser, (parser->state == PARSE_WORD) ? parser->word : parser->subWord, c);
+            } else {
+                parser->state = PARSE_DISCARD;
+            }
+            break;
+        case PARSE_SPACE:
+            if (c == ' ') {
+                break;
+            }
+            if (isWordChar(c) && parser->subWord[0] == '\0' && parser->argCount == 0) {
+                parser->wordLength = 0;
+                parser->state = PARSE_SUB_WORD;
+                parser->state = addWordChar(parser, parser->subWord, c);
+            } else if ((c >= '0' && c <= '9') || c == '-') {
+                parser->number = 0;
+                parser->digits = 0;
+                parser->negative = (c == '-');
+                parser->state = PARSE_NUMBER;
+                if (c != '-') {
+                    parser->number = c - '0';
+                    parser->digits = 1;
+                }
+            } else {
+                parser->state = PARSE_DISCARD;
+            }
+            break;
+        case PARSE_NUMBER:
+            if (c == ' ') {
+                parser->state = (parser->digits > 0 && finishNumber(parser)) ? PARSE_SPACE : PARSE_DISCARD;
+            } else if (c >= '0' && c <= '9' && parser->digits < COMMAND_MAX_DIGITS) {
+                parser->number = parser->number * 10 + (c - '0');
+                parser->digits++;
+            } else {
+                parser->state = PARSE_DISCARD;
+            }
+            break;
+        case PARSE_DISCARD:
+            break;
+    }
+    return COMMAND_PARSE_PENDING;
+}
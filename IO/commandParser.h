@@ -0,0 +1,86 @@
+// *******************************************************
+//
+//  commandParser.h
+//
+//  Parses the command lines sent over the Uart one char at a time as they arrive. Nothing is allocated and the line
+//  itself is never stored, only the command word, an optional second word and the numbers after them.
+//
+//  Author: Dan Ronen, Jackson Allred, Pieter Leigh
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef IO_COMMANDPARSER_H_
+#define IO_COMMANDPARSER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//********************************************************
+// Constants
+//********************************************************
+#define COMMAND_WORD_LENGTH 10 // the longest word, TELEMETRY
+#define COMMAND_MAX_ARGS 3 // the most numbers a command takes
+#define COMMAND_MAX_DIGITS 9 // the most digits in a number, so it can't overflow
+
+enum commandTypes {COMMAND_NONE = 0,
+                   COMMAND_ALT, // ALT <percent>                       the height target
+                   COMMAND_YAW, // YAW <degrees>                       the yaw target
+                   COMMAND_GAIN_ALT, // GAIN ALT <kp> <ki> <kd>        the altitude gains at the current height
+                   COMMAND_GAIN_YAW, // GAIN YAW <kp> <ki> <kd>        the yaw gains at the current height
+                   COMMAND_TELEMETRY_RATE, // TELEMETRY <hz>           the binary status frame rate
+                   COMMAND_TELEMETRY_BINARY, // TELEMETRY BINARY       the status as binary frames
+                   COMMAND_TELEMETRY_TEXT, // TELEMETRY TEXT           the status as text lines
+                   COMMAND_MODE_FLY, // MODE FLY                       take off, in place of the flying switch
+                   COMMAND_MODE_LAND, // MODE LAND                     land, in place of the flying switch
+                   COMMAND_MODE_SWITCH, // MODE SWITCH                 hand the mode back to the flying switch
+                   COMMAND_PWM, // PWM <hz>                            the rotor pwm carrier frequency
+                   COMMAND_SWEEP, // SWEEP                             the carrier frequency noise sweep
+                   COMMAND_BAUD_OFFER, // BAUD?                        the baud rate offer
+                   COMMAND_BAUD, // BAUD <rate>                        switch the baud rate
+                   COMMAND_BAUD_SYNC, // BAUD SYNC                     confirm the new baud rate
+                   COMMAND_RECORD_TRIGGER, // RECORD                   freeze the flight recorder
+                   COMMAND_RECORD_DUMP, // RECORD DUMP                 send the frozen flight recorder
+                   COMMAND_RECORD_ARM}; // RECORD ARM                  empty and restart the flight recorder
+
+enum commandParseResults {COMMAND_PARSE_PENDING = 0, COMMAND_PARSE_DONE, COMMAND_PARSE_ERROR}; // what a char finished
+
+typedef struct {
+    uint8_t type; // the command from commandTypes
+    int32_t args[COMMAND_MAX_ARGS]; // the numbers after the words
+} command_t; // a parsed command
+
+
+typedef struct {
+    uint8_t state; // the part of the line being parsed
+    char word[COMMAND_WORD_LENGTH + 1]; // the command word
+    char subWord[COMMAND_WORD_LENGTH + 1]; // the second word, empty if there isn't one
+    uint8_t wordLength; // the length of the word being parsed
+    int32_t args[COMMAND_MAX_ARGS]; // the numbers parsed so far
+    uint8_t argCount; // the amount of numbers parsed so far
+    int32_t number; // the number being parsed
+    uint8_t digits; // the amount of digits in the number being parsed
+    bool negative; // true if the number being parsed started with a minus
+} commandParser_t; // the progress through a command line
+
+
+//********************************************************
+// Prototypes
+//********************************************************
+
+/** Initialises a parser at the start of a line
+@param parser the parser */
+void
+initCommandParser (commandParser_t* parser);
+
+/** Parses the next char of a command line. Lines end at a carriage return or line feed, words are case insensitive
+and separated by spaces
+@param parser the parser
+@param c the char
+@param command the struct to write the command into once a line is finished
+@return COMMAND_PARSE_DONE if the char finished a good command, COMMAND_PARSE_ERROR if it finished a line that isn't
+one, otherwise COMMAND_PARSE_PENDING */
+uint8_t
+commandParserFeed (commandParser_t* parser, char c, command_t* command);
+
+#endif /* IO_COMMANDPARSER_H_ */
@@ -61,6 +61,13 @@ isFlyingSelected(void) {
     return checkSwitch(ONE);
 }
 
+/** returns a boolean depending on if switch two is toggled or not
+@return bool depending on the state of auto-tune */
+bool
+isAutoTuneSelected(void) {
+    return checkSwitch(TWO);
+}
+
 
 /** Updates the controls by calling the update buttons function  */
 void 
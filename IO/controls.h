@@ -46,6 +46,11 @@ isDownButtonPressed(void);
 bool
 isFlyingSelected(void);
 
+/** returns a boolean depending on if the auto-tune is toggled or not
+@return bool depending on the state of auto-tune */
+bool
+isAutoTuneSelected(void);
+
 /** Updates the controls by calling the update buttons function */
 void
 updateControls(void);
@@ -29,7 +29,7 @@
 
 static uint8_t currentScreen = percentageScreen; // the current sreen displayed
 
-enum states {STARTUP_STATE = 0, LANDED_STATE, CALIBRATION_STATE, FLYING_STATE, LANDING_STATE};// the state machine holding the different state for the helicopter
+enum states {STARTUP_STATE = 0, LANDED_STATE, CALIBRATION_STATE, FLYING_STATE, LANDING_STATE, AUTOTUNE_STATE, THRUST_CALIBRATION_STATE};// the state machine holding the different state for the helicopter
 // *******************************************************
 // Functions
 // *******************************************************
@@ -139,6 +139,12 @@ displayMainScreen(uint8_t flightMode, int16_t targetHeight, int16_t currentHeigh
         case LANDING_STATE:
             usnprintf (string, sizeof(string), "    LANDING     ");
             break;
+        case AUTOTUNE_STATE:
+            usnprintf (string, sizeof(string), "   AUTO-TUNE    ");
+            break;
+        case THRUST_CALIBRATION_STATE:
+            usnprintf (string, sizeof(string), "   THRUST CAL   ");
+            break;
     }
     OLEDStringDraw (string, 0, 0);
 
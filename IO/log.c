@@ -0,0 +1,121 @@
+// *******************************************************
+//
+//  log.c
+//
+//  Tokenised logging. A log call records a format ID from logFormats.h and its raw arguments into a RAM ring, no
+//  formatting happens at the call site so it is cheap enough to log from inside the interrupts. The records are
+//  sent later from the main loop, as binary frames for the host to expand or as text in text telemetry mode.
+//
+//  Any interrupt can log, so a record is written with interrupts off. That is only the few words of the record copy.
+//
+//  Author: Dan Ronen, Jackson Allred, Pieter Leigh
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverlib/interrupt.h"
+#include "utils/ustdlib.h"
+
+#include "log.h"
+#include "../controllers/loopTimer.h"
+
+//********************************************************
+// Global variables
+//********************************************************
+#define LOG_FORMAT_STRING(name, format) format,
+static const char* const logFormatStrings[] = {LOG_FORMATS(LOG_FORMAT_STRING)}; // for text mode only
+
+static logRecord_t logRing[LOG_RING_LENGTH]; // the records waiting to be sent
+static volatile uint16_t logHead = 0; // where the next record is written
+static volatile uint16_t logTail = 0; // where the next record is read, only moved by logRead()
+static volatile uint32_t logDropped = 0; // the amount of records dropped because the ring was full
+
+//********************************************************
+// Functions
+//********************************************************
+
+/** Records a log call into the ring, safe to call from any interrupt. The record is dropped if the ring is full
+@param format the format from logFormatIds
+@param args the arguments
+@param argCount the amount of arguments, at most LOG_MAX_ARGS */
+void
+logWrite (uint16_t format, const int32_t* args, uint8_t argCount)
+{
+    uint32_t timestamp = loopTimerTimestamp();
+    bool wasDisabled;
+    uint16_t next;
+    logRecord_t* record;
+    uint8_t i;
+
+    if (argCount > LOG_MAX_ARGS) {
+        argCount = LOG_MAX_ARGS;
+    }
+
+    wasDisabled = IntMasterDisable();
+
+    next = (logHead + 1) & (LOG_RING_LENGTH - 1);
+    if (next == logTail) {
+        logDropped++;
+    } else {
+        record = &logRing[logHead];
+        record->timestamp = timestamp;
+        record->format = format;
+        record->argCount = argCount;
+        for (i = 0; i < argCount; i++) {
+            record->args[i] = args[i];
+        }
+        logHead = next;
+    }
+
+    if (!wasDisabled) {
+        IntMasterEnable();
+    }
+}
+
+/** Takes the oldest record out of the ring, called from the main loop only
+@param record the struct to write the record into
+@return false if the ring is empty */
+bool
+logRead (logRecord_t* record)
+{
+    if (logTail == logHead) {
+        return false;
+    }
+
+    // The writers never touch the slot at the tail, so it can be copied out with interrupts on
+    *record = logRing[logTail];
+    logTail = (logTail + 1) & (LOG_RING_LENGTH - 1);
+    return true;
+}
+
+/** Expands a record into text with its format string, for text telemetry mode
+@param record the record
+@param buffer where to write the text
+@param size the size of the buffer */
+void
+logFormatText (const logRecord_t* record, char* buffer, uint32_t size)
+{
+    int32_t args[LOG_MAX_ARGS] = {0};
+    uint8_t i;
+
+    if (record->format >= LOG_FORMAT_COUNT) {
+        usnprintf(buffer, size, "LOG     | unknown format %d \r\n", record->format);
+        return;
+    }
+
+    for (i = 0; i < record->argCount; i++) {
+        args[i] = record->args[i];
+    }
+    usnprintf(buffer, size, logFormatStrings[record->format],
+              args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7]);
+}
+
+/** Returns the amount of records dropped so far because the ring was full
+@return the dropped record count */
+uint32_t
+logDroppedRecords (void)
+{
+    return logDropped;
+}
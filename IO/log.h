@@ -0,0 +1,76 @@
+// *******************************************************
+//
+//  log.h
+//
+//  Tokenised logging. A log call records a format ID from logFormats.h and its raw arguments into a RAM ring, no
+//  formatting happens at the call site so it is cheap enough to log from inside the interrupts. The records are
+//  sent later from the main loop, as binary frames for the host to expand or as text in text telemetry mode.
+//
+//  Author: Dan Ronen, Jackson Allred, Pieter Leigh
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef IO_LOG_H_
+#define IO_LOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "logFormats.h"
+
+//********************************************************
+// Constants
+//********************************************************
+#define LOG_MAX_ARGS 8 // the most arguments a format takes
+#define LOG_RING_LENGTH 32 // the records held until the main loop sends them, a power of two
+
+#define LOG_FORMAT_ID(name, format) name,
+enum logFormatIds {LOG_FORMATS(LOG_FORMAT_ID) LOG_FORMAT_COUNT}; // the format IDs, the position in the table
+
+typedef struct {
+    uint32_t timestamp; // the free running loop timer timestamp when the record was written, in system clock cycles. The board logs LOG_CLOCK with the clock rate
+    uint16_t format; // the format from logFormatIds
+    uint8_t argCount; // the amount of arguments
+    int32_t args[LOG_MAX_ARGS]; // the arguments
+} logRecord_t; // one log call
+
+/** Records a log call with its arguments, e.g. LOG(LOG_STATE, oldState, newState) */
+#define LOG(format, ...) do { \
+        const int32_t logArgs[] = {__VA_ARGS__}; \
+        logWrite((format), logArgs, sizeof(logArgs) / sizeof(logArgs[0])); \
+    } while (0)
+
+/** Records a log call with no arguments */
+#define LOG0(format) logWrite((format), 0, 0)
+
+//********************************************************
+// Prototypes
+//********************************************************
+
+/** Records a log call into the ring, safe to call from any interrupt. The record is dropped if the ring is full
+@param format the format from logFormatIds
+@param args the arguments
+@param argCount the amount of arguments, at most LOG_MAX_ARGS */
+void
+logWrite (uint16_t format, const int32_t* args, uint8_t argCount);
+
+/** Takes the oldest record out of the ring, called from the main loop only
+@param record the struct to write the record into
+@return false if the ring is empty */
+bool
+logRead (logRecord_t* record);
+
+/** Expands a record into text with its format string, for text telemetry mode
+@param record the record
+@param buffer where to write the text
+@param size the size of the buffer */
+void
+logFormatText (const logRecord_t* record, char* buffer, uint32_t size);
+
+/** Returns the amount of records dropped so far because the ring was full
+@return the dropped record count */
+uint32_t
+logDroppedRecords (void);
+
+#endif /* IO_LOG_H_ */
@@ -0,0 +1,30 @@
+// *******************************************************
+//
+//  logFormats.h
+//
+//  The table of log formats, shared by the board and the host decoder in tools/telemetryDecoder.c. The board only
+//  records a format's position in the table and its arguments, the host expands them with the format string.
+//
+//  Each entry is X(name, format). Formats only take %d arguments, at most LOG_MAX_ARGS of them. The names are
+//  numbered in order, so only add new formats to the end or old captures will decode with the wrong strings.
+//
+//  Author: Dan Ronen, Jackson Allred, Pieter Leigh
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef IO_LOGFORMATS_H_
+#define IO_LOGFORMATS_H_
+
+#define LOG_FORMATS(X) \
+    X(LOG_STATE, "STATE   | %d -> %d \r\n") \
+    X(LOG_LOOP_OVERRUN, "LOOP    | overrun dt: %d us nominal: %d us \r\n") \
+    X(LOG_STEP_ALT, "STEP ALT| step: %d rise: %d ms overshoot: %d permille settle: %d ms settled: %d IAE: %d/1000 \r\n") \
+    X(LOG_STEP_YAW, "STEP YAW| step: %d rise: %d ms overshoot: %d permille settle: %d ms settled: %d IAE: %d/1000 \r\n") \
+    X(LOG_SWEEP, "SWEEP   | carrier: %d Hz noise: %d/100 permille rms \r\n") \
+    X(LOG_BENCH, "BENCH   | int: %d/%d float: %d/%d cascade: %d/%d ss: %d/%d cycles \r\n") \
+    X(LOG_RECORDER_DUMP, "RECORDER| dump: %d records trigger at: %d cause: %d \r\n") \
+    X(LOG_THRUST_TABLE, "THRUST  | from: %d permille entries: %d duty: %d %d %d %d %d %d permille \r\n") \
+    X(LOG_CLOCK, "CLOCK   | timestamps at: %d Hz \r\n")
+
+#endif /* IO_LOGFORMATS_H_ */
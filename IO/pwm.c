@@ -4,6 +4,23 @@
 //
 // This modual computes the pwm signal for output to the helicopter
 //
+// Both generators run with globally synchronised updates, a compare value written to either one is held until
+// commitPWM() and then both load at their next counter zero. A rotor never sees a truncated pulse from an update
+// landing mid period, and the two rotors always change in the same period. The duties are only staged in memory until
+// the commit writes both compares back to back, so a commit still waiting for its counter zero can't load one rotor's
+// new duty with the other's old one.
+//
+// The control loop's duty for each rotor goes through an actuator stage first. It limits how fast the duty can change
+// and, after the rotors are started, ramps the highest allowed duty up from PWM_DUTY_MIN so a climb from the ground
+// can't pull a current spike. The duty is held in Q16 so slow slew rates still move every update.
+//
+// With dithering on, the committed duties are written to the compare registers from the main generator's counter zero
+// interrupt instead. The part of each duty below a single count is carried over from period to period by a first
+// order sigma-delta, so every period gets a whole count and the average over periods matches the Q16 duty.
+//
+// The carrier frequency can be changed while flying. The new period and the compare values worked out for it are
+// committed together, so the first period at the new frequency already has the same duty as the last one at the old.
+//
 // Author:  Dan Ronen, Jackson Allred, Pieter Leigh
 // Last modified:   06.20.1969
 //
@@ -15,30 +32,32 @@
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 #include "inc/hw_ints.h"
+#include "inc/hw_pwm.h"
 #include "utils/ustdlib.h"
 #include "driverlib/pin_map.h"
 #include "driverlib/pwm.h"
 #include "driverlib/gpio.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/interrupt.h"
 #include "pwm.h"
+#include "pwmDither.h"
+#include "../controllers/loopTimer.h"
 
 // *******************************************************
 // Globals to module
 // *******************************************************
 
 // sets initial pwm variables
-#define PWM_RATE_STEP_HZ   50 
-#define PWM_RATE_MIN_HZ    50
-#define PWM_RATE_MAX_HZ    400
 #define PWM_FIXED_DUTY     5
 #define PWM_DIVIDER        4
 
-#define PWM_FREQUENCY 250 // the frequency at which the Pwm operates
+#define PWM_FREQUENCY 250 // the frequency the Pwm starts at, changed with pwmSetFrequency()
 
 //  PWM Hardware Details M0PWM7 (gen 3)
 //  ---Main Rotor PWM: PC5, J4-05
 #define PWM_MAIN_BASE        PWM0_BASE
 #define PWM_MAIN_GEN         PWM_GEN_3
+#define PWM_MAIN_GEN_BIT     PWM_GEN_3_BIT
 #define PWM_MAIN_OUTNUM      PWM_OUT_7
 #define PWM_MAIN_OUTBIT      PWM_OUT_7_BIT
 #define PWM_MAIN_PERIPH_PWM  SYSCTL_PERIPH_PWM0
@@ -51,6 +70,7 @@
 //  ---Tail Rotor PWM: PF1, J4-05
 #define PWM_TAIL_BASE        PWM1_BASE
 #define PWM_TAIL_GEN         PWM_GEN_2
+#define PWM_TAIL_GEN_BIT     PWM_GEN_2_BIT
 #define PWM_TAIL_OUTNUM      PWM_OUT_5
 #define PWM_TAIL_OUTBIT      PWM_OUT_5_BIT
 #define PWM_TAIL_PERIPH_PWM  SYSCTL_PERIPH_PWM1
@@ -59,51 +79,310 @@
 #define PWM_TAIL_GPIO_CONFIG GPIO_PF1_M1PWM5
 #define PWM_TAIL_GPIO_PIN    GPIO_PIN_1
 
+// Both rotors drive odd outputs, so their duty is set by the generator's B compare register
+#define PWM_MAIN_CMP_REG     (PWM_MAIN_BASE + PWM_MAIN_GEN + PWM_O_X_CMPB)
+#define PWM_TAIL_CMP_REG     (PWM_TAIL_BASE + PWM_TAIL_GEN + PWM_O_X_CMPB)
+#define PWM_GEN_MODE (PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_SYNC | PWM_GEN_MODE_GEN_SYNC_GLOBAL)
+
+// The dither runs off the main generator, the tail generator was started alongside it so its periods line up
+#define PWM_DITHER_INT       INT_PWM0_3
+#define PWM_DITHER_INT_GEN   PWM_INT_GEN_3
+#define PWM_DITHER_PRIORITY  192 // above the control loop so a long controller update can't delay the next period's duty
+
+#define MICROSECONDS_PER_SECOND 1000000
+#define PWM_DUTY_MIN_Q16 PWM_PERMILLE_TO_Q16(PWM_DUTY_MIN * (PWM_PERMILLE / 100))
+#define PWM_DUTY_MAX_Q16 PWM_PERMILLE_TO_Q16(PWM_DUTY_MAX * (PWM_PERMILLE / 100))
+
+typedef struct {
+    uint32_t slewRate; // the fastest the duty can change in Q16 per second, 0 for no limit
+    uint32_t spinUpTimeUs; // how long the spin-up ramp takes from the minimum to the maximum duty, 0 for none
+    uint32_t spinUpElapsedUs; // the time since the rotors were started
+    uint32_t dutyQ16; // the duty last staged
+    volatile bool slewLimited; // false while an experiment needs the duty to switch without being slewed
+} pwmActuator_t; // the rate limits between the controller and a rotor
+
+static uint32_t pwmLoad; // the generator load value, half the period in up/down count mode. Worked out whenever the frequency is set
+static uint32_t pwmFrequency; // the carrier frequency in Hz
+static pwmActuator_t actuators[PWM_ROTORS]; // the actuator stage for each rotor
+
+static bool ditherEnabled = false; // true while the compare registers are written from the counter zero interrupt
+static uint32_t stagedDutyQ16[PWM_ROTORS]; // the duties set since the last commit, for the dither
+static uint32_t committedDutyQ16[PWM_ROTORS]; // the duties the dither is spreading over the pwm periods
+static uint32_t ditherResidual[PWM_ROTORS]; // the fraction of a count carried over to the next period in Q16
+
 
 // *******************************************************
 // Functions
 // *******************************************************
 
-/** sets the pwm signal for the main rotor
-@param ui8Duty is the duty cycle for the rotor */
+/** converts a duty cycle to the compare value. In up/down mode the output is high while the counter is above the
+compare value, so the pulse is 2 * (load - compare) counts of the 2 * load count period
+@param dutyQ16 is the duty cycle in Q16
+@return the compare value */
+static uint32_t
+dutyToCompare(uint32_t dutyQ16)
+{
+    if (dutyQ16 > PWM_DUTY_Q16_ONE) {
+        dutyQ16 = PWM_DUTY_Q16_ONE;
+    }
+    return pwmLoad - ((pwmLoad * dutyQ16) >> PWM_DUTY_Q16_SHIFT);
+}
+
+/** converts a duty cycle to the compare value for the next period, rounding the duty down or up a count so the
+counts over successive periods average out to the exact duty
+@param rotor the rotor from pwmRotors
+@return the compare value */
+static uint32_t
+ditherToCompare(uint8_t rotor)
+{
+    return pwmDitherCompare(pwmLoad, committedDutyQ16[rotor], &ditherResidual[rotor]);
+}
+
+/** the handler for the main generator's counter zero, writes the dithered duties for the next period of both rotors */
+static void
+pwmDitherIntHandler(void)
+{
+    PWMGenIntClear(PWM_MAIN_BASE, PWM_MAIN_GEN, PWM_INT_CNT_ZERO);
+
+    HWREG(PWM_MAIN_CMP_REG) = ditherToCompare(PWM_ROTOR_MAIN);
+    HWREG(PWM_TAIL_CMP_REG) = ditherToCompare(PWM_ROTOR_TAIL);
+    HWREG(PWM_MAIN_BASE + PWM_O_CTL) = PWM_MAIN_GEN_BIT;
+    HWREG(PWM_TAIL_BASE + PWM_O_CTL) = PWM_TAIL_GEN_BIT;
+}
+
+/** stages the pwm signal for the main rotor, rounded to a single count when it is committed. With dithering on the duty
+is kept to full Q16 resolution instead. The rotor keeps its old duty until commitPWM() is called
+@param dutyQ16 is the duty cycle for the rotor in Q16, PWM_DUTY_Q16_ONE is always on */
 void
-setMainPWM (uint8_t ui8Duty)
+setMainPWMDuty (uint32_t dutyQ16)
 {
-    // Calculate the PWM period corresponding to the frequency
-    uint32_t ui32Period =
-        SysCtlClockGet() / PWM_DIVIDER / PWM_FREQUENCY;
+    stagedDutyQ16[PWM_ROTOR_MAIN] = dutyQ16;
+}
 
-    PWMGenPeriodSet(PWM_MAIN_BASE, PWM_MAIN_GEN, ui32Period);
-    PWMPulseWidthSet(PWM_MAIN_BASE, PWM_MAIN_OUTNUM,
-        ui32Period * ui8Duty / 100);
+/** stages the pwm signal for the tail rotor, rounded to a single count when it is committed. With dithering on the duty
+is kept to full Q16 resolution instead. The rotor keeps its old duty until commitPWM() is called
+@param dutyQ16 is the duty cycle for the rotor in Q16, PWM_DUTY_Q16_ONE is always on */
+void
+setTailPWMDuty (uint32_t dutyQ16)
+{
+    stagedDutyQ16[PWM_ROTOR_TAIL] = dutyQ16;
+}
+
+/** writes the staged duty cycles of both rotors back to back and commits them together, they take effect at the end
+of the current pwm period */
+void
+commitPWM (void)
+{
+    bool wasDisabled;
+
+    if (ditherEnabled) {
+        // The dither interrupt picks both up together at its next counter zero
+        IntDisable(PWM_DITHER_INT);
+        committedDutyQ16[PWM_ROTOR_MAIN] = stagedDutyQ16[PWM_ROTOR_MAIN];
+        committedDutyQ16[PWM_ROTOR_TAIL] = stagedDutyQ16[PWM_ROTOR_TAIL];
+        IntEnable(PWM_DITHER_INT);
+        return;
+    }
+
+    // Both compares are worked out first and written back to back, a pending commit reaching its counter zero can only
+    // land between two stores. If it does, this commit loads the matching pair at the next counter zero. The rotors
+    // are on separate modules, the same as PWMSyncUpdate() on each back to back
+    uint32_t mainCompare = dutyToCompare(stagedDutyQ16[PWM_ROTOR_MAIN]);
+    uint32_t tailCompare = dutyToCompare(stagedDutyQ16[PWM_ROTOR_TAIL]);
+
+    wasDisabled = IntMasterDisable();
+    HWREG(PWM_MAIN_CMP_REG) = mainCompare;
+    HWREG(PWM_TAIL_CMP_REG) = tailCompare;
+    HWREG(PWM_MAIN_BASE + PWM_O_CTL) = PWM_MAIN_GEN_BIT;
+    HWREG(PWM_TAIL_BASE + PWM_O_CTL) = PWM_TAIL_GEN_BIT;
+    if (!wasDisabled) {
+        IntMasterEnable();
+    }
+}
+
+/** turns the sigma-delta duty dither on or off. The committed duties carry across the change
+@param enable true to dither the duty across pwm periods, false to round each duty to a count */
+void
+pwmDitherEnable (bool enable)
+{
+    uint8_t rotor;
+
+    if (enable == ditherEnabled) {
+        return;
+    }
+
+    IntDisable(PWM_DITHER_INT);
+    if (enable) {
+        for (rotor = 0; rotor < PWM_ROTORS; rotor++) {
+            committedDutyQ16[rotor] = stagedDutyQ16[rotor];
+            ditherResidual[rotor] = 0;
+        }
+        ditherEnabled = true;
+        IntEnable(PWM_DITHER_INT);
+    } else {
+        ditherEnabled = false;
+        setMainPWMDuty(stagedDutyQ16[PWM_ROTOR_MAIN]);
+        setTailPWMDuty(stagedDutyQ16[PWM_ROTOR_TAIL]);
+        commitPWM();
+    }
+}
+
+/** sets and commits the pwm signal for the main rotor
+@param ui8Duty is the duty cycle for the rotor in percent */
+void
+setMainPWM (uint8_t ui8Duty)
+{
+    setMainPWMDuty(PWM_PERMILLE_TO_Q16(ui8Duty * (PWM_PERMILLE / 100)));
+    commitPWM();
 }
 
-/** sets the pwm signal for the tail rotor
-@param ui8Duty is the duty cycle for the rotor as a unsigned 8 bit int */
+/** sets and commits the pwm signal for the tail rotor
+@param ui8Duty is the duty cycle for the rotor in percent as a unsigned 8 bit int */
 void
 setTailPWM (uint8_t ui8Duty)
 {
-    // Calculate the PWM period corresponding to the frequency
-    uint32_t ui32Period =
-        SysCtlClockGet() / PWM_DIVIDER / PWM_FREQUENCY;
+    setTailPWMDuty(PWM_PERMILLE_TO_Q16(ui8Duty * (PWM_PERMILLE / 100)));
+    commitPWM();
+}
+
+/** changes the carrier frequency of both rotors, keeping their duty cycles. The new period starts on both rotors
+at the end of the current period
+@param frequency the carrier frequency in Hz, from PWM_RATE_MIN_HZ to PWM_RATE_MAX_HZ in steps of PWM_RATE_STEP_HZ
+@return false if the frequency isn't one of the allowed rates, the carrier is left as it was */
+bool
+pwmSetFrequency (uint32_t frequency)
+{
+    uint32_t period;
+    uint32_t mainCompare;
+    uint32_t tailCompare;
+    bool wasDisabled;
+
+    if (frequency < PWM_RATE_MIN_HZ || frequency > PWM_RATE_MAX_HZ
+            || (frequency - PWM_RATE_MIN_HZ) % PWM_RATE_STEP_HZ != 0) {
+        return false;
+    }
+    period = SysCtlClockGet() / PWM_DIVIDER / frequency;
+
+    // Nothing can stage a duty against the old load while the registers are part way through changing. The carrier
+    // sweep calls this from the control loop, so leave the interrupts as the caller had them
+    wasDisabled = IntMasterDisable();
+
+    pwmLoad = period / 2;
+    pwmFrequency = frequency;
+    PWMGenPeriodSet(PWM_MAIN_BASE, PWM_MAIN_GEN, period);
+    PWMGenPeriodSet(PWM_TAIL_BASE, PWM_TAIL_GEN, period);
+
+    // The load is held until the next commit like the compares, so rewrite the compares for the new load and commit
+    // them all together. This also covers a commit already waiting for the end of the period with the old compares
+    if (ditherEnabled) {
+        ditherResidual[PWM_ROTOR_MAIN] = 0;
+        ditherResidual[PWM_ROTOR_TAIL] = 0;
+        mainCompare = ditherToCompare(PWM_ROTOR_MAIN);
+        tailCompare = ditherToCompare(PWM_ROTOR_TAIL);
+    } else {
+        mainCompare = dutyToCompare(stagedDutyQ16[PWM_ROTOR_MAIN]);
+        tailCompare = dutyToCompare(stagedDutyQ16[PWM_ROTOR_TAIL]);
+    }
+    HWREG(PWM_MAIN_CMP_REG) = mainCompare;
+    HWREG(PWM_TAIL_CMP_REG) = tailCompare;
+    HWREG(PWM_MAIN_BASE + PWM_O_CTL) = PWM_MAIN_GEN_BIT;
+    HWREG(PWM_TAIL_BASE + PWM_O_CTL) = PWM_TAIL_GEN_BIT;
+
+    if (!wasDisabled) {
+        IntMasterEnable();
+    }
+    return true;
+}
+
+/** returns the carrier frequency of the rotors
+@return the carrier frequency in Hz */
+uint32_t
+pwmGetFrequency (void)
+{
+    return pwmFrequency;
+}
+
+/** clamps a duty cycle in permille between PWM_DUTY_MIN and PWM_DUTY_MAX
+@param dutyPermille is the duty cycle in permille
+@return the clamped duty cycle in permille */
+uint16_t
+clampDutyPermille(int32_t dutyPermille)
+{
+    if (dutyPermille > PWM_DUTY_MAX * (PWM_PERMILLE / 100)) {
+        dutyPermille = PWM_DUTY_MAX * (PWM_PERMILLE / 100);
+    } else if (dutyPermille < PWM_DUTY_MIN * (PWM_PERMILLE / 100)) {
+        dutyPermille = PWM_DUTY_MIN * (PWM_PERMILLE / 100);
+    }
+    return dutyPermille;
+}
+
+/** sets up a rotor's actuator stage, the limits the control loop's duty goes through on its way to the rotor
+@param rotor the rotor from pwmRotors
+@param slewRate the fastest the duty can change in permille per second, 0 for no limit
+@param spinUpTimeUs how long the spin-up ramp takes from PWM_DUTY_MIN to PWM_DUTY_MAX after startUpPwmRotors(), 0 for none */
+void
+pwmActuatorConfigure(uint8_t rotor, uint32_t slewRate, uint32_t spinUpTimeUs)
+{
+    actuators[rotor].slewRate = PWM_PERMILLE_TO_Q16(slewRate);
+    actuators[rotor].spinUpTimeUs = spinUpTimeUs;
+    actuators[rotor].spinUpElapsedUs = spinUpTimeUs;
+    actuators[rotor].dutyQ16 = PWM_DUTY_MIN_Q16;
+    actuators[rotor].slewLimited = true;
+}
 
-    PWMGenPeriodSet(PWM_TAIL_BASE, PWM_TAIL_GEN, ui32Period);
-    PWMPulseWidthSet(PWM_TAIL_BASE, PWM_TAIL_OUTNUM,
-        ui32Period * ui8Duty / 100);
+/** turns a rotor's slew-rate limit off or back on, the spin-up ramp and the duty limits still apply. A relay
+experiment has to switch the duty in a single step or the slew rate shows up in the measured response
+@param rotor the rotor from pwmRotors
+@param enable false to pass the duty straight through to the rotor */
+void
+pwmActuatorSlewLimit(uint8_t rotor, bool enable)
+{
+    actuators[rotor].slewLimited = enable;
 }
 
-/** clams the Pwm signal between wanted variables
-@param duty is a 32 bit input for the duty cycle
-@return the clamed pwm signal */
-uint8_t
-clampDutyCycle(int32_t duty)
+/** limits a duty cycle by the rotor's slew rate and spin-up ramp and stages it, called every control loop iteration
+@param rotor the rotor from pwmRotors
+@param dutyPermille the duty cycle the controller wants in permille
+@param dtUs the measured time since the last update in microseconds
+@return the duty cycle staged in permille, for the controller's anti-windup */
+uint16_t
+pwmActuatorUpdate(uint8_t rotor, uint16_t dutyPermille, uint32_t dtUs)
 {
-    if (duty > 85) {
-        duty = 85;
-    } else if (duty < 5) {
-        duty = 5;
+    pwmActuator_t* actuator = &actuators[rotor];
+    uint32_t target = PWM_PERMILLE_TO_Q16(dutyPermille);
+    uint32_t ceiling;
+    uint32_t step;
+
+    // Spin-up ramp, the highest allowed duty rises from the minimum to the maximum
+    if (actuator->spinUpElapsedUs < actuator->spinUpTimeUs) {
+        actuator->spinUpElapsedUs += dtUs;
+        if (actuator->spinUpElapsedUs < actuator->spinUpTimeUs) {
+            ceiling = PWM_DUTY_MIN_Q16 + (uint32_t)((uint64_t)(PWM_DUTY_MAX_Q16 - PWM_DUTY_MIN_Q16)
+                    * actuator->spinUpElapsedUs / actuator->spinUpTimeUs);
+            if (target > ceiling) {
+                target = ceiling;
+            }
+        }
+    }
+
+    // Slew-rate limit
+    if (actuator->slewRate > 0 && actuator->slewLimited) {
+        step = (uint32_t)((uint64_t)actuator->slewRate * dtUs / MICROSECONDS_PER_SECOND);
+        if (target > actuator->dutyQ16 + step) {
+            target = actuator->dutyQ16 + step;
+        } else if (target + step < actuator->dutyQ16) {
+            target = actuator->dutyQ16 - step;
+        }
+    }
+
+    actuator->dutyQ16 = target;
+    if (rotor == PWM_ROTOR_MAIN) {
+        setMainPWMDuty(target);
+    } else {
+        setTailPWMDuty(target);
     }
-    return duty;
+
+    return (target * PWM_PERMILLE + PWM_DUTY_Q16_ONE / 2) >> PWM_DUTY_Q16_SHIFT;
 }
 
 /** disables the rotors */
@@ -114,10 +393,45 @@ shutOffPwmRotors()
     PWMOutputState(PWM_TAIL_BASE, PWM_TAIL_OUTBIT, false);
 }
 
-/** Enables the rotors */
+/** Enables the rotors at PWM_DUTY_MIN and starts their spin-up ramps from there. Waits for the minimum to load,
+at most a pwm period, with the control loop held off */
 void
 startUpPwmRotors()
 {
+    uint8_t rotor;
+    bool loopWasDisabled;
+
+    // The control loop slews and commits the actuators, hold it off until they are reset and the minimum has loaded.
+    // Its commits would also keep queueing updates so the wait below never ended. A tick that comes meanwhile runs late
+    loopWasDisabled = loopTimerIntDisable();
+
+    for (rotor = 0; rotor < PWM_ROTORS; rotor++) {
+        actuators[rotor].spinUpElapsedUs = 0;
+        actuators[rotor].dutyQ16 = PWM_DUTY_MIN_Q16;
+    }
+
+    // Start from the minimum, not whatever duty was committed when the rotors were shut off
+    setMainPWMDuty(PWM_DUTY_MIN_Q16);
+    setTailPWMDuty(PWM_DUTY_MIN_Q16);
+    commitPWM();
+
+    // Keep the outputs off until the minimum has loaded. The dither interrupt is held off meanwhile, it would keep
+    // queueing an update so the wait never ends. Its next period is worked out from the committed minimum anyway
+    IntDisable(PWM_DITHER_INT);
+    HWREG(PWM_MAIN_CMP_REG) = dutyToCompare(PWM_DUTY_MIN_Q16);
+    HWREG(PWM_TAIL_CMP_REG) = dutyToCompare(PWM_DUTY_MIN_Q16);
+    HWREG(PWM_MAIN_BASE + PWM_O_CTL) = PWM_MAIN_GEN_BIT;
+    HWREG(PWM_TAIL_BASE + PWM_O_CTL) = PWM_TAIL_GEN_BIT;
+    while ((HWREG(PWM_MAIN_BASE + PWM_O_CTL) & PWM_MAIN_GEN_BIT) || (HWREG(PWM_TAIL_BASE + PWM_O_CTL) & PWM_TAIL_GEN_BIT)) {
+        continue; // at most one pwm period
+    }
+    if (ditherEnabled) {
+        IntEnable(PWM_DITHER_INT);
+    }
+    if (!loopWasDisabled) {
+        loopTimerIntEnable();
+    }
+
     PWMOutputState(PWM_MAIN_BASE, PWM_MAIN_OUTBIT, true);
     PWMOutputState(PWM_TAIL_BASE, PWM_TAIL_OUTBIT, true);
 }
@@ -126,6 +440,9 @@ startUpPwmRotors()
 void
 initPwm (void)
 {
+    // Both generators start on the same period, pwmSetFrequency() changes it for both together
+    uint32_t period = SysCtlClockGet() / PWM_DIVIDER / PWM_FREQUENCY;
+
     // Set up the main motor signal
     SysCtlPeripheralEnable(PWM_MAIN_PERIPH_PWM);
     SysCtlPeripheralEnable(PWM_MAIN_PERIPH_GPIO);
@@ -133,14 +450,13 @@ initPwm (void)
     GPIOPinConfigure(PWM_MAIN_GPIO_CONFIG);
     GPIOPinTypePWM(PWM_MAIN_GPIO_BASE, PWM_MAIN_GPIO_PIN);
 
-    PWMGenConfigure(PWM_MAIN_BASE, PWM_MAIN_GEN,
-                    PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC);
+    PWMGenConfigure(PWM_MAIN_BASE, PWM_MAIN_GEN, PWM_GEN_MODE);
+    PWMGenPeriodSet(PWM_MAIN_BASE, PWM_MAIN_GEN, period);
+    pwmLoad = period / 2; // what PWMGenPeriodSet() loads in up/down mode, the register itself is buffered until the commit
+    pwmFrequency = PWM_FREQUENCY;
 
-
-    // Set the initial PWM parameters for main motor
-    setMainPWM (PWM_FIXED_DUTY);
-
-    PWMGenEnable(PWM_MAIN_BASE, PWM_MAIN_GEN);
+    // Stage the initial PWM parameters for main motor, committed once the tail generator is set up
+    setMainPWMDuty(PWM_PERMILLE_TO_Q16(PWM_FIXED_DUTY * (PWM_PERMILLE / 100)));
 
     // ----------------------------------------------------------------------------------------------
 
@@ -151,14 +467,24 @@ initPwm (void)
     GPIOPinConfigure(PWM_TAIL_GPIO_CONFIG);
     GPIOPinTypePWM(PWM_TAIL_GPIO_BASE, PWM_TAIL_GPIO_PIN);
 
-    PWMGenConfigure(PWM_TAIL_BASE, PWM_TAIL_GEN,
-                    PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC);
+    PWMGenConfigure(PWM_TAIL_BASE, PWM_TAIL_GEN, PWM_GEN_MODE);
+    PWMGenPeriodSet(PWM_TAIL_BASE, PWM_TAIL_GEN, period);
 
     // Set the initial PWM parameters
-    setTailPWM(PWM_FIXED_DUTY);
+    setTailPWMDuty(PWM_PERMILLE_TO_Q16(PWM_FIXED_DUTY * (PWM_PERMILLE / 100)));
+    commitPWM();
 
+    // Start both generators back to back so their periods, and so the committed updates, line up
+    PWMGenEnable(PWM_MAIN_BASE, PWM_MAIN_GEN);
     PWMGenEnable(PWM_TAIL_BASE, PWM_TAIL_GEN);
 
+    // The dither interrupt is set up here but only enabled by pwmDitherEnable()
+    PWMGenIntRegister(PWM_MAIN_BASE, PWM_MAIN_GEN, pwmDitherIntHandler);
+    IntPrioritySet(PWM_DITHER_INT, PWM_DITHER_PRIORITY);
+    PWMGenIntTrigEnable(PWM_MAIN_BASE, PWM_MAIN_GEN, PWM_INT_CNT_ZERO);
+    PWMIntEnable(PWM_MAIN_BASE, PWM_DITHER_INT_GEN);
+    IntDisable(PWM_DITHER_INT);
+
     // Turn on the motors!
     PWMOutputState(PWM_MAIN_BASE, PWM_MAIN_OUTBIT, true);
     PWMOutputState(PWM_TAIL_BASE, PWM_TAIL_OUTBIT, true);
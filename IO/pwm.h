@@ -19,33 +19,101 @@
 
 
 #define PWM_DIVIDER_CODE SYSCTL_PWMDIV_4
+#define PWM_DUTY_MIN 5 // the lowest duty cycle the rotors are driven at in percent
+#define PWM_DUTY_MAX 85 // the highest duty cycle the rotors are driven at in percent
+#define PWM_PERMILLE 1000 // a full duty cycle in permille
+#define PWM_DUTY_Q16_ONE 65536 // a full duty cycle in Q16
+#define PWM_DUTY_Q16_SHIFT 16 // takes a count times a Q16 duty back to counts
+#define PWM_RATE_STEP_HZ 50 // the carrier frequencies pwmSetFrequency() accepts
+#define PWM_RATE_MIN_HZ 50 // the load is 16 bits, so the period can't be much longer than this
+#define PWM_RATE_MAX_HZ 400
+#define PWM_PERMILLE_TO_Q16(permille) (((uint32_t)(permille) * PWM_DUTY_Q16_ONE + PWM_PERMILLE / 2) / PWM_PERMILLE)
+
+enum pwmRotors {PWM_ROTOR_MAIN = 0, PWM_ROTOR_TAIL, PWM_ROTORS}; // the rotors with an actuator stage
 
 // *******************************************************
 // Functions
 // *******************************************************
 
 
-/** sets the pwm signal for the main rotor
-@param ui8Duty is the duty cycle for the rotor */
+/** sets and commits the pwm signal for the main rotor
+@param ui8Duty is the duty cycle for the rotor in percent */
 void
 setMainPWM (uint8_t ui8Duty);
 
-/** sets the pwm signal for the tail rotor
-@param ui8Duty is the duty cycle for the rotor as a unsigned 8 bit int */
+/** sets and commits the pwm signal for the tail rotor
+@param ui8Duty is the duty cycle for the rotor in percent as a unsigned 8 bit int */
 void
 setTailPWM (uint8_t ui8Duty);
 
-/** clams the Pwm signal between wanted variables
-@param duty is a 32 bit input for the duty cycle
-@return the clamed pwm signal */
-uint8_t
-clampDutyCycle(int32_t duty);
+/** stages the pwm signal for the main rotor, rounded to a single count when it is committed.
+The rotor keeps its old duty until commitPWM() is called
+@param dutyQ16 is the duty cycle for the rotor in Q16, PWM_DUTY_Q16_ONE is always on */
+void
+setMainPWMDuty (uint32_t dutyQ16);
+
+/** stages the pwm signal for the tail rotor, rounded to a single count when it is committed.
+The rotor keeps its old duty until commitPWM() is called
+@param dutyQ16 is the duty cycle for the rotor in Q16, PWM_DUTY_Q16_ONE is always on */
+void
+setTailPWMDuty (uint32_t dutyQ16);
+
+/** writes the staged duty cycles of both rotors back to back and commits them together, they take effect at the end
+of the current pwm period */
+void
+commitPWM (void);
+
+/** turns the sigma-delta duty dither on or off. The committed duties carry across the change
+@param enable true to dither the duty across pwm periods, false to round each duty to a count */
+void
+pwmDitherEnable (bool enable);
+
+/** changes the carrier frequency of both rotors, keeping their duty cycles. The new period starts on both rotors
+at the end of the current period
+@param frequency the carrier frequency in Hz, from PWM_RATE_MIN_HZ to PWM_RATE_MAX_HZ in steps of PWM_RATE_STEP_HZ
+@return false if the frequency isn't one of the allowed rates, the carrier is left as it was */
+bool
+pwmSetFrequency (uint32_t frequency);
+
+/** returns the carrier frequency of the rotors
+@return the carrier frequency in Hz */
+uint32_t
+pwmGetFrequency (void);
+
+/** clamps a duty cycle in permille between PWM_DUTY_MIN and PWM_DUTY_MAX
+@param dutyPermille is the duty cycle in permille
+@return the clamped duty cycle in permille */
+uint16_t
+clampDutyPermille(int32_t dutyPermille);
+
+/** sets up a rotor's actuator stage, the limits the control loop's duty goes through on its way to the rotor
+@param rotor the rotor from pwmRotors
+@param slewRate the fastest the duty can change in permille per second, 0 for no limit
+@param spinUpTimeUs how long the spin-up ramp takes from PWM_DUTY_MIN to PWM_DUTY_MAX after startUpPwmRotors(), 0 for none */
+void
+pwmActuatorConfigure(uint8_t rotor, uint32_t slewRate, uint32_t spinUpTimeUs);
+
+/** turns a rotor's slew-rate limit off or back on, the spin-up ramp and the duty limits still apply. A relay
+experiment has to switch the duty in a single step or the slew rate shows up in the measured response
+@param rotor the rotor from pwmRotors
+@param enable false to pass the duty straight through to the rotor */
+void
+pwmActuatorSlewLimit(uint8_t rotor, bool enable);
+
+/** limits a duty cycle by the rotor's slew rate and spin-up ramp and stages it, called every control loop iteration
+@param rotor the rotor from pwmRotors
+@param dutyPermille the duty cycle the controller wants in permille
+@param dtUs the measured time since the last update in microseconds
+@return the duty cycle staged in permille, for the controller's anti-windup */
+uint16_t
+pwmActuatorUpdate(uint8_t rotor, uint16_t dutyPermille, uint32_t dtUs);
 
 /** disables the rotors */
 void
 shutOffPwmRotors();
 
-/** Enables the rotors */
+/** Enables the rotors at PWM_DUTY_MIN and starts their spin-up ramps from there. Waits for the minimum to load,
+at most a pwm period, with the control loop held off */
 void
 startUpPwmRotors();
 
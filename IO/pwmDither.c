@@ -0,0 +1,51 @@
+//*****************************************************************************
+//
+// pwmDither.c
+//
+// The sigma-delta duty dither behind the pwm module, kept apart from the hardware so it can be checked on the host
+// by tools/ditherTest.c
+//
+// Each period gets a whole count. The part of the duty below a count is added into a residual every period, and once
+// a whole count has built up the period is rounded up and the count taken back off, so the average over periods
+// matches the Q16 duty.
+//
+// Author:  Dan Ronen, Jackson Allred, Pieter Leigh
+// Last modified:   06.20.1969
+//
+//*****************************************************************************
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pwmDither.h"
+
+#define PWM_DUTY_FRACTION_MASK (PWM_DUTY_Q16_ONE - 1)
+
+/** converts a duty cycle to the compare value for the next period, rounding the duty down or up a count so the
+counts over successive periods average out to the exact duty
+@param load the generator load value, half the period in up/down count mode, at most 16 bits
+@param dutyQ16 is the duty cycle in Q16
+@param residual the fraction of a count carried over from the last period in Q16, updated for the next one
+@return the compare value */
+uint32_t
+pwmDitherCompare (uint32_t load, uint32_t dutyQ16, uint32_t* residual)
+{
+    uint32_t countsQ16;
+    uint32_t counts;
+
+    if (dutyQ16 > PWM_DUTY_Q16_ONE) {
+        dutyQ16 = PWM_DUTY_Q16_ONE;
+    }
+
+    // The load is at most 16 bits, so the exact count in Q16 fits
+    countsQ16 = load * dutyQ16;
+    counts = countsQ16 >> PWM_DUTY_Q16_SHIFT;
+
+    *residual += countsQ16 & PWM_DUTY_FRACTION_MASK;
+    if (*residual >= PWM_DUTY_Q16_ONE && counts < load) {
+        *residual -= PWM_DUTY_Q16_ONE;
+        counts++;
+    }
+
+    return load - counts;
+}
@@ -0,0 +1,31 @@
+//*****************************************************************************
+//
+// pwmDither.h
+//
+// The sigma-delta duty dither behind the pwm module, kept apart from the hardware so it can be checked on the host
+// by tools/ditherTest.c
+//
+// Author:  Dan Ronen, Jackson Allred, Pieter Leigh
+// Last modified:   06.20.1969
+//
+//*****************************************************************************
+
+
+#ifndef IO_PWMDITHER_H_
+#define IO_PWMDITHER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pwm.h"
+
+/** converts a duty cycle to the compare value for the next period, rounding the duty down or up a count so the
+counts over successive periods average out to the exact duty
+@param load the generator load value, half the period in up/down count mode, at most 16 bits
+@param dutyQ16 is the duty cycle in Q16
+@param residual the fraction of a count carried over from the last period in Q16, updated for the next one
+@return the compare value */
+uint32_t
+pwmDitherCompare (uint32_t load, uint32_t dutyQ16, uint32_t* residual);
+
+#endif /* IO_PWMDITHER_H_ */
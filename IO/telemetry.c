@@ -0,0 +1,181 @@
+// *******************************************************
+//
+//  telemetry.c
+//
+//  Binary telemetry frames for the Uart link, fixed layout and little-endian so the host can decode them without
+//  parsing text.
+//
+//  Each frame is the payload followed by its CRC16, COBS encoded so it holds no zero bytes, with a zero delimiter
+//  either side. The leading delimiter keeps a frame decodable when a text line went out just before it. Status frames
+//  carry the periodic status, log frames carry one record from the log ring each and record frames carry one
+//  flight recorder record each while it is dumped.
+//
+//  Author: Dan Ronen, Jackson Allred, Pieter Leigh
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "telemetry.h"
+#include "uart.h"
+
+//********************************************************
+// Global variables
+//********************************************************
+static uint16_t sequence = 0; // the sequence number of the next frame
+
+//********************************************************
+// Functions
+//********************************************************
+
+/** Writes a 16 bit value little-endian
+@param buffer where to write it
+@param value the value */
+static void
+put16 (uint8_t* buffer, uint16_t value)
+{
+    buffer[0] = value & 0xFF;
+    buffer[1] = value >> 8;
+}
+
+/** Writes a 32 bit value little-endian
+@param buffer where to write it
+@param value the value */
+static void
+put32 (uint8_t* buffer, uint32_t value)
+{
+    put16(buffer, value & 0xFFFF);
+    put16(buffer + 2, value >> 16);
+}
+
+/** Returns the CRC16-CCITT of some bytes
+@param data the bytes
+@param length the amount of bytes
+@return the CRC */
+static uint16_t
+crc16 (const uint8_t* data, uint16_t length)
+{
+    uint16_t crc = TELEMETRY_CRC_INIT;
+    uint16_t i;
+    uint8_t bit;
+
+    for (i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ TELEMETRY_CRC_POLYNOMIAL : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/** COBS encodes some bytes, the output holds no zero bytes and is at most one byte longer per 254 bytes of input
+@param data the bytes
+@param length the amount of bytes
+@param encoded where to write the encoded bytes
+@return the amount of encoded bytes */
+static uint16_t
+cobsEncode (const uint8_t* data, uint16_t length, uint8_t* encoded)
+{
+    uint16_t codeIndex = 0; // where the length of the current run of non-zero bytes goes
+    uint16_t out = 1;
+    uint8_t code = 1;
+    uint16_t i;
+
+    for (i = 0; i < length; i++) {
+        if (data[i] != 0) {
+            encoded[out++] = data[i];
+            code++;
+        }
+        if (data[i] == 0 || code == 0xFF) {
+            encoded[codeIndex] = code;
+            codeIndex = out++;
+            code = 1;
+        }
+    }
+    encoded[codeIndex] = code;
+    return out;
+}
+
+/** Adds the CRC to a payload, COBS encodes it and queues it on the Uart between delimiters
+@param payload the payload, with room for the CRC after it
+@param length the payload length */
+static void
+sendFrame (uint8_t* payload, uint16_t length)
+{
+    uint8_t frame[TELEMETRY_MAX_FRAME_LENGTH];
+    uint16_t frameLength;
+
+    put16(&payload[length], crc16(payload, length));
+
+    frame[0] = TELEMETRY_DELIMITER;
+    frameLength = 1 + cobsEncode(payload, length + TELEMETRY_CRC_LENGTH, &frame[1]);
+    frame[frameLength++] = TELEMETRY_DELIMITER;
+
+    UARTSendBytes(frame, frameLength);
+}
+
+/** Packs a status frame, adds the CRC, COBS encodes it and queues it on the Uart
+@param status the values to send */
+void
+telemetrySendStatus (const telemetryStatus_t* status)
+{
+    uint8_t payload[TELEMETRY_STATUS_LENGTH + TELEMETRY_CRC_LENGTH];
+
+    payload[TELEMETRY_STATUS_TYPE] = TELEMETRY_FRAME_STATUS;
+    payload[TELEMETRY_STATUS_STATE] = status->state;
+    put16(&payload[TELEMETRY_STATUS_SEQUENCE], sequence++);
+    put16(&payload[TELEMETRY_STATUS_ALTITUDE], status->altitude);
+    put16(&payload[TELEMETRY_STATUS_ALTITUDE_TARGET], status->altitudeTarget);
+    put16(&payload[TELEMETRY_STATUS_YAW], status->yaw);
+    put16(&payload[TELEMETRY_STATUS_YAW_TARGET], status->yawTarget);
+    put16(&payload[TELEMETRY_STATUS_MAIN_DUTY], status->mainDuty);
+    put16(&payload[TELEMETRY_STATUS_TAIL_DUTY], status->tailDuty);
+    put16(&payload[TELEMETRY_STATUS_LOOP_JITTER], status->loopJitter);
+    put16(&payload[TELEMETRY_STATUS_UART_DROPS], status->uartDrops);
+    sendFrame(payload, TELEMETRY_STATUS_LENGTH);
+}
+
+/** Packs a log record into a frame, adds the CRC, COBS encodes it and queues it on the Uart
+@param record the record to send */
+void
+telemetrySendLog (const logRecord_t* record)
+{
+    uint8_t payload[TELEMETRY_LOG_MAX_LENGTH + TELEMETRY_CRC_LENGTH];
+    uint8_t i;
+
+    payload[TELEMETRY_LOG_TYPE] = TELEMETRY_FRAME_LOG;
+    put16(&payload[TELEMETRY_LOG_FORMAT], record->format);
+    put32(&payload[TELEMETRY_LOG_TIMESTAMP], record->timestamp);
+    payload[TELEMETRY_LOG_ARG_COUNT] = record->argCount;
+    for (i = 0; i < record->argCount; i++) {
+        put32(&payload[TELEMETRY_LOG_ARGS + 4 * i], record->args[i]);
+    }
+    sendFrame(payload, TELEMETRY_LOG_ARGS + 4 * record->argCount);
+}
+
+/** Packs a flight recorder record into a frame, adds the CRC, COBS encodes it and queues it on the Uart
+@param index the record counted from the oldest
+@param record the record to send */
+void
+telemetrySendRecord (uint16_t index, const flightRecord_t* record)
+{
+    uint8_t payload[TELEMETRY_RECORD_LENGTH + TELEMETRY_CRC_LENGTH];
+
+    payload[TELEMETRY_RECORD_TYPE] = TELEMETRY_FRAME_RECORD;
+    put16(&payload[TELEMETRY_RECORD_INDEX], index);
+    put16(&payload[TELEMETRY_RECORD_TICK], record->tick);
+    put16(&payload[TELEMETRY_RECORD_ADC_MEAN], record->adcMean);
+    put16(&payload[TELEMETRY_RECORD_ALT_ERROR], record->altError);
+    put16(&payload[TELEMETRY_RECORD_YAW_ERROR], record->yawError);
+    put16(&payload[TELEMETRY_RECORD_ALT_PROPORTIONAL], record->altProportional);
+    put16(&payload[TELEMETRY_RECORD_ALT_INTEGRAL], record->altIntegral);
+    put16(&payload[TELEMETRY_RECORD_ALT_DERIVATIVE], record->altDerivative);
+    put16(&payload[TELEMETRY_RECORD_YAW_PROPORTIONAL], record->yawProportional);
+    put16(&payload[TELEMETRY_RECORD_YAW_INTEGRAL], record->yawIntegral);
+    put16(&payload[TELEMETRY_RECORD_YAW_DERIVATIVE], record->yawDerivative);
+    put16(&payload[TELEMETRY_RECORD_MAIN_DUTY], record->mainDuty);
+    put16(&payload[TELEMETRY_RECORD_TAIL_DUTY], record->tailDuty);
+    sendFrame(payload, TELEMETRY_RECORD_LENGTH);
+}
@@ -0,0 +1,108 @@
+// *******************************************************
+//
+//  telemetry.h
+//
+//  Binary telemetry frames for the Uart link, fixed layout and little-endian so the host can decode them without
+//  parsing text. The layout here is shared with the host decoder in tools/telemetryDecoder.c.
+//
+//  Author: Dan Ronen, Jackson Allred, Pieter Leigh
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef IO_TELEMETRY_H_
+#define IO_TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "log.h"
+#include "../controllers/flightRecorder.h"
+
+//********************************************************
+// Constants
+//********************************************************
+#define TELEMETRY_DELIMITER 0x00 // frames are COBS encoded, so this byte only ever appears between frames
+#define TELEMETRY_CRC_INIT 0xFFFF // CRC16-CCITT
+#define TELEMETRY_CRC_POLYNOMIAL 0x1021
+#define TELEMETRY_CRC_LENGTH 2
+
+#define TELEMETRY_FRAME_STATUS 0x01 // the frame type of a status frame
+#define TELEMETRY_FRAME_LOG 0x02 // the frame type of a log record
+#define TELEMETRY_FRAME_RECORD 0x03 // the frame type of a flight recorder record
+
+// Status frame layout, byte offsets into the payload. Multi-byte fields are little-endian
+#define TELEMETRY_STATUS_TYPE 0 // uint8, TELEMETRY_FRAME_STATUS
+#define TELEMETRY_STATUS_STATE 1 // uint8, the flight state
+#define TELEMETRY_STATUS_SEQUENCE 2 // uint16, counts up by one each frame sent, gaps are dropped frames
+#define TELEMETRY_STATUS_ALTITUDE 4 // int16, percent
+#define TELEMETRY_STATUS_ALTITUDE_TARGET 6 // int16, percent
+#define TELEMETRY_STATUS_YAW 8 // int16, degrees
+#define TELEMETRY_STATUS_YAW_TARGET 10 // int16, degrees
+#define TELEMETRY_STATUS_MAIN_DUTY 12 // uint16, permille
+#define TELEMETRY_STATUS_TAIL_DUTY 14 // uint16, permille
+#define TELEMETRY_STATUS_LOOP_JITTER 16 // uint16, the largest control loop jitter since the last frame in microseconds
+#define TELEMETRY_STATUS_UART_DROPS 18 // uint16, the Uart frames dropped so far, wraps
+#define TELEMETRY_STATUS_LENGTH 20 // the payload length, the CRC follows it
+
+// Log frame layout, byte offsets into the payload. Multi-byte fields are little-endian
+#define TELEMETRY_LOG_TYPE 0 // uint8, TELEMETRY_FRAME_LOG
+#define TELEMETRY_LOG_FORMAT 1 // uint16, the format's position in logFormats.h
+#define TELEMETRY_LOG_TIMESTAMP 3 // uint32, system clock cycles, wraps
+#define TELEMETRY_LOG_ARG_COUNT 7 // uint8, the amount of arguments
+#define TELEMETRY_LOG_ARGS 8 // int32 each, the arguments
+#define TELEMETRY_LOG_MAX_LENGTH (TELEMETRY_LOG_ARGS + 4 * LOG_MAX_ARGS) // the payload length, the CRC follows it
+
+// Flight recorder frame layout, byte offsets into the payload. Multi-byte fields are little-endian
+#define TELEMETRY_RECORD_TYPE 0 // uint8, TELEMETRY_FRAME_RECORD
+#define TELEMETRY_RECORD_INDEX 1 // uint16, the record counted from the oldest in the dump
+#define TELEMETRY_RECORD_TICK 3 // uint16, the control loop iteration
+#define TELEMETRY_RECORD_ADC_MEAN 5 // uint16, raw ADC counts
+#define TELEMETRY_RECORD_ALT_ERROR 7 // int16, percent
+#define TELEMETRY_RECORD_YAW_ERROR 9 // int16, degrees
+#define TELEMETRY_RECORD_ALT_PROPORTIONAL 11 // int16, the altitude response terms
+#define TELEMETRY_RECORD_ALT_INTEGRAL 13 // int16
+#define TELEMETRY_RECORD_ALT_DERIVATIVE 15 // int16
+#define TELEMETRY_RECORD_YAW_PROPORTIONAL 17 // int16, the yaw response terms
+#define TELEMETRY_RECORD_YAW_INTEGRAL 19 // int16
+#define TELEMETRY_RECORD_YAW_DERIVATIVE 21 // int16
+#define TELEMETRY_RECORD_MAIN_DUTY 23 // uint16, permille
+#define TELEMETRY_RECORD_TAIL_DUTY 25 // uint16, permille
+#define TELEMETRY_RECORD_LENGTH 27 // the payload length, the CRC follows it
+
+// The largest encoded frame, a delimiter either side and one COBS overhead byte for every 254 bytes
+#define TELEMETRY_MAX_FRAME_LENGTH (TELEMETRY_LOG_MAX_LENGTH + TELEMETRY_CRC_LENGTH + 3)
+
+typedef struct {
+    uint8_t state; // the flight state
+    int16_t altitude; // percent
+    int16_t altitudeTarget; // percent
+    int16_t yaw; // degrees
+    int16_t yawTarget; // degrees
+    uint16_t mainDuty; // permille
+    uint16_t tailDuty; // permille
+    uint16_t loopJitter; // microseconds
+    uint16_t uartDrops; // frames
+} telemetryStatus_t; // the values sent in a status frame
+
+//********************************************************
+// Prototypes
+//********************************************************
+
+/** Packs a status frame, adds the CRC, COBS encodes it and queues it on the Uart
+@param status the values to send */
+void
+telemetrySendStatus (const telemetryStatus_t* status);
+
+/** Packs a log record into a frame, adds the CRC, COBS encodes it and queues it on the Uart
+@param record the record to send */
+void
+telemetrySendLog (const logRecord_t* record);
+
+/** Packs a flight recorder record into a frame, adds the CRC, COBS encodes it and queues it on the Uart
+@param index the record counted from the oldest
+@param record the record to send */
+void
+telemetrySendRecord (uint16_t index, const flightRecord_t* record);
+
+#endif /* IO_TELEMETRY_H_ */
@@ -3,7 +3,14 @@
 //  uart.c
 //
 //  File for computing the uart functions
-//  
+//
+//  Sending never waits on the link. Each string sent is a frame, copied whole into a transmit ring or dropped whole
+//  if the ring can't hold all of it, so the terminal never sees half a line. The UART transmit interrupt drains the
+//  ring into the hardware FIFO whenever the FIFO runs low. Received chars go the other way, the receive interrupt
+//  moves them from the FIFO into a receive ring for the main loop to read.
+//
+//  The link starts at BAUD_RATE and can be moved to a faster rate with a handshake driven by the host, see
+//  baudHandshake.c. This file sends the replies and makes the rate changes the handshake asks for.
 //
 //  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
 //  Last modified:   06.20.1969
@@ -21,21 +28,86 @@
 #include "driverlib/systick.h"
 #include "driverlib/debug.h"
 #include "driverlib/pin_map.h"
+#include "driverlib/interrupt.h"
 #include "utils/ustdlib.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "uart.h"
+#include "baudHandshake.h"
 
 //********************************************************
 // Global variables
 //********************************************************
 char statusStr[MAX_STR_LEN + 1]; // creates the char to be assigned to
 volatile uint8_t slowTick = false; // holds the value for the slow tick
+static char txRing[UART_TX_BUFFER_SIZE]; // the chars waiting to go out
+static volatile uint16_t txHead = 0; // where the next char sent is written, only moved by UARTSend()
+static volatile uint16_t txTail = 0; // where the next char to go out is read, only moved by the interrupt
+static volatile uint32_t txDroppedFrames = 0; // the amount of strings dropped because the ring was full
+static char rxRing[UART_RX_BUFFER_SIZE]; // the chars received and not read yet
+static volatile uint16_t rxHead = 0; // where the next char received is written, only moved by the interrupt
+static volatile uint16_t rxTail = 0; // where the next char is read, only moved by uartReadChar()
+static volatile uint32_t rxOverflows = 0; // the amount of chars lost because the ring was full
+
+static baudHandshake_t baudHandshake; // the rate the link is running at and the progress to a new one
 
 //********************************************************
 // Functions
 //********************************************************
 
+/** Sets the rate of the link, anything still going out is cut off
+@param rate the baud rate */
+static void
+configureBaudRate (uint32_t rate)
+{
+    UARTConfigSetExpClk(UART_USB_BASE, SysCtlClockGet(), rate,
+            UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE |
+            UART_CONFIG_PAR_NONE);
+    UARTFIFOEnable(UART_USB_BASE);
+}
+
+/** Moves chars from the transmit ring into the hardware FIFO until one of them is full or empty */
+static void
+fillTxFifo (void)
+{
+    while (txTail != txHead && UARTSpaceAvail(UART_USB_BASE)) {
+        UARTCharPutNonBlocking(UART_USB_BASE, txRing[txTail]);
+        txTail = (txTail + 1) & (UART_TX_BUFFER_SIZE - 1);
+    }
+}
+
+/** Moves received chars from the hardware FIFO into the receive ring */
+static void
+emptyRxFifo (void)
+{
+    int32_t received;
+    uint16_t next;
+
+    while ((received = UARTCharGetNonBlocking(UART_USB_BASE)) != -1) {
+        next = (rxHead + 1) & (UART_RX_BUFFER_SIZE - 1);
+        if (next == rxTail) {
+            rxOverflows++;
+        } else {
+            rxRing[rxHead] = received;
+            rxHead = next;
+        }
+    }
+}
+
+/** the handler for UART0, refills the transmit FIFO once it runs low and empties the receive FIFO once it has
+filled past its level or gone quiet with chars in it */
+static void
+uartIntHandler (void)
+{
+    uint32_t status = UARTIntStatus(UART_USB_BASE, true);
+
+    UARTIntClear(UART_USB_BASE, status);
+    if (status & (UART_INT_RX | UART_INT_RT)) {
+        emptyRxFifo();
+    }
+    fillTxFifo();
+}
+
 /** initialiseUSB_UART - 8 bits, 1 stop bit, no parity */
 void
 initUart (void)
@@ -52,25 +124,168 @@ initUart (void)
     GPIOPinConfigure (GPIO_PA0_U0RX);
     GPIOPinConfigure (GPIO_PA1_U0TX);
 
-    UARTConfigSetExpClk(UART_USB_BASE, SysCtlClockGet(), BAUD_RATE,
-            UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE |
-            UART_CONFIG_PAR_NONE);
-    UARTFIFOEnable(UART_USB_BASE);
+    baudHandshakeInit(&baudHandshake, SysCtlClockGet());
+    configureBaudRate(BAUD_RATE);
+    UARTFIFOLevelSet(UART_USB_BASE, UART_FIFO_TX2_8, UART_FIFO_RX4_8);
+    UARTTxIntModeSet(UART_USB_BASE, UART_TXINT_MODE_FIFO);
+
+    UARTIntRegister(UART_USB_BASE, uartIntHandler);
+    IntPrioritySet(UART_USB_INT, UART_USB_PRIORITY);
+    UARTIntEnable(UART_USB_BASE, UART_INT_TX | UART_INT_RX | UART_INT_RT);
     UARTEnable(UART_USB_BASE);
 }
 
-/** Transmit a string via UART0
+/** Copies bytes into the transmit ring and starts them going out, even while a rate switch is waiting. The bytes
+are dropped whole if the ring can't hold all of them
+@param data the bytes to send
+@param length the amount of bytes */
+static void
+queueBytes (const uint8_t* data, uint16_t length)
+{
+    uint16_t free;
+    uint16_t head = txHead;
+    uint16_t i;
+
+    // One slot is always left empty so a full ring can be told apart from an empty one
+    free = (txTail - head - 1) & (UART_TX_BUFFER_SIZE - 1);
+    if (length > free) {
+        txDroppedFrames++;
+        return;
+    }
+
+    for (i = 0; i < length; i++) {
+        txRing[head] = data[i];
+        head = (head + 1) & (UART_TX_BUFFER_SIZE - 1);
+    }
+    txHead = head; // publish the whole frame at once
+
+    // The interrupt only fires as the FIFO drains, so start it off if it has already gone empty
+    IntDisable(UART_USB_INT);
+    fillTxFifo();
+    IntEnable(UART_USB_INT);
+}
+
+/** Queues bytes to transmit via UART0 without waiting. The bytes are dropped whole if the transmit ring can't
+hold all of them
+@param data the bytes to send
+@param length the amount of bytes */
+void
+UARTSendBytes (const uint8_t* data, uint16_t length)
+{
+    // Nothing is queued while a rate switch is waiting for the ring to drain, the host has already moved to the new rate
+    if (baudHandshake.state == UART_BAUD_SWITCHING) {
+        txDroppedFrames++;
+        return;
+    }
+    queueBytes(data, length);
+}
+
+/** Queues a string to transmit via UART0 without waiting. The string is dropped whole if the transmit ring can't
+hold all of it
 @param a char to send to the UART response */
 void
 UARTSend (char *pucBuffer)
 {
-    // Loop while there are more characters to send.
-    while(*pucBuffer)
-    {
-        // Write the next character to the UART Tx FIFO.
-        UARTCharPut(UART_USB_BASE, *pucBuffer);
-        pucBuffer++;
+    uint16_t length = 0;
+
+    while (pucBuffer[length]) {
+        length++;
+    }
+    UARTSendBytes((const uint8_t*)pucBuffer, length);
+}
+
+/** Returns the room left in the transmit ring, for senders that would rather wait than have a frame dropped
+@return the free bytes */
+uint16_t
+uartTxSpace (void)
+{
+    return (txTail - txHead - 1) & (UART_TX_BUFFER_SIZE - 1);
+}
+
+/** Returns the amount of strings dropped so far because the transmit ring was full
+@return the dropped string count */
+uint32_t
+uartDroppedFrames (void)
+{
+    return txDroppedFrames;
+}
+
+/** Reads the next received char without waiting
+@param c where to write the char
+@return false if there are no chars waiting */
+bool
+uartReadChar (char* c)
+{
+    if (rxTail == rxHead) {
+        return false;
+    }
+    *c = rxRing[rxTail];
+    rxTail = (rxTail + 1) & (UART_RX_BUFFER_SIZE - 1);
+    return true;
+}
+
+/** Returns the amount of received chars lost so far because the receive ring was full
+@return the lost char count */
+uint32_t
+uartRxOverflows (void)
+{
+    return rxOverflows;
+}
+
+/** Sends the baud rate offer, every rate the clock can make fastest first */
+void
+uartSendBaudOffer (void)
+{
+    char reply[UART_BAUD_OFFER_LENGTH];
+
+    baudHandshakeOffer(&baudHandshake, reply, sizeof(reply));
+    UARTSend(reply);
+}
+
+/** Takes the rate the host picked from the offer. The board acknowledges at the current rate then switches once
+the acknowledgement has gone out, a rate it doesn't offer is refused
+@param rate the baud rate */
+void
+uartBaudAccept (uint32_t rate)
+{
+    char reply[UART_BAUD_OFFER_LENGTH];
+    uint16_t length = 0;
+
+    // The acknowledgement is the last thing out at the old rate, queued past the switch that holds the rest back
+    baudHandshakeAccept(&baudHandshake, rate, reply, sizeof(reply));
+    while (reply[length]) {
+        length++;
     }
+    queueBytes((const uint8_t*)reply, length);
 }
 
+/** Confirms the new rate once the host's sync has arrived at it, a sync with no new rate waiting is refused */
+void
+uartBaudSync (void)
+{
+    char reply[UART_BAUD_OFFER_LENGTH];
 
+    baudHandshakeSync(&baudHandshake, reply, sizeof(reply));
+    UARTSend(reply);
+}
+
+/** Runs the rate switch, the switch happens once the transmit ring has drained and the rate falls back to BAUD_RATE
+if the host doesn't confirm it in time
+@param dtMs the time since the last call in milliseconds */
+void
+uartBaudTick (uint32_t dtMs)
+{
+    uint32_t rate = baudHandshakeTick(&baudHandshake, txTail == txHead && !UARTBusy(UART_USB_BASE), dtMs);
+
+    if (rate != 0) {
+        configureBaudRate(rate);
+    }
+}
+
+/** Returns the rate the link is running at
+@return the baud rate */
+uint32_t
+uartGetBaudRate (void)
+{
+    return baudHandshake.rate;
+}
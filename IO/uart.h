@@ -23,9 +23,16 @@
 #define SYSTICK_RATE_HZ 100
 #define SLOWTICK_RATE_HZ 4
 #define MAX_STR_LEN 16
+#define UART_RX_BUFFER_SIZE 64 // the receive ring, a power of two. Holds a few command lines between reads
+#define UART_TX_BUFFER_SIZE 512 // the transmit ring, a power of two. Holds a whole status report
 //---USB Serial comms: UART0, Rx:PA0 , Tx:PA1
-#define BAUD_RATE 9600
+#define BAUD_RATE 9600 // the rate the link starts at, the host can move it faster with the BAUD handshake
+#define UART_BAUD_MAX_ERROR_PERMILLE 20 // the furthest a rate can be from the asked rate and still be offered
+#define UART_BAUD_SYNC_TIMEOUT_MS 1000 // the time the host has to confirm a new rate before it is dropped
+#define UART_BAUD_OFFER_LENGTH 128 // fits the offer with every rate in it
 #define UART_USB_BASE           UART0_BASE
+#define UART_USB_INT            INT_UART0
+#define UART_USB_PRIORITY       160 // above the control loop, the handler only moves a few chars into the FIFO
 #define UART_USB_PERIPH_UART    SYSCTL_PERIPH_UART0
 #define UART_USB_PERIPH_GPIO    SYSCTL_PERIPH_GPIOA
 #define UART_USB_GPIO_BASE      GPIO_PORTA_BASE
@@ -33,6 +40,8 @@
 #define UART_USB_GPIO_PIN_TX    GPIO_PIN_1
 #define UART_USB_GPIO_PINS      UART_USB_GPIO_PIN_RX | UART_USB_GPIO_PIN_TX
 
+enum uartBaudStates {UART_BAUD_FIXED = 0, UART_BAUD_SWITCHING, UART_BAUD_VERIFYING}; // the rate handshake progress
+
 //********************************************************
 // Prototypes
 //********************************************************
@@ -41,10 +50,65 @@
 void
 initUart (void);
 
-/** Transmit a string via UART0
+/** Queues bytes to transmit via UART0 without waiting. The bytes are dropped whole if the transmit ring can't
+hold all of them
+@param data the bytes to send
+@param length the amount of bytes */
+void
+UARTSendBytes (const uint8_t* data, uint16_t length);
+
+/** Queues a string to transmit via UART0 without waiting. The string is dropped whole if the transmit ring can't
+hold all of it
 @param a char to send to the UART response */
 void
 UARTSend (char *pucBuffer);
 
+/** Returns the room left in the transmit ring, for senders that would rather wait than have a frame dropped
+@return the free bytes */
+uint16_t
+uartTxSpace (void);
+
+/** Returns the amount of strings dropped so far because the transmit ring was full
+@return the dropped string count */
+uint32_t
+uartDroppedFrames (void);
+
+/** Reads the next received char without waiting
+@param c where to write the char
+@return false if there are no chars waiting */
+bool
+uartReadChar (char* c);
+
+/** Returns the amount of received chars lost so far because the receive ring was full
+@return the lost char count */
+uint32_t
+uartRxOverflows (void);
+
+
+/** Sends the baud rate offer, every rate the clock can make fastest first */
+void
+uartSendBaudOffer (void);
+
+/** Takes the rate the host picked from the offer. The board acknowledges at the current rate then switches once
+the acknowledgement has gone out, a rate it doesn't offer is refused
+@param rate the baud rate */
+void
+uartBaudAccept (uint32_t rate);
+
+/** Confirms the new rate once the host's sync has arrived at it, a sync with no new rate waiting is refused */
+void
+uartBaudSync (void);
+
+/** Runs the rate switch, the switch happens once the transmit ring has drained and the rate falls back to BAUD_RATE
+if the host doesn't confirm it in time
+@param dtMs the time since the last call in milliseconds */
+void
+uartBaudTick (uint32_t dtMs);
+
+/** Returns the rate the link is running at
+@return the baud rate */
+uint32_t
+uartGetBaudRate (void);
+
 
 #endif /* IO_UART_H_ */
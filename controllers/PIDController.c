@@ -14,25 +14,17 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-// driver libraries & OLED Interface
-#include "inc/hw_memmap.h"
-#include "inc/hw_types.h"
-#include "driverlib/adc.h"
-#include "driverlib/gpio.h"
-#include "driverlib/sysctl.h"
-#include "driverlib/systick.h"
-#include "driverlib/interrupt.h"
-#include "driverlib/debug.h"
-#include "utils/ustdlib.h"
-
 // Other
 #include "PIDController.h"
 #include "../IO/uart.h"
 
 #define MAX_ERROR_SUM 100  // Controls the percentage max error sum
+#define PID_MAX_DT_US 20000 // Longer dts are clamped so a late update can't overflow the integral step
+#define PID_FILTER_SCALE 256 // The resolution of the derivative filter coefficient
+#define PID_TERM_LIMIT 1000000 // Each response term is held inside this, far past full response, so the filter and sum can't overflow
 
-static int32_t maxErrorSum = MAX_ERROR_SUM * CONTROLLER_RESPONSE_SCALE; // Defines the max error sum but in terms of the controller response
-                                                                        // scale.
+static int32_t maxErrorSum = MAX_ERROR_SUM * CONTROLLER_RESPONSE_SCALE * PID_INTEGRAL_FRACTION; // Defines the max integral sum but in terms
+                                                                                                  // of the controller response scale.
 
 
 // *******************************************************
@@ -40,62 +32,298 @@ static int32_t maxErrorSum = MAX_ERROR_SUM * CONTROLLER_RESPONSE_SCALE; // Defin
 // *******************************************************
 
 /**
- * Initializes the PID controller, given the controller entity, gains and controller rate.
+ * Saturates a response term worked out in 64 bits, so a large gain or error can't overflow the ISR's arithmetic.
+ *
+ * @param term (int64_t) The term.
+ * @param limit (int32_t) The largest magnitude the term may have.
+ * @return The term, clamped to +-limit. */
+static int32_t
+limitTerm(int64_t term, int32_t limit)
+{
+    if (term > limit) {
+        return limit;
+    } else if (term < -limit) {
+        return -limit;
+    }
+    return (int32_t)term;
+}
+
+/**
+ * Initializes the PID controller, given the controller entity and gains.
  * 
  * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
- * @param controllerRate (int32_t) This is the (expected) rate that the PID is called.
  * @param proportionalGain (int32_t) This is the Kp proportional gain for the PID.
  * @param intergralGain (int32_t) This is the Ki intergral gain for the PID.
  * @param derivativeGain (int32_t) This is the Kd derivative gain for the PID. */
 void
-controllerPIDInit(PIDController_t* controller, int32_t controllerRate, int32_t proportionalGain, int32_t integralGain, int32_t derivativeGain)
+controllerPIDInit(PIDController_t* controller, int32_t proportionalGain, int32_t integralGain, int32_t derivativeGain)
 {
-    controller->controllerRate = controllerRate;
-
     // Watcher knight gains
     controller->proportionalGain = proportionalGain;
     controller->derivativeGain = derivativeGain;
     controller->integralGain = integralGain;
 
 
+    // Setpoint weighting & derivative filter options
+    controller->proportionalWeight = PID_WEIGHT_FULL;
+    controller->derivativeWeight = 0;
+    controller->derivativeFilterUs = 0;
+    controller->antiWindupMode = PID_ANTIWINDUP_CLAMP;
+    controller->trackingTimeUs = 0;
+
     // Integral & derivative calculation requirements
-    controller->previousError = 0;
-    controller->errorSum = 0;
+    controller->previousProportionalInput = 0;
+    controller->previousDerivativeInput = 0;
+    controller->hasPreviousInput = false;
+    controller->filteredDerivative = 0;
+    controller->integralSum = 0;
+    controller->lastResponse = 0;
+    controller->lastDtUs = 0;
+    controller->saturation = 0;
+
+    // Unscaled until a schedule says otherwise
+    controller->baseGains.proportionalGain = proportionalGain;
+    controller->baseGains.integralGain = integralGain;
+    controller->baseGains.derivativeGain = derivativeGain;
+    controller->gainScale.proportionalGain = PID_GAIN_SCALE_FULL;
+    controller->gainScale.integralGain = PID_GAIN_SCALE_FULL;
+    controller->gainScale.derivativeGain = PID_GAIN_SCALE_FULL;
+
+    // Nothing staged yet
+    controller->stagedLive = 0;
+    controller->stagedSequence = 0;
+    controller->appliedSequence = 0;
 
 }
 
 /**
-* Returns the response values for the error affected by the PID.
+ * Sets the two degree of freedom options for the PID.
+ *
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param proportionalWeight (int32_t) The percentage of the setpoint used by the proportional term.
+ * @param derivativeWeight (int32_t) The percentage of the setpoint used by the derivative term, 0 for derivative-on-measurement.
+ * @param derivativeFilterUs (uint32_t) The derivative filter time constant in microseconds, 0 to disable the filter. */
+void
+controllerPIDSetOptions(PIDController_t* controller, int32_t proportionalWeight, int32_t derivativeWeight, uint32_t derivativeFilterUs)
+{
+    controller->proportionalWeight = proportionalWeight;
+    controller->derivativeWeight = derivativeWeight;
+    controller->derivativeFilterUs = derivativeFilterUs;
+
+    // The weighted input changes meaning, so don't take a derivative across the change
+    controller->hasPreviousInput = false;
+}
+
+/**
+ * Sets how the PID keeps the integral from winding up while the actuator is saturated.
+ *
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param antiWindupMode (uint8_t) One of antiWindupModes.
+ * @param trackingTimeUs (uint32_t) The back-calculation tracking time constant in microseconds, smaller unwinds faster. */
+void
+controllerPIDSetAntiWindup(PIDController_t* controller, uint8_t antiWindupMode, uint32_t trackingTimeUs)
+{
+    controller->antiWindupMode = antiWindupMode;
+    controller->trackingTimeUs = (trackingTimeUs > 0) ? trackingTimeUs : 1;
+    controller->saturation = 0;
+}
+
+/**
+ * Tells the PID what the actuator actually applied after the last response was saturated.
+ * Back-calculation bleeds the integral by (applied - response) * dt / Tt, conditional integration
+ * just remembers which way the actuator saturated so the next integral step can be skipped.
+ *
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param appliedResponse (int32_t) The response after the actuator limits, in the same scale as the returned response. */
+void
+controllerPIDActuatorFeedback(PIDController_t* controller, int32_t appliedResponse)
+{
+    int32_t saturationError = appliedResponse - controller->lastResponse;
+
+    if (saturationError < 0) {
+        controller->saturation = 1;
+    } else if (saturationError > 0) {
+        controller->saturation = -1;
+    } else {
+        controller->saturation = 0;
+    }
+
+    if (controller->antiWindupMode == PID_ANTIWINDUP_BACK_CALCULATION && saturationError != 0) {
+        controller->integralSum += saturationError
+                * (int32_t)(PID_INTEGRAL_FRACTION * controller->lastDtUs / controller->trackingTimeUs);
+
+        if (controller->integralSum > maxErrorSum) {
+            controller->integralSum = maxErrorSum;
+        } else if (controller->integralSum < -maxErrorSum) {
+            controller->integralSum = -maxErrorSum;
+        }
+    }
+}
+
+/**
+ * Changes the gains of a running PID without a bump in the response. The integral is shifted by the change in the
+ * proportional and derivative responses, the integral gain is applied before summing so it can change freely.
+ * Only call this from the control loop, use controllerPIDStageGains() from anywhere else.
+ *
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param gains (const PIDGains_t*) The new gains. */
+void
+controllerPIDSetGains(PIDController_t* controller, const PIDGains_t* gains)
+{
+    int32_t proportionalChange = gains->proportionalGain - controller->proportionalGain;
+    int32_t derivativeChange = 0;
+
+    // The derivative response is held already multiplied by the gain, so rescale it to the new gain
+    if (gains->derivativeGain != controller->derivativeGain && controller->derivativeGain != 0) {
+        derivativeChange = controller->filteredDerivative * gains->derivativeGain / controller->derivativeGain
+                - controller->filteredDerivative;
+        controller->filteredDerivative += derivativeChange;
+    }
+
+    if (proportionalChange != 0 || derivativeChange != 0) {
+        controller->integralSum -= (proportionalChange * controller->previousProportionalInput + derivativeChange)
+                * PID_INTEGRAL_FRACTION;
+
+        if (controller->integralSum > maxErrorSum) {
+            controller->integralSum = maxErrorSum;
+        } else if (controller->integralSum < -maxErrorSum) {
+            controller->integralSum = -maxErrorSum;
+        }
+    }
+
+    controller->proportionalGain = gains->proportionalGain;
+    controller->integralGain = gains->integralGain;
+    controller->derivativeGain = gains->derivativeGain;
+}
+
+/**
+ * Loads the base gains times the gain scale without a bump.
+ *
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct. */
+static void
+applyScaledGains(PIDController_t* controller)
+{
+    PIDGains_t scaled;
+
+    scaled.proportionalGain = controller->baseGains.proportionalGain * controller->gainScale.proportionalGain
+            / PID_GAIN_SCALE_FULL;
+    scaled.integralGain = controller->baseGains.integralGain * controller->gainScale.integralGain / PID_GAIN_SCALE_FULL;
+    scaled.derivativeGain = controller->baseGains.derivativeGain * controller->gainScale.derivativeGain
+            / PID_GAIN_SCALE_FULL;
+    controllerPIDSetGains(controller, &scaled);
+}
+
+/**
+ * Scales the base gains, for gain scheduling. The scaled gains are loaded without a bump, so this can be called
+ * every update. Only call this from the control loop.
+ *
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param scale (const PIDGains_t*) The scale of each gain in PID_GAIN_SCALE_FULLs. */
+void
+controllerPIDScaleGains(PIDController_t* controller, const PIDGains_t* scale)
+{
+    controller->gainScale = *scale;
+    applyScaledGains(controller);
+}
+
+/**
+ * Stages new base gains from outside the control loop, for live tuning. The set is written into the spare buffer and
+ * only then made live, so the control loop either sees the old set or the whole new one. A set staged before the last
+ * one was picked up replaces it.
+ *
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param gains (const PIDGains_t*) The new base gains. */
+void
+controllerPIDStageGains(PIDController_t* controller, const PIDGains_t* gains)
+{
+    uint8_t spare = controller->stagedLive ^ 1;
+
+    controller->stagedGains[spare] = *gains;
+    // The buffers are volatile, so the compiler keeps the copy ahead of the store that publishes it
+    controller->stagedLive = spare;
+    controller->stagedSequence++;
+}
+
+/**
+* Returns the response values for the setpoint and measurement affected by the PID.
+* The integral always acts on the full error, the proportional and derivative terms use the weighted setpoint.
 * 
 * @param controller (PIDController_t*) The pointer to the PID controller struct object.
-* @param error (int32_t) The error we use the calculate the response for it.
+* @param setpoint (int32_t) The target the controller is driving the measurement to.
+* @param measurement (int32_t) The current measured value, must be continuous (no wrapping).
+* @param dtUs (uint32_t) The measured time since the last update in microseconds.
 * @return The response given the error for the controller provided (with the defined gains within that controller) */
 int32_t
-returnNewResponse(PIDController_t* controller, int32_t error)
+returnNewResponse(PIDController_t* controller, int32_t setpoint, int32_t measurement, uint32_t dtUs)
 {
 
     int32_t propResponse = 0;
     int32_t derResponse = 0;
     int32_t intResponse = 0;
+    int32_t integralStep = 0;
+    int32_t error = setpoint - measurement;
+    int32_t derivativeInput = 0;
+    int32_t filterCoefficient = 0;
 
-    // Proportional response calculation
-    propResponse = controller->proportionalGain * error;
+    // Pick up newly staged gains before they are used
+    if (controller->stagedSequence != controller->appliedSequence) {
+        controller->appliedSequence = controller->stagedSequence;
+        controller->baseGains = controller->stagedGains[controller->stagedLive];
+        applyScaledGains(controller);
+    }
+
+    if (dtUs == 0) {
+        dtUs = 1;
+    } else if (dtUs > PID_MAX_DT_US) {
+        dtUs = PID_MAX_DT_US;
+    }
 
-    // Integral response calculation
-    if (controller->errorSum + error >= maxErrorSum) {
-        controller->errorSum = maxErrorSum;
-    } else if (controller->errorSum+error <= -maxErrorSum) {
-        controller->errorSum = -maxErrorSum;
+    // Proportional response calculation, on the weighted setpoint
+    controller->previousProportionalInput = setpoint * controller->proportionalWeight / PID_WEIGHT_FULL - measurement;
+    propResponse = limitTerm((int64_t)controller->proportionalGain * controller->previousProportionalInput, PID_TERM_LIMIT);
+
+    // Integral response calculation, the gain is applied before summing so it is weighted by the real dt. A step past
+    // twice the limit saturates the sum either way, so clamping it there changes nothing
+    integralStep = limitTerm((int64_t)controller->integralGain * error * dtUs / PID_INTEGRAL_DIVISOR, 2 * maxErrorSum);
+
+    // Conditional integration, don't integrate further into a saturated actuator
+    if (controller->antiWindupMode == PID_ANTIWINDUP_CONDITIONAL
+            && ((controller->saturation > 0 && integralStep > 0) || (controller->saturation < 0 && integralStep < 0))) {
+        integralStep = 0;
+    }
+
+    if (controller->integralSum + integralStep >= maxErrorSum) {
+        controller->integralSum = maxErrorSum;
+    } else if (controller->integralSum + integralStep <= -maxErrorSum) {
+        controller->integralSum = -maxErrorSum;
     } else {
-        controller->errorSum += error;
+        controller->integralSum += integralStep;
     }
 
-    intResponse = controller->integralGain * controller->errorSum  / (controller->controllerRate * 2);
+    intResponse = controller->integralSum / PID_INTEGRAL_FRACTION;
 
-    // Derivative response calculation
-    derResponse = controller->derivativeGain * (error - controller->previousError) * controller->controllerRate;
-    controller->previousError = error;
+    // Derivative response calculation, on the weighted setpoint so a setpoint step doesn't kick
+    derivativeInput = setpoint * controller->derivativeWeight / PID_WEIGHT_FULL - measurement;
+    if (!controller->hasPreviousInput) {
+        controller->previousDerivativeInput = derivativeInput;
+        controller->hasPreviousInput = true;
+    }
+
+    derResponse = limitTerm((int64_t)controller->derivativeGain * (derivativeInput - controller->previousDerivativeInput)
+            * (PID_DERIVATIVE_SCALE / (int32_t)dtUs), PID_TERM_LIMIT);
+    controller->previousDerivativeInput = derivativeInput;
+
+    // First order low pass filter on the derivative, coefficient = dt / (Tf + dt)
+    if (controller->derivativeFilterUs > 0) {
+        filterCoefficient = (int32_t)(dtUs * PID_FILTER_SCALE / (controller->derivativeFilterUs + dtUs));
+        controller->filteredDerivative += (derResponse - controller->filteredDerivative) * filterCoefficient / PID_FILTER_SCALE;
+        derResponse = controller->filteredDerivative;
+    } else {
+        controller->filteredDerivative = derResponse;
+    }
 
+    controller->lastResponse = propResponse + intResponse + derResponse;
+    controller->lastDtUs = dtUs;
 
-    return propResponse + intResponse + derResponse;
+    return controller->lastResponse;
 }
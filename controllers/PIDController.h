@@ -16,6 +16,23 @@
 #include "../circBufT.h"
 
 #define CONTROLLER_RESPONSE_SCALE 10 // A scaling factor to reduce the gains below 0 without using floats or doubles :)
+#define PID_INTEGRAL_FRACTION 10000 // The integral is held at this many times the response scale so small errors still accumulate
+#define PID_WEIGHT_FULL 100 // A setpoint weight of 100 percent, the whole setpoint is used
+#define PID_GAIN_SCALE_FULL 100 // A gain scale of 100 percent, the base gains are used as they are
+#define PID_GAIN_MAX 10000 // The largest gain accepted from outside, so unscaling and scaling it can't overflow
+
+// The gains were tuned with a fixed 10 Hz update, these keep them meaning the same thing with a measured dt
+#define PID_INTEGRAL_DIVISOR 600 // Ki * error * dt(us) / 600 is the integral response in PID_INTEGRAL_FRACTIONs
+#define PID_DERIVATIVE_SCALE 3000000 // Kd * change in error * 3000000 / dt(us) is the derivative response
+
+enum antiWindupModes {PID_ANTIWINDUP_CLAMP = 0, PID_ANTIWINDUP_BACK_CALCULATION, PID_ANTIWINDUP_CONDITIONAL}; // how the integral is kept from winding up
+
+
+typedef struct {
+    int32_t proportionalGain; // the scaling factor for the proportional gain
+    int32_t integralGain; // the scaling factor for the integral gain
+    int32_t derivativeGain; // the scaling factor for the derivative gain
+} PIDGains_t; // a set of gains that can be loaded into a PID controller
 
 
 typedef struct {
@@ -24,11 +41,33 @@ typedef struct {
     int32_t proportionalGain; // the scaling factor for the proportional gain
     int32_t derivativeGain; // the scaling factor for the derivative gain
     int32_t integralGain; // the scaling factor for the integral gain
-    int32_t controllerRate; // the rate at which the controller is recalculated
+
+    // Options
+    int32_t proportionalWeight; // the percentage of the setpoint the proportional term sees
+    int32_t derivativeWeight; // the percentage of the setpoint the derivative term sees, 0 is derivative-on-measurement
+    uint32_t derivativeFilterUs; // the time constant of the derivative low pass filter in microseconds, 0 disables it
+    uint8_t antiWindupMode; // the anti-windup mode from antiWindupModes
+    uint32_t trackingTimeUs; // the back-calculation tracking time constant in microseconds
 
     // Current values
-    int32_t previousError; // the error from the past calculation
-    int32_t errorSum; // the accumulated error for the system
+    int32_t previousProportionalInput; // the weighted error the proportional term used in the past calculation
+    int32_t previousDerivativeInput; // the weighted error the derivative was taken of in the past calculation
+    bool hasPreviousInput; // false until the first calculation so the derivative doesn't kick on start up
+    int32_t filteredDerivative; // the filtered derivative response
+    int32_t integralSum; // the accumulated integral response, in PID_INTEGRAL_FRACTIONs of the response
+    int32_t lastResponse; // the unsaturated response from the last calculation
+    uint32_t lastDtUs; // the dt used in the last calculation
+    int8_t saturation; // 1 if the actuator saturated high last update, -1 if it saturated low and 0 otherwise
+
+    // The gains above are the base gains times the gain scale, so a schedule can shape the staged gains
+    PIDGains_t baseGains; // the gains set at start up or last staged
+    PIDGains_t gainScale; // the scale of each gain in PID_GAIN_SCALE_FULLs, from the gain schedule
+
+    // Gains staged from outside the control loop, double buffered so a half written set is never picked up
+    volatile PIDGains_t stagedGains[2]; // the staged gain sets, the live one and the spare the next set is written into
+    volatile uint8_t stagedLive; // the staged set that is complete
+    volatile uint32_t stagedSequence; // bumped every time a new set is staged
+    uint32_t appliedSequence; // the staged set the controller last picked up
 
 } PIDController_t; // the PID controller that holds the necessary values for any controller
 
@@ -38,21 +77,75 @@ typedef struct {
 // *******************************************************
 
 /**
-* Returns the response values for the error affected by the PID.
+* Returns the response values for the setpoint and measurement affected by the PID.
+* The integral always acts on the full error, the proportional and derivative terms use the weighted setpoint.
 * @param controller (PIDController_t*) The pointer to the PID controller struct object.
-* @param error (int32_t) The error we use the calculate the response for it.
+* @param setpoint (int32_t) The target the controller is driving the measurement to.
+* @param measurement (int32_t) The current measured value, must be continuous (no wrapping).
+* @param dtUs (uint32_t) The measured time since the last update in microseconds.
 * @return The response given the error for the controller provided (with the defined gains within that controller) */
 int32_t
-returnNewResponse(PIDController_t* controller, int32_t error);
+returnNewResponse(PIDController_t* controller, int32_t setpoint, int32_t measurement, uint32_t dtUs);
 
 /**
- * Initializes the PID controller, given the controller entity, gains and controller rate.
+ * Initializes the PID controller, given the controller entity and gains.
  * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
- * @param controllerRate (int32_t) This is the (expected) rate that the PID is called.
  * @param proportionalGain (int32_t) This is the Kp proportional gain for the PID.
  * @param intergralGain (int32_t) This is the Ki intergral gain for the PID.
  * @param derivativeGain (int32_t) This is the Kd derivative gain for the PID. */
 void
-controllerPIDInit(PIDController_t* controller, int32_t controllerRate, int32_t proportionalGain, int32_t integralGain, int32_t derivativeGain);
+controllerPIDInit(PIDController_t* controller, int32_t proportionalGain, int32_t integralGain, int32_t derivativeGain);
+
+/**
+ * Sets the two degree of freedom options for the PID. controllerPIDInit() defaults to a full proportional setpoint weight,
+ * derivative-on-measurement and no derivative filter.
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param proportionalWeight (int32_t) The percentage of the setpoint used by the proportional term.
+ * @param derivativeWeight (int32_t) The percentage of the setpoint used by the derivative term, 0 for derivative-on-measurement.
+ * @param derivativeFilterUs (uint32_t) The derivative filter time constant in microseconds, 0 to disable the filter. */
+void
+controllerPIDSetOptions(PIDController_t* controller, int32_t proportionalWeight, int32_t derivativeWeight, uint32_t derivativeFilterUs);
+
+/**
+ * Sets how the PID keeps the integral from winding up while the actuator is saturated. controllerPIDInit() defaults to
+ * only clamping the integral.
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param antiWindupMode (uint8_t) One of antiWindupModes.
+ * @param trackingTimeUs (uint32_t) The back-calculation tracking time constant in microseconds, smaller unwinds faster. */
+void
+controllerPIDSetAntiWindup(PIDController_t* controller, uint8_t antiWindupMode, uint32_t trackingTimeUs);
+
+/**
+ * Tells the PID what the actuator actually applied after the last response was saturated. Call after every
+ * returnNewResponse() so the anti-windup can act on the saturation.
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param appliedResponse (int32_t) The response after the actuator limits, in the same scale as the returned response. */
+void
+controllerPIDActuatorFeedback(PIDController_t* controller, int32_t appliedResponse);
+
+/**
+ * Changes the gains of a running PID without a bump in the response. The integral is shifted by the change in the
+ * proportional and derivative responses, the integral gain is applied before summing so it can change freely.
+ * Only call this from the control loop, use controllerPIDStageGains() from anywhere else.
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param gains (const PIDGains_t*) The new gains. */
+void
+controllerPIDSetGains(PIDController_t* controller, const PIDGains_t* gains);
+
+/**
+ * Scales the base gains, for gain scheduling. The scaled gains are loaded without a bump, so this can be called
+ * every update. Only call this from the control loop.
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param scale (const PIDGains_t*) The scale of each gain in PID_GAIN_SCALE_FULLs. */
+void
+controllerPIDScaleGains(PIDController_t* controller, const PIDGains_t* scale);
+
+/**
+ * Stages new base gains from outside the control loop, for live tuning. The set is written into the spare buffer and
+ * only then made live, returnNewResponse() picks it up bumplessly on its next update with the current gain scale.
+ * @param controller (PIDController_t*) This is a pointer to the PID controller struct.
+ * @param gains (const PIDGains_t*) The new gains. */
+void
+controllerPIDStageGains(PIDController_t* controller, const PIDGains_t* gains);
 
 #endif /* PIDCONTROLLER_H_ */
@@ -0,0 +1,150 @@
+// *******************************************************
+//
+// carrierSweep.c
+//
+//  This steps the rotor pwm carrier through every allowed frequency and measures the altitude noise at each, to find
+//  the carrier that interferes least with the height ADC on a rig.
+//
+//  Each carrier is left to settle, then the altitude is sampled every control loop iteration and the noise is taken
+//  as its RMS deviation from the mean. Fly a steady hover for the whole sweep so the noise is the carrier's and not
+//  the helicopter moving.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "carrierSweep.h"
+#include "../IO/pwm.h"
+
+#define NOISE_SCALE 100 // the noise is reported in hundredths of a permille
+
+
+/** Returns the integer square root, rounded down
+@param value the value
+@return the square root */
+static uint32_t
+squareRoot(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/** Starts measuring a carrier frequency
+@param sweep the sweep
+@param frequency the carrier frequency in Hz */
+static void
+startCarrier(carrierSweep_t* sweep, uint32_t frequency)
+{
+    sweep->frequency = frequency;
+    sweep->elapsedUs = 0;
+    sweep->sum = 0;
+    sweep->sumSquares = 0;
+    sweep->samples = 0;
+    pwmSetFrequency(frequency);
+}
+
+/** Initialises a sweep that isn't running
+@param sweep the sweep */
+void
+initCarrierSweep(carrierSweep_t* sweep)
+{
+    sweep->state = CARRIER_SWEEP_IDLE;
+    sweep->hasResult = false;
+}
+
+/** Starts a sweep from PWM_RATE_MIN_HZ up to PWM_RATE_MAX_HZ
+@param sweep the sweep */
+void
+carrierSweepStart(carrierSweep_t* sweep)
+{
+    if (sweep->state == CARRIER_SWEEP_RUNNING) {
+        return;
+    }
+
+    sweep->restoreFrequency = pwmGetFrequency();
+    startCarrier(sweep, PWM_RATE_MIN_HZ);
+    sweep->state = CARRIER_SWEEP_RUNNING; // set last, the control loop picks the sweep up from here
+}
+
+/** Measures the altitude at the current carrier and moves on to the next once it has been measured for long enough,
+called every control loop iteration
+@param sweep the sweep
+@param altitude the altitude in permille
+@param dtUs the measured time since the last update in microseconds */
+void
+carrierSweepUpdate(carrierSweep_t* sweep, int32_t altitude, uint32_t dtUs)
+{
+    int32_t deviation;
+    int64_t variance;
+
+    if (sweep->state != CARRIER_SWEEP_RUNNING) {
+        return;
+    }
+
+    sweep->elapsedUs += dtUs;
+    if (sweep->elapsedUs <= CARRIER_SWEEP_SETTLE_US) {
+        return;
+    }
+
+    if (sweep->samples == 0) {
+        sweep->firstAltitude = altitude;
+    }
+    deviation = altitude - sweep->firstAltitude;
+    sweep->sum += deviation;
+    sweep->sumSquares += (int64_t)deviation * deviation;
+    sweep->samples++;
+
+    if (sweep->elapsedUs < CARRIER_SWEEP_SETTLE_US + CARRIER_SWEEP_MEASURE_US) {
+        return;
+    }
+
+    // n * variance = sum of squares - sum^2 / n, scaled up before the root so the noise keeps two decimal places
+    variance = (int64_t)sweep->sumSquares - (int64_t)sweep->sum * sweep->sum / (int64_t)sweep->samples;
+    if (variance < 0) {
+        variance = 0;
+    }
+    sweep->result.frequency = sweep->frequency;
+    sweep->result.noise = squareRoot((uint64_t)variance * NOISE_SCALE * NOISE_SCALE / sweep->samples);
+    sweep->hasResult = true;
+
+    if (sweep->frequency + PWM_RATE_STEP_HZ <= PWM_RATE_MAX_HZ) {
+        startCarrier(sweep, sweep->frequency + PWM_RATE_STEP_HZ);
+    } else {
+        pwmSetFrequency(sweep->restoreFrequency);
+        sweep->state = CARRIER_SWEEP_DONE;
+    }
+}
+
+/** Copies out the noise at the last carrier measured, each carrier is only read once
+@param sweep the sweep
+@param result the struct to write the result into
+@return true if a carrier has been measured since the last read */
+bool
+readCarrierSweep(carrierSweep_t* sweep, carrierSweepResult_t* result)
+{
+    if (!sweep->hasResult) {
+        return false;
+    }
+
+    *result = sweep->result;
+    sweep->hasResult = false;
+    return true;
+}
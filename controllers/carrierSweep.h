@@ -0,0 +1,75 @@
+// *******************************************************
+//
+// carrierSweep.h
+//
+//  This steps the rotor pwm carrier through every allowed frequency and measures the altitude noise at each, to find
+//  the carrier that interferes least with the height ADC on a rig.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef CARRIERSWEEP_H_
+#define CARRIERSWEEP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CARRIER_SWEEP_SETTLE_US 1000000 // the time each carrier runs before its noise is measured
+#define CARRIER_SWEEP_MEASURE_US 2000000 // the time the noise is measured over at each carrier
+
+enum carrierSweepStates {CARRIER_SWEEP_IDLE = 0, CARRIER_SWEEP_RUNNING, CARRIER_SWEEP_DONE}; // the sweep progress
+
+typedef struct {
+    uint32_t frequency; // the carrier frequency in Hz
+    uint32_t noise; // the RMS altitude deviation from its mean in hundredths of a permille
+} carrierSweepResult_t; // the noise at one carrier frequency
+
+
+typedef struct {
+
+    volatile uint8_t state; // the progress from carrierSweepStates
+    uint32_t restoreFrequency; // the carrier from before the sweep, set back once it finishes
+
+    // Carrier being measured
+    uint32_t frequency; // the carrier frequency in Hz
+    uint32_t elapsedUs; // the time the carrier has been running
+    int32_t firstAltitude; // the first altitude measured, the sums are taken about this to keep them small
+    int32_t sum; // the sum of the altitude deviations
+    uint64_t sumSquares; // the sum of the squared altitude deviations
+    uint32_t samples; // the number of altitudes measured
+
+    // Finished carrier
+    carrierSweepResult_t result; // the noise at the last carrier measured
+    volatile bool hasResult; // true until the finished carrier has been read
+
+} carrierSweep_t; // the carrier frequency sweep
+
+
+/** Initialises a sweep that isn't running
+@param sweep the sweep */
+void
+initCarrierSweep(carrierSweep_t* sweep);
+
+/** Starts a sweep from PWM_RATE_MIN_HZ up to PWM_RATE_MAX_HZ
+@param sweep the sweep */
+void
+carrierSweepStart(carrierSweep_t* sweep);
+
+/** Measures the altitude at the current carrier and moves on to the next once it has been measured for long enough,
+called every control loop iteration
+@param sweep the sweep
+@param altitude the altitude in permille
+@param dtUs the measured time since the last update in microseconds */
+void
+carrierSweepUpdate(carrierSweep_t* sweep, int32_t altitude, uint32_t dtUs);
+
+/** Copies out the noise at the last carrier measured, each carrier is only read once
+@param sweep the sweep
+@param result the struct to write the result into
+@return true if a carrier has been measured since the last read */
+bool
+readCarrierSweep(carrierSweep_t* sweep, carrierSweepResult_t* result);
+
+#endif /* CARRIERSWEEP_H_ */
@@ -0,0 +1,70 @@
+// *******************************************************
+//
+// cascadeController.c
+//
+//  This runs altitude as a cascade, an outer loop turning the altitude error into a climb rate command and a
+//  faster inner loop tracking that climb rate. Yaw can be built with it too, in degrees and degrees per second.
+//
+//  The inner loop closes around the rotor's integrator-like thrust to climb rate behaviour, so the outer loop sees a
+//  well damped climb rate servo instead of the raw plant. The climb rate command is limited, and the outer loop is
+//  told about the limit through its own anti-windup feedback.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cascadeController.h"
+
+
+/** Initialises both loops of the cascade
+@param controller the cascade
+@param outerGains the outer loop gains, climb rate in percent per second per percent of error
+@param innerGains the inner loop gains, response per percent per second of climb rate error
+@param maxRate the fastest climb or descent to command in percent per second */
+void
+cascadeInit(cascadeController_t* controller, const PIDGains_t* outerGains, const PIDGains_t* innerGains, int32_t maxRate)
+{
+    controllerPIDInit(&controller->outer, outerGains->proportionalGain, outerGains->integralGain, outerGains->derivativeGain);
+    controllerPIDInit(&controller->inner, innerGains->proportionalGain, innerGains->integralGain, innerGains->derivativeGain);
+    controllerPIDSetAntiWindup(&controller->outer, PID_ANTIWINDUP_CONDITIONAL, 0);
+    controllerPIDSetAntiWindup(&controller->inner, PID_ANTIWINDUP_CONDITIONAL, 0);
+
+    controller->maxRate = maxRate;
+    controller->rateCommand = 0;
+}
+
+/** Returns the rotor response from the cascade
+@param controller the cascade
+@param setpoint the altitude target in percent
+@param measurement the altitude in percent
+@param rate the estimated climb rate in percent per second
+@param dtUs the measured time since the last update in microseconds
+@return the response for the main rotor */
+int32_t
+cascadeResponse(cascadeController_t* controller, int32_t setpoint, int32_t measurement, int32_t rate, uint32_t dtUs)
+{
+    int32_t rateCommand = returnNewResponse(&controller->outer, setpoint, measurement, dtUs);
+
+    if (rateCommand > controller->maxRate) {
+        rateCommand = controller->maxRate;
+    } else if (rateCommand < -controller->maxRate) {
+        rateCommand = -controller->maxRate;
+    }
+    controllerPIDActuatorFeedback(&controller->outer, rateCommand);
+    controller->rateCommand = rateCommand;
+
+    return returnNewResponse(&controller->inner, rateCommand, rate, dtUs);
+}
+
+/** Passes what the rotor actually applied to the inner loop anti-windup
+@param controller the cascade
+@param appliedResponse the response after the actuator limits */
+void
+cascadeActuatorFeedback(cascadeController_t* controller, int32_t appliedResponse)
+{
+    controllerPIDActuatorFeedback(&controller->inner, appliedResponse);
+}
@@ -0,0 +1,53 @@
+// *******************************************************
+//
+// cascadeController.h
+//
+//  This runs altitude as a cascade, an outer loop turning the altitude error into a climb rate command and a
+//  faster inner loop tracking that climb rate. Yaw can be built with it too, in degrees and degrees per second.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef CASCADECONTROLLER_H_
+#define CASCADECONTROLLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "PIDController.h"
+
+typedef struct {
+    PIDController_t outer; // turns the altitude error into a climb rate command in percent per second
+    PIDController_t inner; // turns the climb rate error into the rotor response
+    int32_t maxRate; // the fastest climb or descent the outer loop can command in percent per second
+    int32_t rateCommand; // the last climb rate command after limiting
+} cascadeController_t; // an altitude controller with a climb rate inner loop
+
+
+/** Initialises both loops of the cascade
+@param controller the cascade
+@param outerGains the outer loop gains, climb rate in percent per second per percent of error
+@param innerGains the inner loop gains, response per percent per second of climb rate error
+@param maxRate the fastest climb or descent to command in percent per second */
+void
+cascadeInit(cascadeController_t* controller, const PIDGains_t* outerGains, const PIDGains_t* innerGains, int32_t maxRate);
+
+/** Returns the rotor response from the cascade
+@param controller the cascade
+@param setpoint the altitude target in percent
+@param measurement the altitude in percent
+@param rate the estimated climb rate in percent per second
+@param dtUs the measured time since the last update in microseconds
+@return the response for the main rotor */
+int32_t
+cascadeResponse(cascadeController_t* controller, int32_t setpoint, int32_t measurement, int32_t rate, uint32_t dtUs);
+
+/** Passes what the rotor actually applied to the inner loop anti-windup
+@param controller the cascade
+@param appliedResponse the response after the actuator limits */
+void
+cascadeActuatorFeedback(cascadeController_t* controller, int32_t appliedResponse);
+
+#endif /* CASCADECONTROLLER_H_ */
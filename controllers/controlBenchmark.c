@@ -0,0 +1,168 @@
+// *******************************************************
+//
+// controlBenchmark.c
+//
+//  This records a window of real control loop inputs in flight and times every control law over the same inputs.
+//
+//  The recording starts when armed, normally on a target change so the window holds a step, and fills at the loop
+//  rate. Once full the background loop runs fresh copies of each law over it, timing every response with the
+//  loop timer's free running timestamp. Interrupts are held off around each timed call so the control loop can't
+//  land inside a measurement.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverlib/interrupt.h"
+
+#include "controlBenchmark.h"
+#include "loopTimer.h"
+
+enum benchmarkStates {BENCHMARK_IDLE = 0, BENCHMARK_RECORDING, BENCHMARK_RECORDED, BENCHMARK_DONE}; // the recording progress
+
+static const controlConfig_t* altBenchmarkConfig; // the altitude config the laws are built from
+static const controlConfig_t* yawBenchmarkConfig; // the yaw config the laws are built from
+
+static controlState_t recordedInputs[CONTROL_BENCHMARK_SAMPLES]; // the recorded control loop inputs
+static uint32_t recordedDts[CONTROL_BENCHMARK_SAMPLES]; // the recorded dts in microseconds
+static volatile uint16_t recordedCount; // how many iterations have been recorded
+static volatile uint8_t benchmarkState = BENCHMARK_IDLE; // the recording progress
+
+static benchmarkResult_t results[CONTROL_BENCHMARK_LAWS]; // the timing of each law
+static uint32_t timestampOverhead; // the cycles taken by reading the timestamp, taken off each measurement
+
+
+/** Adds one timed call to a result
+@param result the result being built
+@param start the timestamp before the call
+@param end the timestamp after the call */
+static void
+addTiming(benchmarkResult_t* result, uint32_t start, uint32_t end)
+{
+    uint32_t cycles = end - start;
+
+    cycles = (cycles > timestampOverhead) ? cycles - timestampOverhead : 0;
+    result->averageCycles += cycles;
+    if (cycles > result->maxCycles) {
+        result->maxCycles = cycles;
+    }
+}
+
+// Each law gets its own function so its calls are direct, the same as in the control loop
+#define BENCHMARK_LAW(name, type, strategy) \
+static void \
+name(benchmarkResult_t* result) \
+{ \
+    static type altLaw; \
+    static type yawLaw; \
+    uint32_t start; \
+    uint16_t i; \
+    \
+    strategy##Init(&altLaw, CONTROL_AXIS_ALT, altBenchmarkConfig); \
+    strategy##Init(&yawLaw, CONTROL_AXIS_YAW, yawBenchmarkConfig); \
+    result->averageCycles = 0; \
+    result->maxCycles = 0; \
+    \
+    for (i = 0; i < CONTROL_BENCHMARK_SAMPLES; i++) { \
+        IntMasterDisable(); \
+        start = loopTimerTimestamp(); \
+        strategy##Response(&altLaw, CONTROL_AXIS_ALT, &recordedInputs[i], recordedDts[i]); \
+        addTiming(result, start, loopTimerTimestamp()); \
+        start = loopTimerTimestamp(); \
+        strategy##Response(&yawLaw, CONTROL_AXIS_YAW, &recordedInputs[i], recordedDts[i]); \
+        addTiming(result, start, loopTimerTimestamp()); \
+        IntMasterEnable(); \
+    } \
+    result->averageCycles /= CONTROL_BENCHMARK_SAMPLES * 2; \
+}
+
+BENCHMARK_LAW(benchmarkIntPID, PIDController_t, intPIDStrategy)
+BENCHMARK_LAW(benchmarkFloatPID, floatPIDController_t, floatPIDStrategy)
+BENCHMARK_LAW(benchmarkCascade, cascadeController_t, cascadeStrategy)
+BENCHMARK_LAW(benchmarkStateSpace, stateSpaceController_t, stateSpaceStrategy)
+
+
+/** Initialises the benchmark with the configs the laws are built from
+@param altConfig the altitude axis config
+@param yawConfig the yaw axis config */
+void
+initControlBenchmark(const controlConfig_t* altConfig, const controlConfig_t* yawConfig)
+{
+    altBenchmarkConfig = altConfig;
+    yawBenchmarkConfig = yawConfig;
+    recordedCount = 0;
+    benchmarkState = BENCHMARK_IDLE;
+}
+
+/** Starts recording from the next control loop iteration, ignored once a recording has been taken */
+void
+controlBenchmarkArm(void)
+{
+    if (benchmarkState == BENCHMARK_IDLE) {
+        recordedCount = 0;
+        benchmarkState = BENCHMARK_RECORDING;
+    }
+}
+
+/** Records the control loop inputs while armed, called every control loop iteration
+@param input the inputs the control laws were given
+@param dtUs the measured time since the last update in microseconds */
+void
+controlBenchmarkRecord(const controlState_t* input, uint32_t dtUs)
+{
+    if (benchmarkState != BENCHMARK_RECORDING) {
+        return;
+    }
+
+    recordedInputs[recordedCount] = *input;
+    recordedDts[recordedCount] = dtUs;
+    recordedCount++;
+
+    if (recordedCount >= CONTROL_BENCHMARK_SAMPLES) {
+        benchmarkState = BENCHMARK_RECORDED;
+    }
+}
+
+/** Times every law over the recording once it is full, called from the background loop
+@return true if the benchmark ran on this call */
+bool
+controlBenchmarkUpdate(void)
+{
+    uint32_t start;
+
+    if (benchmarkState != BENCHMARK_RECORDED) {
+        return false;
+    }
+
+    // The cost of the timestamp reads themselves
+    IntMasterDisable();
+    start = loopTimerTimestamp();
+    timestampOverhead = loopTimerTimestamp() - start;
+    IntMasterEnable();
+
+    benchmarkIntPID(&results[CONTROL_STRATEGY_INT_PID]);
+    benchmarkFloatPID(&results[CONTROL_STRATEGY_FLOAT_PID]);
+    benchmarkCascade(&results[CONTROL_STRATEGY_CASCADE]);
+    benchmarkStateSpace(&results[CONTROL_STRATEGY_STATE_SPACE]);
+
+    benchmarkState = BENCHMARK_DONE;
+    return true;
+}
+
+/** Reads the timing of one law
+@param law the law from CONTROL_STRATEGY_*
+@param result the struct to write the timing into
+@return true if the benchmark has run */
+bool
+readControlBenchmark(uint8_t law, benchmarkResult_t* result)
+{
+    if (benchmarkState != BENCHMARK_DONE || law >= CONTROL_BENCHMARK_LAWS) {
+        return false;
+    }
+
+    *result = results[law];
+    return true;
+}
@@ -0,0 +1,57 @@
+// *******************************************************
+//
+// controlBenchmark.h
+//
+//  This records a window of real control loop inputs in flight and times every control law over the same inputs.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef CONTROLBENCHMARK_H_
+#define CONTROLBENCHMARK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "controlStrategy.h"
+
+#define CONTROL_BENCHMARK_SAMPLES 64 // the recorded loop iterations, 128 ms at 500 Hz
+#define CONTROL_BENCHMARK_LAWS 4 // one result per CONTROL_STRATEGY_*
+
+typedef struct {
+    uint32_t averageCycles; // the average clock cycles per response, both axes
+    uint32_t maxCycles; // the most clock cycles any one response took
+} benchmarkResult_t; // the timing of one control law
+
+
+/** Initialises the benchmark with the configs the laws are built from
+@param altConfig the altitude axis config
+@param yawConfig the yaw axis config */
+void
+initControlBenchmark(const controlConfig_t* altConfig, const controlConfig_t* yawConfig);
+
+/** Starts recording from the next control loop iteration, ignored once a recording has been taken */
+void
+controlBenchmarkArm(void);
+
+/** Records the control loop inputs while armed, called every control loop iteration
+@param input the inputs the control laws were given
+@param dtUs the measured time since the last update in microseconds */
+void
+controlBenchmarkRecord(const controlState_t* input, uint32_t dtUs);
+
+/** Times every law over the recording once it is full, called from the background loop
+@return true if the benchmark ran on this call */
+bool
+controlBenchmarkUpdate(void);
+
+/** Reads the timing of one law
+@param law the law from CONTROL_STRATEGY_*
+@param result the struct to write the timing into
+@return true if the benchmark has run */
+bool
+readControlBenchmark(uint8_t law, benchmarkResult_t* result);
+
+#endif /* CONTROLBENCHMARK_H_ */
@@ -0,0 +1,378 @@
+// *******************************************************
+//
+// controlStrategy.h
+//
+//  This selects the control law each axis is built with. Every law is wrapped in the same set of static inline
+//  functions and each axis maps its names onto one set with macros, so the control loop calls the selected law
+//  directly with no function pointer. Select a law with -DALT_CONTROL_STRATEGY=... or -DYAW_CONTROL_STRATEGY=...
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef CONTROLSTRATEGY_H_
+#define CONTROLSTRATEGY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "PIDController.h"
+#include "floatPIDController.h"
+#include "cascadeController.h"
+#include "stateSpaceController.h"
+
+#define CONTROL_STRATEGY_INT_PID 0 // the fixed point PID
+#define CONTROL_STRATEGY_FLOAT_PID 1 // the floating point PID
+#define CONTROL_STRATEGY_CASCADE 2 // the position PID feeding a rate PID
+#define CONTROL_STRATEGY_STATE_SPACE 3 // the axis' row of the full state feedback
+
+#ifndef ALT_CONTROL_STRATEGY
+#define ALT_CONTROL_STRATEGY CONTROL_STRATEGY_INT_PID
+#endif
+#ifndef YAW_CONTROL_STRATEGY
+#define YAW_CONTROL_STRATEGY CONTROL_STRATEGY_INT_PID
+#endif
+
+// The axes are the state-space inputs, the position and rate of an axis are next to each other in the state vector
+#define CONTROL_AXIS_ALT SS_MAIN_ROTOR
+#define CONTROL_AXIS_YAW SS_TAIL_ROTOR
+#define CONTROL_POSITION_STATE(axis) ((axis) * 2)
+#define CONTROL_RATE_STATE(axis) ((axis) * 2 + 1)
+
+// The climb rate is estimated from the altitude in permille, so it is held in permille per second to keep that
+// resolution. Rates on the other axes are in the position's own unit per second
+#define CONTROL_ALT_RATE_SCALE 10
+#define CONTROL_RATE_SCALE(axis) (((axis) == CONTROL_AXIS_ALT) ? CONTROL_ALT_RATE_SCALE : 1)
+
+
+typedef struct {
+    int32_t reference[SS_NUM_STATES]; // the profiled targets and their rates, yaw continuous
+    int32_t state[SS_NUM_STATES]; // the measured altitude, climb rate, continuous yaw and yaw rate
+} controlState_t; // the inputs every control law is given, the rates scaled by CONTROL_RATE_SCALE
+
+typedef struct {
+    int32_t proportional; // the proportional response
+    int32_t integral; // the integrator state as a response
+    int32_t derivative; // the filtered derivative response
+} controlTerms_t; // the last response of a law split into its terms
+
+
+typedef struct {
+
+    // PIDs
+    PIDGains_t gains; // the PID gains
+    int32_t proportionalWeight; // the percentage of the setpoint the proportional term sees, always full on yaw
+    int32_t derivativeWeight; // the percentage of the setpoint the derivative term sees
+    uint32_t derivativeFilterUs; // the derivative filter time constant in microseconds
+    uint8_t antiWindupMode; // the anti-windup mode from antiWindupModes
+    uint32_t trackingTimeUs; // the back-calculation tracking time constant in microseconds
+
+    // Cascade
+    PIDGains_t outerGains; // the position loop gains, rate per unit of position error
+    PIDGains_t innerGains; // the rate loop gains, response per unit of rate error
+    int32_t maxRate; // the fastest rate the position loop can command
+
+    // State feedback
+    const int16_t (*stateSpaceGains)[SS_NUM_STATES]; // the Q15 gain matrix, both rows
+    uint8_t stateSpaceGainShift; // the power of two the gains are scaled by
+    const int32_t* stateSpaceTrim; // the trim responses, both inputs
+
+} controlConfig_t; // the settings for whichever law an axis is built with
+
+
+// The yaw setpoint is the unwrapped angle, so a proportional setpoint weight would act on every turn flown and not
+// just the last step. The PIDs always use the full setpoint on the yaw axis, the derivative weight is unaffected as it
+// only sees changes.
+#define CONTROL_PROPORTIONAL_WEIGHT(axis, config) \
+    (((axis) == CONTROL_AXIS_YAW) ? PID_WEIGHT_FULL : (config)->proportionalWeight)
+
+// Every law provides the same functions, called through ALT_STRATEGY(name) and YAW_STRATEGY(name):
+//  Init(controller, axis, config)             sets the law up from the axis' config
+//  Response(controller, axis, input, dtUs)    returns the rotor response for the axis
+//  Feedback(controller, appliedResponse)      passes the saturated response back for the anti-windup
+//  ScaleGains(controller, scale)              scales the PID gains from the gain schedule without a bump
+//  StageGains(controller, gains)              stages tuned or commanded base PID gains from outside the control loop
+//  Restart(controller)                        drops the derivative history after another law drove the rotor
+//  LastResponse(controller, axis)             returns the last response, the bias for the relay auto-tune
+//  Terms(controller, axis, terms)             splits the last response into its terms, for the flight recorder
+
+// *******************************************************
+// Integer PID
+// *******************************************************
+
+static inline void
+intPIDStrategyInit(PIDController_t* controller, uint8_t axis, const controlConfig_t* config)
+{
+    controllerPIDInit(controller, config->gains.proportionalGain, config->gains.integralGain, config->gains.derivativeGain);
+    controllerPIDSetOptions(controller, CONTROL_PROPORTIONAL_WEIGHT(axis, config), config->derivativeWeight,
+                            config->derivativeFilterUs);
+    controllerPIDSetAntiWindup(controller, config->antiWindupMode, config->trackingTimeUs);
+}
+
+static inline int32_t
+intPIDStrategyResponse(PIDController_t* controller, uint8_t axis, const controlState_t* input, uint32_t dtUs)
+{
+    return returnNewResponse(controller, input->reference[CONTROL_POSITION_STATE(axis)],
+                             input->state[CONTROL_POSITION_STATE(axis)], dtUs);
+}
+
+static inline void
+intPIDStrategyFeedback(PIDController_t* controller, int32_t appliedResponse)
+{
+    controllerPIDActuatorFeedback(controller, appliedResponse);
+}
+
+static inline void
+intPIDStrategyScaleGains(PIDController_t* controller, const PIDGains_t* scale)
+{
+    controllerPIDScaleGains(controller, scale);
+}
+
+static inline void
+intPIDStrategyStageGains(PIDController_t* controller, const PIDGains_t* gains)
+{
+    controllerPIDStageGains(controller, gains);
+}
+
+static inline void
+intPIDStrategyRestart(PIDController_t* controller)
+{
+    controller->hasPreviousInput = false;
+}
+
+static inline int32_t
+intPIDStrategyLastResponse(const PIDController_t* controller, uint8_t axis)
+{
+    (void)axis;
+    return controller->lastResponse;
+}
+
+static inline void
+intPIDStrategyTerms(const PIDController_t* controller, uint8_t axis, controlTerms_t* terms)
+{
+    (void)axis;
+    terms->proportional = controller->proportionalGain * controller->previousProportionalInput;
+    terms->integral = controller->integralSum / PID_INTEGRAL_FRACTION;
+    terms->derivative = controller->filteredDerivative;
+}
+
+// *******************************************************
+// Floating point PID
+// *******************************************************
+
+static inline void
+floatPIDStrategyInit(floatPIDController_t* controller, uint8_t axis, const controlConfig_t* config)
+{
+    floatPIDInit(controller, &config->gains);
+    floatPIDSetOptions(controller, CONTROL_PROPORTIONAL_WEIGHT(axis, config), config->derivativeWeight,
+                       config->derivativeFilterUs);
+    floatPIDSetAntiWindup(controller, config->antiWindupMode, config->trackingTimeUs);
+}
+
+static inline int32_t
+floatPIDStrategyResponse(floatPIDController_t* controller, uint8_t axis, const controlState_t* input, uint32_t dtUs)
+{
+    return floatPIDResponse(controller, input->reference[CONTROL_POSITION_STATE(axis)],
+                            input->state[CONTROL_POSITION_STATE(axis)], dtUs);
+}
+
+static inline void
+floatPIDStrategyFeedback(floatPIDController_t* controller, int32_t appliedResponse)
+{
+    floatPIDActuatorFeedback(controller, appliedResponse);
+}
+
+static inline void
+floatPIDStrategyScaleGains(floatPIDController_t* controller, const PIDGains_t* scale)
+{
+    floatPIDScaleGains(controller, scale);
+}
+
+static inline void
+floatPIDStrategyStageGains(floatPIDController_t* controller, const PIDGains_t* gains)
+{
+    floatPIDStageGains(controller, gains);
+}
+
+static inline void
+floatPIDStrategyRestart(floatPIDController_t* controller)
+{
+    controller->hasPreviousInput = false;
+}
+
+static inline int32_t
+floatPIDStrategyLastResponse(const floatPIDController_t* controller, uint8_t axis)
+{
+    (void)axis;
+    return (int32_t)controller->lastResponse;
+}
+
+static inline void
+floatPIDStrategyTerms(const floatPIDController_t* controller, uint8_t axis, controlTerms_t* terms)
+{
+    (void)axis;
+    terms->proportional = (int32_t)(controller->proportionalGain * controller->previousProportionalInput);
+    terms->integral = (int32_t)controller->integralSum;
+    terms->derivative = (int32_t)controller->filteredDerivative;
+}
+
+// *******************************************************
+// Cascade, the schedule only covers the single loop gains so gain changes are ignored
+// *******************************************************
+
+static inline void
+cascadeStrategyInit(cascadeController_t* controller, uint8_t axis, const controlConfig_t* config)
+{
+    (void)axis;
+    cascadeInit(controller, &config->outerGains, &config->innerGains, config->maxRate);
+}
+
+static inline int32_t
+cascadeStrategyResponse(cascadeController_t* controller, uint8_t axis, const controlState_t* input, uint32_t dtUs)
+{
+    // The inner loop's integer gains are per position unit per second, so the rate is rounded to that unit
+    int32_t rate = input->state[CONTROL_RATE_STATE(axis)];
+    int32_t halfScale = CONTROL_RATE_SCALE(axis) / 2;
+
+    rate = (rate >= 0 ? rate + halfScale : rate - halfScale) / CONTROL_RATE_SCALE(axis);
+    return cascadeResponse(controller, input->reference[CONTROL_POSITION_STATE(axis)],
+                           input->state[CONTROL_POSITION_STATE(axis)], rate, dtUs);
+}
+
+static inline void
+cascadeStrategyFeedback(cascadeController_t* controller, int32_t appliedResponse)
+{
+    cascadeActuatorFeedback(controller, appliedResponse);
+}
+
+static inline void
+cascadeStrategyScaleGains(cascadeController_t* controller, const PIDGains_t* scale)
+{
+    (void)controller;
+    (void)scale;
+}
+
+static inline void
+cascadeStrategyStageGains(cascadeController_t* controller, const PIDGains_t* gains)
+{
+    (void)controller;
+    (void)gains;
+}
+
+static inline void
+cascadeStrategyRestart(cascadeController_t* controller)
+{
+    controller->outer.hasPreviousInput = false;
+    controller->inner.hasPreviousInput = false;
+}
+
+static inline int32_t
+cascadeStrategyLastResponse(const cascadeController_t* controller, uint8_t axis)
+{
+    (void)axis;
+    return controller->inner.lastResponse;
+}
+
+static inline void
+cascadeStrategyTerms(const cascadeController_t* controller, uint8_t axis, controlTerms_t* terms)
+{
+    intPIDStrategyTerms(&controller->inner, axis, terms); // the rate loop makes the response
+}
+
+// *******************************************************
+// State feedback, the law has no integrator so there is nothing to feed back, schedule or restart
+// *******************************************************
+
+static inline void
+stateSpaceStrategyInit(stateSpaceController_t* controller, uint8_t axis, const controlConfig_t* config)
+{
+    (void)axis;
+    stateSpaceInit(controller, config->stateSpaceGains, config->stateSpaceGainShift, config->stateSpaceTrim);
+}
+
+static inline int32_t
+stateSpaceStrategyResponse(stateSpaceController_t* controller, uint8_t axis, const controlState_t* input, uint32_t dtUs)
+{
+    (void)dtUs;
+    return stateSpaceUpdateInput(controller, axis, input->reference, input->state);
+}
+
+static inline void
+stateSpaceStrategyFeedback(stateSpaceController_t* controller, int32_t appliedResponse)
+{
+    (void)controller;
+    (void)appliedResponse;
+}
+
+static inline void
+stateSpaceStrategyScaleGains(stateSpaceController_t* controller, const PIDGains_t* scale)
+{
+    (void)controller;
+    (void)scale;
+}
+
+static inline void
+stateSpaceStrategyStageGains(stateSpaceController_t* controller, const PIDGains_t* gains)
+{
+    (void)controller;
+    (void)gains;
+}
+
+static inline void
+stateSpaceStrategyRestart(stateSpaceController_t* controller)
+{
+    (void)controller;
+}
+
+static inline int32_t
+stateSpaceStrategyLastResponse(const stateSpaceController_t* controller, uint8_t axis)
+{
+    return stateSpaceResponse(controller, axis);
+}
+
+static inline void
+stateSpaceStrategyTerms(const stateSpaceController_t* controller, uint8_t axis, controlTerms_t* terms)
+{
+    terms->proportional = stateSpaceResponse(controller, axis) - controller->trim[axis]; // the whole state feedback
+    terms->integral = 0;
+    terms->derivative = 0;
+}
+
+// *******************************************************
+// Axis selection
+// *******************************************************
+
+#if ALT_CONTROL_STRATEGY == CONTROL_STRATEGY_INT_PID
+typedef PIDController_t altControl_t;
+#define ALT_STRATEGY(function) intPIDStrategy##function
+#elif ALT_CONTROL_STRATEGY == CONTROL_STRATEGY_FLOAT_PID
+typedef floatPIDController_t altControl_t;
+#define ALT_STRATEGY(function) floatPIDStrategy##function
+#elif ALT_CONTROL_STRATEGY == CONTROL_STRATEGY_CASCADE
+typedef cascadeController_t altControl_t;
+#define ALT_STRATEGY(function) cascadeStrategy##function
+#elif ALT_CONTROL_STRATEGY == CONTROL_STRATEGY_STATE_SPACE
+typedef stateSpaceController_t altControl_t;
+#define ALT_STRATEGY(function) stateSpaceStrategy##function
+#else
+#error "Unknown ALT_CONTROL_STRATEGY"
+#endif
+
+#if YAW_CONTROL_STRATEGY == CONTROL_STRATEGY_INT_PID
+typedef PIDController_t yawControl_t;
+#define YAW_STRATEGY(function) intPIDStrategy##function
+#elif YAW_CONTROL_STRATEGY == CONTROL_STRATEGY_FLOAT_PID
+typedef floatPIDController_t yawControl_t;
+#define YAW_STRATEGY(function) floatPIDStrategy##function
+#elif YAW_CONTROL_STRATEGY == CONTROL_STRATEGY_CASCADE
+typedef cascadeController_t yawControl_t;
+#define YAW_STRATEGY(function) cascadeStrategy##function
+#elif YAW_CONTROL_STRATEGY == CONTROL_STRATEGY_STATE_SPACE
+typedef stateSpaceController_t yawControl_t;
+#define YAW_STRATEGY(function) stateSpaceStrategy##function
+#else
+#error "Unknown YAW_CONTROL_STRATEGY"
+#endif
+
+#endif /* CONTROLSTRATEGY_H_ */
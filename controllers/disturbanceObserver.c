@@ -0,0 +1,128 @@
+// *******************************************************
+//
+// disturbanceObserver.c
+//
+//  This estimates the lumped disturbance on an axis, gusts, added load or friction, from a nominal model of how the
+//  rotor response accelerates the axis, so it can be cancelled within a few control loop iterations.
+//
+//  The observer runs the model rate alongside the measured rate and treats whatever acceleration the model is missing
+//  as the disturbance. With the rate error e the update each iteration is
+//      rate         += (modelGain * (applied - trim) + disturbance + 2 * bandwidth * e) * dt
+//      disturbance  += bandwidth^2 * e * dt
+//  which puts both observer poles at the bandwidth. The rate comes from the rate estimators rather than a
+//  differentiated measurement, and nothing is differentiated inside the observer.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "disturbanceObserver.h"
+
+#define MICROSECONDS_PER_SECOND 1000000
+#define DOB_MAX_DT_US 20000 // Longer dts are clamped, the same as the PID
+
+
+/** Initialises the observer
+@param observer the observer
+@param modelGain the nominal acceleration per DOB_MODEL_SCALE response
+@param trim the response that holds the axis still
+@param bandwidth the observer bandwidth in radians per second
+@param limit the largest disturbance to cancel in response units */
+void
+initDisturbanceObserver(disturbanceObserver_t* observer, int32_t modelGain, int32_t trim, int32_t bandwidth, int32_t limit)
+{
+    observer->modelGain = modelGain;
+    observer->trim = trim;
+    observer->bandwidth = bandwidth;
+    observer->limit = limit;
+    disturbanceObserverReset(observer);
+}
+
+/** Drops the estimate, used while the axis isn't flying
+@param observer the observer */
+void
+disturbanceObserverReset(disturbanceObserver_t* observer)
+{
+    observer->estimatedRate = 0;
+    observer->estimatedAcceleration = 0;
+    observer->appliedResponse = observer->trim;
+    observer->hasRate = false;
+}
+
+/** Updates the estimate with the measured rate, called every control loop iteration before the response is worked out
+@param observer the observer
+@param rate the estimated rate of the axis in DOB_SCALE fractions of a unit per second
+@param dtUs the measured time since the last update in microseconds */
+void
+disturbanceObserverUpdate(disturbanceObserver_t* observer, int32_t rate, uint32_t dtUs)
+{
+    int32_t rateError;
+    int32_t accelerationLimit;
+    int64_t acceleration;
+
+    // Start the model on the measured rate so there is no initial error to chase
+    if (!observer->hasRate || observer->modelGain == 0) {
+        observer->estimatedRate = rate;
+        observer->hasRate = true;
+        return;
+    }
+
+    if (dtUs > DOB_MAX_DT_US) {
+        dtUs = DOB_MAX_DT_US;
+    }
+
+    rateError = rate - observer->estimatedRate;
+
+    // The model and observer corrections in thousandths of a unit per second squared
+    acceleration = (int64_t)observer->modelGain * (observer->appliedResponse - observer->trim) * DOB_SCALE / DOB_MODEL_SCALE
+            + observer->estimatedAcceleration + (int64_t)2 * observer->bandwidth * rateError;
+    observer->estimatedRate += (int32_t)(acceleration * dtUs / MICROSECONDS_PER_SECOND);
+
+    observer->estimatedAcceleration += (int32_t)((int64_t)observer->bandwidth * observer->bandwidth * rateError
+            * dtUs / MICROSECONDS_PER_SECOND);
+
+    // Don't let the estimate run past what the compensation can cancel, either way whatever the sign of the model
+    accelerationLimit = observer->limit * abs(observer->modelGain) * (DOB_SCALE / DOB_MODEL_SCALE);
+    if (observer->estimatedAcceleration > accelerationLimit) {
+        observer->estimatedAcceleration = accelerationLimit;
+    } else if (observer->estimatedAcceleration < -accelerationLimit) {
+        observer->estimatedAcceleration = -accelerationLimit;
+    }
+}
+
+/** Tells the observer what the rotor applied, after any saturation
+@param observer the observer
+@param appliedResponse the response the rotor applied, including the compensation */
+void
+disturbanceObserverApplied(disturbanceObserver_t* observer, int32_t appliedResponse)
+{
+    observer->appliedResponse = appliedResponse;
+}
+
+/** Returns the response that cancels the estimated disturbance, to add on to the controller response
+@param observer the observer
+@return the compensation in response units, limited to the observer limit */
+int32_t
+getDisturbanceCompensation(const disturbanceObserver_t* observer)
+{
+    int32_t compensation;
+
+    if (observer->modelGain == 0) {
+        return 0;
+    }
+
+    // The response that makes the same acceleration as the disturbance, the other way
+    compensation = -observer->estimatedAcceleration * DOB_MODEL_SCALE / (observer->modelGain * DOB_SCALE);
+
+    if (compensation > observer->limit) {
+        return observer->limit;
+    } else if (compensation < -observer->limit) {
+        return -observer->limit;
+    }
+    return compensation;
+}
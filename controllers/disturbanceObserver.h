@@ -0,0 +1,72 @@
+// *******************************************************
+//
+// disturbanceObserver.h
+//
+//  This estimates the lumped disturbance on an axis, gusts, added load or friction, from a nominal model of how the
+//  rotor response accelerates the axis, so it can be cancelled within a few control loop iterations.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef DISTURBANCEOBSERVER_H_
+#define DISTURBANCEOBSERVER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DOB_MODEL_SCALE 100 // the model gain is the acceleration per 100 response
+#define DOB_SCALE 1000 // rates and accelerations are held in thousandths of a unit
+
+typedef struct {
+
+    // Nominal model
+    int32_t modelGain; // the acceleration in units per second squared per DOB_MODEL_SCALE response
+    int32_t trim; // the response that holds the axis still, the model is about this point
+    int32_t bandwidth; // the observer bandwidth in radians per second, higher cancels faster but passes more noise
+    int32_t limit; // the largest disturbance the observer will cancel, in response units
+
+    // Current values
+    int32_t estimatedRate; // the model rate in DOB_SCALE fractions per second
+    int32_t estimatedAcceleration; // the disturbance acceleration in DOB_SCALE fractions per second squared
+    int32_t appliedResponse; // the response the rotor applied last update
+    bool hasRate; // false until the first rate has been seen
+
+} disturbanceObserver_t; // an extended state observer for one axis
+
+
+/** Initialises the observer
+@param observer the observer
+@param modelGain the nominal acceleration per DOB_MODEL_SCALE response
+@param trim the response that holds the axis still
+@param bandwidth the observer bandwidth in radians per second
+@param limit the largest disturbance to cancel in response units */
+void
+initDisturbanceObserver(disturbanceObserver_t* observer, int32_t modelGain, int32_t trim, int32_t bandwidth, int32_t limit);
+
+/** Drops the estimate, used while the axis isn't flying
+@param observer the observer */
+void
+disturbanceObserverReset(disturbanceObserver_t* observer);
+
+/** Updates the estimate with the measured rate, called every control loop iteration before the response is worked out
+@param observer the observer
+@param rate the estimated rate of the axis in DOB_SCALE fractions of a unit per second
+@param dtUs the measured time since the last update in microseconds */
+void
+disturbanceObserverUpdate(disturbanceObserver_t* observer, int32_t rate, uint32_t dtUs);
+
+/** Tells the observer what the rotor applied, after any saturation
+@param observer the observer
+@param appliedResponse the response the rotor applied, including the compensation */
+void
+disturbanceObserverApplied(disturbanceObserver_t* observer, int32_t appliedResponse);
+
+/** Returns the response that cancels the estimated disturbance, to add on to the controller response
+@param observer the observer
+@return the compensation in response units, limited to the observer limit */
+int32_t
+getDisturbanceCompensation(const disturbanceObserver_t* observer);
+
+#endif /* DISTURBANCEOBSERVER_H_ */
@@ -0,0 +1,145 @@
+// *******************************************************
+//
+// flightRecorder.c
+//
+//  This keeps a snapshot of every control loop iteration in a RAM ring so an oscillation or fault can be looked at
+//  after the flight. The ring freezes a while after a trigger and is then dumped over the Uart.
+//
+//  The control loop owns the ring. A trigger only starts the count down to the freeze, so the iterations after the
+//  trigger are kept as well as the ones leading up to it. Nothing is written once frozen, so the main loop can read
+//  the records out without stopping the control loop.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverlib/interrupt.h"
+
+#include "flightRecorder.h"
+
+
+/** Counts one iteration after the trigger down, freezing the recorder on the last
+@param recorder the recorder */
+static void
+countDownTrigger(flightRecorder_t* recorder)
+{
+    uint16_t oldest;
+
+    if (recorder->remaining > 0) {
+        recorder->remaining--;
+    }
+    if (recorder->remaining == 0) {
+        // The trigger was held as a ring position, store it counted from the oldest record for reading out
+        oldest = (recorder->count < FLIGHT_RECORDER_LENGTH) ? 0 : recorder->head;
+        recorder->triggerRecord = (recorder->triggerRecord + FLIGHT_RECORDER_LENGTH - oldest) % FLIGHT_RECORDER_LENGTH;
+        recorder->state = FLIGHT_RECORDER_FROZEN;
+    }
+}
+
+/** Initialises an empty, armed recorder
+@param recorder the recorder */
+void
+initFlightRecorder(flightRecorder_t* recorder)
+{
+    recorder->head = 0;
+    recorder->count = 0;
+    recorder->tick = 0;
+    recorder->cause = FLIGHT_RECORDER_CAUSE_NONE;
+    recorder->remaining = 0;
+    recorder->triggerRecord = 0;
+    recorder->state = FLIGHT_RECORDER_ARMED;
+}
+
+/** Records one control loop iteration, call at the end of every iteration the controllers run in
+@param recorder the recorder
+@param record the iteration, its tick is filled in here */
+void
+flightRecorderUpdate(flightRecorder_t* recorder, flightRecord_t* record)
+{
+    record->tick = recorder->tick++;
+
+    if (recorder->state == FLIGHT_RECORDER_FROZEN) {
+        return;
+    }
+
+    recorder->records[recorder->head] = *record;
+    recorder->head = (recorder->head + 1) % FLIGHT_RECORDER_LENGTH;
+    if (recorder->count < FLIGHT_RECORDER_LENGTH) {
+        recorder->count++;
+    }
+
+    if (recorder->state == FLIGHT_RECORDER_TRIGGERED) {
+        countDownTrigger(recorder);
+    }
+}
+
+/** Counts an iteration the controllers didn't run in, so a trigger on landing still freezes the recorder
+@param recorder the recorder */
+void
+flightRecorderIdle(flightRecorder_t* recorder)
+{
+    recorder->tick++;
+
+    if (recorder->state == FLIGHT_RECORDER_TRIGGERED) {
+        countDownTrigger(recorder);
+    }
+}
+
+/** Triggers an armed recorder, it freezes once FLIGHT_RECORDER_POST_TRIGGER more iterations have passed. Safe to call
+from any interrupt, later triggers are ignored until it is armed again
+@param recorder the recorder
+@param cause the cause from flightRecorderCauses */
+void
+flightRecorderTrigger(flightRecorder_t* recorder, uint8_t cause)
+{
+    bool wasDisabled = IntMasterDisable();
+
+    if (recorder->state == FLIGHT_RECORDER_ARMED) {
+        recorder->cause = cause;
+        recorder->remaining = FLIGHT_RECORDER_POST_TRIGGER;
+        recorder->triggerRecord = recorder->head;
+        recorder->state = FLIGHT_RECORDER_TRIGGERED;
+    }
+
+    if (!wasDisabled) {
+        IntMasterEnable();
+    }
+}
+
+/** Empties and arms the recorder, called from the main loop only
+@param recorder the recorder */
+void
+flightRecorderArm(flightRecorder_t* recorder)
+{
+    IntMasterDisable();
+
+    recorder->head = 0;
+    recorder->count = 0;
+    recorder->cause = FLIGHT_RECORDER_CAUSE_NONE;
+    recorder->remaining = 0;
+    recorder->state = FLIGHT_RECORDER_ARMED;
+
+    IntMasterEnable();
+}
+
+/** Copies a record out of a frozen recorder
+@param recorder the recorder
+@param index the record, 0 is the oldest
+@param record the struct to write the record into
+@return false if the recorder isn't frozen or there is no such record */
+bool
+flightRecorderRead(const flightRecorder_t* recorder, uint16_t index, flightRecord_t* record)
+{
+    uint16_t oldest;
+
+    if (recorder->state != FLIGHT_RECORDER_FROZEN || index >= recorder->count) {
+        return false;
+    }
+
+    oldest = (recorder->count < FLIGHT_RECORDER_LENGTH) ? 0 : recorder->head;
+    *record = recorder->records[(oldest + index) % FLIGHT_RECORDER_LENGTH];
+    return true;
+}
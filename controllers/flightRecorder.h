@@ -0,0 +1,107 @@
+// *******************************************************
+//
+// flightRecorder.h
+//
+//  This keeps a snapshot of every control loop iteration in a RAM ring so an oscillation or fault can be looked at
+//  after the flight. The ring freezes a while after a trigger and is then dumped over the Uart.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef FLIGHTRECORDER_H_
+#define FLIGHTRECORDER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FLIGHT_RECORDER_LENGTH 768 // the records held, 18 KB of the 32 KB SRAM. 1.5 s at a 500 Hz control loop
+#define FLIGHT_RECORDER_POST_TRIGGER 192 // the records kept after a trigger, the rest are from before it
+
+enum flightRecorderStates {FLIGHT_RECORDER_ARMED = 0, FLIGHT_RECORDER_TRIGGERED, FLIGHT_RECORDER_FROZEN}; // the recorder progress
+enum flightRecorderCauses {FLIGHT_RECORDER_CAUSE_NONE = 0, FLIGHT_RECORDER_CAUSE_COMMAND, FLIGHT_RECORDER_CAUSE_STATE,
+                           FLIGHT_RECORDER_CAUSE_OVERRUN}; // what triggered the recorder
+
+typedef struct {
+    uint16_t tick; // the control loop iteration, wraps. A gap means the controllers weren't running
+    uint16_t adcMean; // the raw height ADC mean
+    int16_t altError; // the altitude reference minus the altitude in percent
+    int16_t yawError; // the yaw reference minus the continuous yaw in degrees
+    int16_t altProportional; // the altitude response terms
+    int16_t altIntegral;
+    int16_t altDerivative;
+    int16_t yawProportional; // the yaw response terms
+    int16_t yawIntegral;
+    int16_t yawDerivative;
+    uint16_t mainDuty; // the applied main rotor duty in permille
+    uint16_t tailDuty; // the applied tail rotor duty in permille
+} flightRecord_t; // one control loop iteration, 16 bit fields so the ring holds as many as it can
+
+/** Saturates a value into a 16 bit record field
+@param value the value
+@return the value, clamped to the int16_t range */
+static inline int16_t
+flightRecorderField(int32_t value)
+{
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    } else if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return value;
+}
+
+
+typedef struct {
+
+    flightRecord_t records[FLIGHT_RECORDER_LENGTH]; // the ring, oldest first from head once it has wrapped
+    uint16_t head; // where the next record is written
+    uint16_t count; // the amount of records held, up to FLIGHT_RECORDER_LENGTH
+    uint16_t tick; // counts every control loop iteration, recorded or not
+
+    volatile uint8_t state; // the progress from flightRecorderStates
+    uint8_t cause; // what triggered the recorder, from flightRecorderCauses
+    uint16_t remaining; // the records still to be written after the trigger
+    uint16_t triggerRecord; // the record the trigger came at, counted from the oldest once frozen
+
+} flightRecorder_t; // the flight data recorder
+
+
+/** Initialises an empty, armed recorder
+@param recorder the recorder */
+void
+initFlightRecorder(flightRecorder_t* recorder);
+
+/** Records one control loop iteration, call at the end of every iteration the controllers run in
+@param recorder the recorder
+@param record the iteration, its tick is filled in here */
+void
+flightRecorderUpdate(flightRecorder_t* recorder, flightRecord_t* record);
+
+/** Counts an iteration the controllers didn't run in, so a trigger on landing still freezes the recorder
+@param recorder the recorder */
+void
+flightRecorderIdle(flightRecorder_t* recorder);
+
+/** Triggers an armed recorder, it freezes once FLIGHT_RECORDER_POST_TRIGGER more iterations have passed. Safe to call
+from any interrupt, later triggers are ignored until it is armed again
+@param recorder the recorder
+@param cause the cause from flightRecorderCauses */
+void
+flightRecorderTrigger(flightRecorder_t* recorder, uint8_t cause);
+
+/** Empties and arms the recorder, called from the main loop only
+@param recorder the recorder */
+void
+flightRecorderArm(flightRecorder_t* recorder);
+
+/** Copies a record out of a frozen recorder
+@param recorder the recorder
+@param index the record, 0 is the oldest
+@param record the struct to write the record into
+@return false if the recorder isn't frozen or there is no such record */
+bool
+flightRecorderRead(const flightRecorder_t* recorder, uint16_t index, flightRecord_t* record);
+
+#endif /* FLIGHTRECORDER_H_ */
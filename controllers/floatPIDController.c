@@ -0,0 +1,242 @@
+// *******************************************************
+//
+// floatPIDController.c
+//
+//  This is a single precision floating point version of the PID in PIDController.c, for the Cortex-M4F FPU.
+//  The integral and derivative are scaled by the same constants as the integer PID so the gains carry over.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "floatPIDController.h"
+
+#define FLOAT_PID_MAX_DT_US 20000.0f // Longer dts are clamped, the same as the integer PID
+#define FLOAT_PID_MAX_INTEGRAL 1000.0f // The integral limit in response units, 100% duty
+#define FLOAT_PID_INTEGRAL_SCALE (1.0f / ((float)PID_INTEGRAL_DIVISOR * (float)PID_INTEGRAL_FRACTION))
+
+
+/** Clamps the integral to FLOAT_PID_MAX_INTEGRAL
+@param controller the controller */
+static void
+clampIntegral(floatPIDController_t* controller)
+{
+    if (controller->integralSum > FLOAT_PID_MAX_INTEGRAL) {
+        controller->integralSum = FLOAT_PID_MAX_INTEGRAL;
+    } else if (controller->integralSum < -FLOAT_PID_MAX_INTEGRAL) {
+        controller->integralSum = -FLOAT_PID_MAX_INTEGRAL;
+    }
+}
+
+/** Initialises the PID with integer PID gains, with the same defaults as controllerPIDInit()
+@param controller the controller
+@param gains the gains, in the integer PID's units */
+void
+floatPIDInit(floatPIDController_t* controller, const PIDGains_t* gains)
+{
+    controller->proportionalGain = (float)gains->proportionalGain;
+    controller->integralGain = (float)gains->integralGain;
+    controller->derivativeGain = (float)gains->derivativeGain;
+
+    controller->proportionalWeight = 1.0f;
+    controller->derivativeWeight = 0.0f;
+    controller->derivativeFilterUs = 0.0f;
+    controller->antiWindupMode = PID_ANTIWINDUP_CLAMP;
+    controller->trackingTimeUs = 1.0f;
+
+    controller->previousProportionalInput = 0.0f;
+    controller->previousDerivativeInput = 0.0f;
+    controller->hasPreviousInput = false;
+    controller->filteredDerivative = 0.0f;
+    controller->integralSum = 0.0f;
+    controller->lastResponse = 0.0f;
+    controller->lastDtUs = 0.0f;
+    controller->saturation = 0;
+
+    controller->baseGains = *gains;
+    controller->gainScale.proportionalGain = PID_GAIN_SCALE_FULL;
+    controller->gainScale.integralGain = PID_GAIN_SCALE_FULL;
+    controller->gainScale.derivativeGain = PID_GAIN_SCALE_FULL;
+    controller->stagedLive = 0;
+    controller->stagedSequence = 0;
+    controller->appliedSequence = 0;
+}
+
+/** Sets the two degree of freedom options, see controllerPIDSetOptions()
+@param controller the controller
+@param proportionalWeight the percentage of the setpoint used by the proportional term
+@param derivativeWeight the percentage of the setpoint used by the derivative term, 0 for derivative-on-measurement
+@param derivativeFilterUs the derivative filter time constant in microseconds, 0 to disable the filter */
+void
+floatPIDSetOptions(floatPIDController_t* controller, int32_t proportionalWeight, int32_t derivativeWeight, uint32_t derivativeFilterUs)
+{
+    controller->proportionalWeight = (float)proportionalWeight / PID_WEIGHT_FULL;
+    controller->derivativeWeight = (float)derivativeWeight / PID_WEIGHT_FULL;
+    controller->derivativeFilterUs = (float)derivativeFilterUs;
+    controller->hasPreviousInput = false;
+}
+
+/** Sets the anti-windup, see controllerPIDSetAntiWindup()
+@param controller the controller
+@param antiWindupMode one of antiWindupModes
+@param trackingTimeUs the back-calculation tracking time constant in microseconds */
+void
+floatPIDSetAntiWindup(floatPIDController_t* controller, uint8_t antiWindupMode, uint32_t trackingTimeUs)
+{
+    controller->antiWindupMode = antiWindupMode;
+    controller->trackingTimeUs = (trackingTimeUs > 0) ? (float)trackingTimeUs : 1.0f;
+    controller->saturation = 0;
+}
+
+/** Tells the PID what the actuator actually applied, see controllerPIDActuatorFeedback()
+@param controller the controller
+@param appliedResponse the response after the actuator limits */
+void
+floatPIDActuatorFeedback(floatPIDController_t* controller, int32_t appliedResponse)
+{
+    float saturationError = (float)appliedResponse - controller->lastResponse;
+
+    if (saturationError < 0.0f) {
+        controller->saturation = 1;
+    } else if (saturationError > 0.0f) {
+        controller->saturation = -1;
+    } else {
+        controller->saturation = 0;
+    }
+
+    if (controller->antiWindupMode == PID_ANTIWINDUP_BACK_CALCULATION) {
+        controller->integralSum += saturationError * controller->lastDtUs / controller->trackingTimeUs;
+        clampIntegral(controller);
+    }
+}
+
+/** Changes the gains of a running PID without a bump in the response, see controllerPIDSetGains()
+@param controller the controller
+@param gains the new gains, in the integer PID's units */
+void
+floatPIDSetGains(floatPIDController_t* controller, const PIDGains_t* gains)
+{
+    float proportionalGain = (float)gains->proportionalGain;
+    float derivativeGain = (float)gains->derivativeGain;
+    float derivativeChange = 0.0f;
+
+    if (controller->derivativeGain != 0.0f) {
+        derivativeChange = controller->filteredDerivative * (derivativeGain / controller->derivativeGain - 1.0f);
+        controller->filteredDerivative += derivativeChange;
+    }
+
+    controller->integralSum -= (proportionalGain - controller->proportionalGain) * controller->previousProportionalInput
+            + derivativeChange;
+    clampIntegral(controller);
+
+    controller->proportionalGain = proportionalGain;
+    controller->integralGain = (float)gains->integralGain;
+    controller->derivativeGain = derivativeGain;
+}
+
+/** Loads the base gains times the gain scale without a bump
+@param controller the controller */
+static void
+applyScaledGains(floatPIDController_t* controller)
+{
+    PIDGains_t scaled;
+
+    scaled.proportionalGain = controller->baseGains.proportionalGain * controller->gainScale.proportionalGain
+            / PID_GAIN_SCALE_FULL;
+    scaled.integralGain = controller->baseGains.integralGain * controller->gainScale.integralGain / PID_GAIN_SCALE_FULL;
+    scaled.derivativeGain = controller->baseGains.derivativeGain * controller->gainScale.derivativeGain
+            / PID_GAIN_SCALE_FULL;
+    floatPIDSetGains(controller, &scaled);
+}
+
+/** Scales the base gains without a bump, see controllerPIDScaleGains()
+@param controller the controller
+@param scale the scale of each gain in PID_GAIN_SCALE_FULLs */
+void
+floatPIDScaleGains(floatPIDController_t* controller, const PIDGains_t* scale)
+{
+    controller->gainScale = *scale;
+    applyScaledGains(controller);
+}
+
+/** Stages new base gains from outside the control loop, see controllerPIDStageGains()
+@param controller the controller
+@param gains the new base gains, in the integer PID's units */
+void
+floatPIDStageGains(floatPIDController_t* controller, const PIDGains_t* gains)
+{
+    uint8_t spare = controller->stagedLive ^ 1;
+
+    controller->stagedGains[spare] = *gains;
+    // The buffers are volatile, so the compiler keeps the copy ahead of the store that publishes it
+    controller->stagedLive = spare;
+    controller->stagedSequence++;
+}
+
+/** Returns the response for the setpoint and measurement, see returnNewResponse()
+@param controller the controller
+@param setpoint the target the controller is driving the measurement to
+@param measurement the current measured value, must be continuous (no wrapping)
+@param dtUs the measured time since the last update in microseconds
+@return the response, in the same scale as the integer PID */
+int32_t
+floatPIDResponse(floatPIDController_t* controller, int32_t setpoint, int32_t measurement, uint32_t dtUs)
+{
+    float dt = (float)dtUs;
+    float error = (float)(setpoint - measurement);
+    float integralStep;
+    float derivativeInput;
+    float derivativeResponse;
+
+    // Pick up newly staged gains before they are used
+    if (controller->stagedSequence != controller->appliedSequence) {
+        controller->appliedSequence = controller->stagedSequence;
+        controller->baseGains = controller->stagedGains[controller->stagedLive];
+        applyScaledGains(controller);
+    }
+
+    if (dt < 1.0f) {
+        dt = 1.0f;
+    } else if (dt > FLOAT_PID_MAX_DT_US) {
+        dt = FLOAT_PID_MAX_DT_US;
+    }
+
+    // Proportional on the weighted setpoint
+    controller->previousProportionalInput = (float)setpoint * controller->proportionalWeight - (float)measurement;
+
+    // Integral on the full error, skipped into a saturated actuator for conditional integration
+    integralStep = controller->integralGain * error * dt * FLOAT_PID_INTEGRAL_SCALE;
+    if (controller->antiWindupMode == PID_ANTIWINDUP_CONDITIONAL
+            && ((controller->saturation > 0 && integralStep > 0.0f) || (controller->saturation < 0 && integralStep < 0.0f))) {
+        integralStep = 0.0f;
+    }
+    controller->integralSum += integralStep;
+    clampIntegral(controller);
+
+    // Derivative on the weighted setpoint, then the first order low pass filter
+    derivativeInput = (float)setpoint * controller->derivativeWeight - (float)measurement;
+    if (!controller->hasPreviousInput) {
+        controller->previousDerivativeInput = derivativeInput;
+        controller->hasPreviousInput = true;
+    }
+    derivativeResponse = controller->derivativeGain * (derivativeInput - controller->previousDerivativeInput)
+            * ((float)PID_DERIVATIVE_SCALE / dt);
+    controller->previousDerivativeInput = derivativeInput;
+
+    if (controller->derivativeFilterUs > 0.0f) {
+        controller->filteredDerivative += (derivativeResponse - controller->filteredDerivative)
+                * dt / (controller->derivativeFilterUs + dt);
+    } else {
+        controller->filteredDerivative = derivativeResponse;
+    }
+
+    controller->lastResponse = controller->proportionalGain * controller->previousProportionalInput
+            + controller->integralSum + controller->filteredDerivative;
+    controller->lastDtUs = dt;
+
+    return (int32_t)controller->lastResponse;
+}
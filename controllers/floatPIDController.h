@@ -0,0 +1,112 @@
+// *******************************************************
+//
+// floatPIDController.h
+//
+//  This is a single precision floating point version of the PID in PIDController.h, for the Cortex-M4F FPU.
+//  The gains mean the same thing as the integer PID gains so the two can be swapped without retuning.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef FLOATPIDCONTROLLER_H_
+#define FLOATPIDCONTROLLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "PIDController.h"
+
+typedef struct {
+
+    // Constants
+    float proportionalGain; // the scaling factor for the proportional gain
+    float integralGain; // the scaling factor for the integral gain
+    float derivativeGain; // the scaling factor for the derivative gain
+
+    // Options
+    float proportionalWeight; // the fraction of the setpoint the proportional term sees
+    float derivativeWeight; // the fraction of the setpoint the derivative term sees, 0 is derivative-on-measurement
+    float derivativeFilterUs; // the time constant of the derivative low pass filter in microseconds, 0 disables it
+    uint8_t antiWindupMode; // the anti-windup mode from antiWindupModes
+    float trackingTimeUs; // the back-calculation tracking time constant in microseconds
+
+    // Current values
+    float previousProportionalInput; // the weighted error the proportional term used in the past calculation
+    float previousDerivativeInput; // the weighted error the derivative was taken of in the past calculation
+    bool hasPreviousInput; // false until the first calculation so the derivative doesn't kick on start up
+    float filteredDerivative; // the filtered derivative response
+    float integralSum; // the accumulated integral response
+    float lastResponse; // the unsaturated response from the last calculation
+    float lastDtUs; // the dt used in the last calculation
+    int8_t saturation; // 1 if the actuator saturated high last update, -1 if it saturated low and 0 otherwise
+
+    // The gains above are the base gains times the gain scale, the same as the integer PID
+    PIDGains_t baseGains; // the gains set at start up or last staged, in the integer PID's units
+    PIDGains_t gainScale; // the scale of each gain in PID_GAIN_SCALE_FULLs, from the gain schedule
+
+    // Gains staged from outside the control loop, double buffered so a half written set is never picked up
+    volatile PIDGains_t stagedGains[2]; // the staged gain sets, the live one and the spare the next set is written into
+    volatile uint8_t stagedLive; // the staged set that is complete
+    volatile uint32_t stagedSequence; // bumped every time a new set is staged
+    uint32_t appliedSequence; // the staged set the controller last picked up
+
+} floatPIDController_t; // the floating point PID controller
+
+
+/** Initialises the PID with integer PID gains, with the same defaults as controllerPIDInit()
+@param controller the controller
+@param gains the gains, in the integer PID's units */
+void
+floatPIDInit(floatPIDController_t* controller, const PIDGains_t* gains);
+
+/** Sets the two degree of freedom options, see controllerPIDSetOptions()
+@param controller the controller
+@param proportionalWeight the percentage of the setpoint used by the proportional term
+@param derivativeWeight the percentage of the setpoint used by the derivative term, 0 for derivative-on-measurement
+@param derivativeFilterUs the derivative filter time constant in microseconds, 0 to disable the filter */
+void
+floatPIDSetOptions(floatPIDController_t* controller, int32_t proportionalWeight, int32_t derivativeWeight, uint32_t derivativeFilterUs);
+
+/** Sets the anti-windup, see controllerPIDSetAntiWindup()
+@param controller the controller
+@param antiWindupMode one of antiWindupModes
+@param trackingTimeUs the back-calculation tracking time constant in microseconds */
+void
+floatPIDSetAntiWindup(floatPIDController_t* controller, uint8_t antiWindupMode, uint32_t trackingTimeUs);
+
+/** Tells the PID what the actuator actually applied, see controllerPIDActuatorFeedback()
+@param controller the controller
+@param appliedResponse the response after the actuator limits */
+void
+floatPIDActuatorFeedback(floatPIDController_t* controller, int32_t appliedResponse);
+
+/** Changes the gains of a running PID without a bump in the response, see controllerPIDSetGains()
+@param controller the controller
+@param gains the new gains, in the integer PID's units */
+void
+floatPIDSetGains(floatPIDController_t* controller, const PIDGains_t* gains);
+
+/** Scales the base gains without a bump, see controllerPIDScaleGains()
+@param controller the controller
+@param scale the scale of each gain in PID_GAIN_SCALE_FULLs */
+void
+floatPIDScaleGains(floatPIDController_t* controller, const PIDGains_t* scale);
+
+/** Stages new base gains from outside the control loop, see controllerPIDStageGains()
+@param controller the controller
+@param gains the new base gains, in the integer PID's units */
+void
+floatPIDStageGains(floatPIDController_t* controller, const PIDGains_t* gains);
+
+/** Returns the response for the setpoint and measurement, see returnNewResponse()
+@param controller the controller
+@param setpoint the target the controller is driving the measurement to
+@param measurement the current measured value, must be continuous (no wrapping)
+@param dtUs the measured time since the last update in microseconds
+@return the response, in the same scale as the integer PID */
+int32_t
+floatPIDResponse(floatPIDController_t* controller, int32_t setpoint, int32_t measurement, uint32_t dtUs);
+
+#endif /* FLOATPIDCONTROLLER_H_ */
@@ -0,0 +1,91 @@
+// *******************************************************
+//
+// gainSchedule.c
+//
+//  This holds the altitude indexed gain scale tables and interpolates a set of gain scales from them. The scales are
+//  applied to the PID's base gains, so tuned or commanded gains are kept and only shaped by the altitude.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gainSchedule.h"
+
+/** Interpolates a single gain scale between two table entries
+@param lower the scale at the lower entry
+@param upper the scale at the upper entry
+@param offset how far past the lower entry the altitude is, 0 to GAIN_SCHEDULE_SPACING
+@return the interpolated scale */
+static int32_t
+interpolateGain(int32_t lower, int32_t upper, int32_t offset)
+{
+    return lower + (upper - lower) * offset / GAIN_SCHEDULE_SPACING;
+}
+
+/** Linearly interpolates the gain scales for the given altitude between the neighbouring table entries.
+Cheap enough to run every control loop iteration, the only divisions are by constants.
+@param schedule the scale table
+@param altitude the altitude in percent, clamped to 0-100
+@param scale the struct to write the interpolated scales into, in PID_GAIN_SCALE_FULLs */
+void
+gainScheduleLookup(const gainSchedule_t* schedule, int32_t altitude, PIDGains_t* scale)
+{
+    int32_t index;
+    int32_t offset;
+    const PIDGains_t* lower;
+    const PIDGains_t* upper;
+
+    if (altitude < 0) {
+        altitude = 0;
+    } else if (altitude > 100) {
+        altitude = 100;
+    }
+
+    index = altitude / GAIN_SCHEDULE_SPACING;
+    if (index >= GAIN_SCHEDULE_POINTS - 1) {
+        index = GAIN_SCHEDULE_POINTS - 2;
+    }
+    offset = altitude - index * GAIN_SCHEDULE_SPACING;
+
+    lower = &schedule->points[index];
+    upper = &schedule->points[index + 1];
+
+    scale->proportionalGain = interpolateGain(lower->proportionalGain, upper->proportionalGain, offset);
+    scale->integralGain = interpolateGain(lower->integralGain, upper->integralGain, offset);
+    scale->derivativeGain = interpolateGain(lower->derivativeGain, upper->derivativeGain, offset);
+}
+
+/** Unscales one gain, the inverse of the scaling the PID applies
+@param gain the gain wanted
+@param scale the scale at the altitude, in PID_GAIN_SCALE_FULLs
+@return the base gain */
+static int32_t
+unscaleGain(int32_t gain, int32_t scale)
+{
+    if (scale == 0) {
+        return gain;
+    }
+    return gain * PID_GAIN_SCALE_FULL / scale;
+}
+
+/** Works out the base gains that the schedule scales to the given gains at the given altitude, so gains found at one
+altitude keep the shape of the table across the rest. A gain scaled to zero at the altitude is used as it is.
+@param schedule the scale table
+@param altitude the altitude in percent the gains were found at
+@param gains the gains wanted at that altitude
+@param base the struct to write the base gains into, for staging into the controller */
+void
+gainScheduleBaseGains(const gainSchedule_t* schedule, int32_t altitude, const PIDGains_t* gains, PIDGains_t* base)
+{
+    PIDGains_t scale;
+
+    gainScheduleLookup(schedule, altitude, &scale);
+
+    base->proportionalGain = unscaleGain(gains->proportionalGain, scale.proportionalGain);
+    base->integralGain = unscaleGain(gains->integralGain, scale.integralGain);
+    base->derivativeGain = unscaleGain(gains->derivativeGain, scale.derivativeGain);
+}
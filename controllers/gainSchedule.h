@@ -0,0 +1,46 @@
+// *******************************************************
+//
+// gainSchedule.h
+//
+//  This holds the altitude indexed gain scale tables and interpolates a set of gain scales from them. The scales are
+//  applied to the PID's base gains, so tuned or commanded gains are kept and only shaped by the altitude.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef GAINSCHEDULE_H_
+#define GAINSCHEDULE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "PIDController.h"
+
+#define GAIN_SCHEDULE_SPACING 25 // the altitude percentage between each entry in the table
+#define GAIN_SCHEDULE_POINTS (100 / GAIN_SCHEDULE_SPACING + 1) // entries at 0, 25, 50, 75 and 100 percent
+
+typedef struct {
+    PIDGains_t points[GAIN_SCHEDULE_POINTS]; // the scale of each gain in PID_GAIN_SCALE_FULLs, entry i is at i * GAIN_SCHEDULE_SPACING percent
+} gainSchedule_t; // a table of gain scales indexed by altitude
+
+
+/** Linearly interpolates the gain scales for the given altitude between the neighbouring table entries.
+Cheap enough to run every control loop iteration, the only divisions are by constants.
+@param schedule the scale table
+@param altitude the altitude in percent, clamped to 0-100
+@param scale the struct to write the interpolated scales into, in PID_GAIN_SCALE_FULLs */
+void
+gainScheduleLookup(const gainSchedule_t* schedule, int32_t altitude, PIDGains_t* scale);
+
+/** Works out the base gains that the schedule scales to the given gains at the given altitude, so gains found at one
+altitude keep the shape of the table across the rest. A gain scaled to zero at the altitude is used as it is.
+@param schedule the scale table
+@param altitude the altitude in percent the gains were found at
+@param gains the gains wanted at that altitude
+@param base the struct to write the base gains into, for staging into the controller */
+void
+gainScheduleBaseGains(const gainSchedule_t* schedule, int32_t altitude, const PIDGains_t* gains, PIDGains_t* base);
+
+#endif /* GAINSCHEDULE_H_ */
@@ -0,0 +1,172 @@
+// *******************************************************
+//
+// loopTimer.c
+//
+//  This runs the hardware timer that paces the control loop and measures the real time between loop iterations.
+//
+//  Timer 0 generates the control loop interrupt and Timer 2 free runs at the system clock to timestamp each
+//  iteration. Timer 1 is left alone as the OrbitOLED delay functions use it.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/debug.h"
+
+#include "loopTimer.h"
+
+#define LOOP_TIMER_BASE TIMER0_BASE // the timer that paces the control loop
+#define LOOP_TIMER_PERIPH SYSCTL_PERIPH_TIMER0
+#define LOOP_TIMER_INT INT_TIMER0A
+#define LOOP_TIMER_PRIORITY 224 // below the ADC and yaw decoder interrupts so no samples are missed
+
+#define TIMESTAMP_TIMER_BASE TIMER2_BASE // the free running timer used to measure dt
+#define TIMESTAMP_TIMER_PERIPH SYSCTL_PERIPH_TIMER2
+
+#define MICROSECONDS_PER_SECOND 1000000
+
+static uint32_t cyclesPerMicrosecond; // the amount of system clock cycles per microsecond
+static uint32_t previousTimestamp; // the timestamp of the last loop iteration
+static uint32_t nominalDt; // the configured loop period in microseconds
+static bool firstIteration; // true until the first iteration after starting has been timed
+
+static uint32_t minDt; // the shortest dt since the last jitter read
+static uint32_t maxDt; // the longest dt since the last jitter read
+static uint32_t maxJitter; // the largest dt deviation since the last jitter read
+static uint32_t iterations; // the amount of iterations since the last jitter read
+
+
+/** Resets the jitter statistics for a new reporting period */
+static void
+resetLoopJitter(void)
+{
+    minDt = UINT32_MAX;
+    maxDt = 0;
+    maxJitter = 0;
+    iterations = 0;
+}
+
+/** Initialises the loop timer and the free running timestamp timer, the loop does not run until startLoopTimer() is called
+@param rateHz the rate to run the control loop at, clamped to LOOP_TIMER_MAX_RATE_HZ
+@param handler the interrupt handler that runs the control loop */
+void
+initLoopTimer(uint32_t rateHz, void (*handler)(void))
+{
+    if (rateHz > LOOP_TIMER_MAX_RATE_HZ) {
+        rateHz = LOOP_TIMER_MAX_RATE_HZ;
+    }
+
+    cyclesPerMicrosecond = SysCtlClockGet() / MICROSECONDS_PER_SECOND;
+    nominalDt = MICROSECONDS_PER_SECOND / rateHz;
+    resetLoopJitter();
+
+    // Free running timestamp, counts up through the full 32 bits and wraps
+    SysCtlPeripheralEnable(TIMESTAMP_TIMER_PERIPH);
+    TimerConfigure(TIMESTAMP_TIMER_BASE, TIMER_CFG_PERIODIC_UP);
+    TimerLoadSet(TIMESTAMP_TIMER_BASE, TIMER_A, UINT32_MAX);
+    TimerEnable(TIMESTAMP_TIMER_BASE, TIMER_A);
+
+    // Periodic control loop interrupt
+    SysCtlPeripheralEnable(LOOP_TIMER_PERIPH);
+    TimerConfigure(LOOP_TIMER_BASE, TIMER_CFG_PERIODIC);
+    TimerLoadSet(LOOP_TIMER_BASE, TIMER_A, SysCtlClockGet() / rateHz - 1);
+
+    TimerIntRegister(LOOP_TIMER_BASE, TIMER_A, handler);
+    IntPrioritySet(LOOP_TIMER_INT, LOOP_TIMER_PRIORITY);
+    TimerIntEnable(LOOP_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+}
+
+/** Starts the control loop interrupt */
+void
+startLoopTimer(void)
+{
+    firstIteration = true;
+    TimerEnable(LOOP_TIMER_BASE, TIMER_A);
+}
+
+/** Holds the control loop interrupt off, a tick that comes meanwhile runs once it is enabled again
+@return true if it was already held off, so a nested caller leaves it that way */
+bool
+loopTimerIntDisable(void)
+{
+    bool wasDisabled = !IntIsEnabled(LOOP_TIMER_INT);
+
+    IntDisable(LOOP_TIMER_INT);
+    return wasDisabled;
+}
+
+/** Lets the control loop interrupt run again after loopTimerIntDisable() */
+void
+loopTimerIntEnable(void)
+{
+    IntEnable(LOOP_TIMER_INT);
+}
+
+/** Returns the free running timestamp in clock cycles, used for timing code sections
+@return the current timestamp */
+uint32_t
+loopTimerTimestamp(void)
+{
+    return TimerValueGet(TIMESTAMP_TIMER_BASE, TIMER_A);
+}
+
+/** Clears the loop timer interrupt and measures the time since the last iteration. Must be called at the start of the handler.
+@return the measured dt in microseconds */
+uint32_t
+loopTimerUpdate(void)
+{
+    uint32_t timestamp = loopTimerTimestamp();
+    uint32_t dt;
+    uint32_t jitter;
+
+    TimerIntClear(LOOP_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+
+    // Unsigned subtraction handles the timestamp wrapping around
+    dt = (timestamp - previousTimestamp) / cyclesPerMicrosecond;
+    previousTimestamp = timestamp;
+
+    if (firstIteration) {
+        firstIteration = false;
+        return nominalDt;
+    }
+
+    if (dt < minDt) {
+        minDt = dt;
+    }
+    if (dt > maxDt) {
+        maxDt = dt;
+    }
+    jitter = (dt > nominalDt) ? dt - nominalDt : nominalDt - dt;
+    if (jitter > maxJitter) {
+        maxJitter = jitter;
+    }
+    iterations++;
+
+    return dt;
+}
+
+/** Copies out the jitter statistics and resets them for the next reporting period
+@param jitter the struct to write the statistics into */
+void
+readLoopJitter(loopJitter_t* jitter)
+{
+    IntDisable(LOOP_TIMER_INT);
+
+    jitter->nominalDt = nominalDt;
+    jitter->minDt = (iterations > 0) ? minDt : 0;
+    jitter->maxDt = maxDt;
+    jitter->maxJitter = maxJitter;
+    jitter->iterations = iterations;
+    resetLoopJitter();
+
+    IntEnable(LOOP_TIMER_INT);
+}
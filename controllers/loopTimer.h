@@ -0,0 +1,63 @@
+// *******************************************************
+//
+// loopTimer.h
+//
+//  This runs the hardware timer that paces the control loop and measures the real time between loop iterations.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef LOOPTIMER_H_
+#define LOOPTIMER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LOOP_TIMER_MAX_RATE_HZ 1000 // the fastest rate the control loop can be paced at
+
+typedef struct {
+    uint32_t nominalDt; // the dt the loop was configured for in microseconds
+    uint32_t minDt; // the shortest dt seen since the last read in microseconds
+    uint32_t maxDt; // the longest dt seen since the last read in microseconds
+    uint32_t maxJitter; // the largest difference between the measured and nominal dt in microseconds
+    uint32_t iterations; // the amount of loop iterations since the last read
+} loopJitter_t; // the jitter statistics of the control loop
+
+
+/** Initialises the loop timer and the free running timestamp timer, the loop does not run until startLoopTimer() is called
+@param rateHz the rate to run the control loop at, clamped to LOOP_TIMER_MAX_RATE_HZ
+@param handler the interrupt handler that runs the control loop */
+void
+initLoopTimer(uint32_t rateHz, void (*handler)(void));
+
+/** Starts the control loop interrupt */
+void
+startLoopTimer(void);
+
+/** Holds the control loop interrupt off, a tick that comes meanwhile runs once it is enabled again
+@return true if it was already held off, so a nested caller leaves it that way */
+bool
+loopTimerIntDisable(void);
+
+/** Lets the control loop interrupt run again after loopTimerIntDisable() */
+void
+loopTimerIntEnable(void);
+
+/** Clears the loop timer interrupt and measures the time since the last iteration. Must be called at the start of the handler.
+@return the measured dt in microseconds */
+uint32_t
+loopTimerUpdate(void);
+
+/** Returns the free running timestamp in clock cycles, used for timing code sections
+@return the current timestamp */
+uint32_t
+loopTimerTimestamp(void);
+
+/** Copies out the jitter statistics and resets them for the next reporting period
+@param jitter the struct to write the statistics into */
+void
+readLoopJitter(loopJitter_t* jitter);
+
+#endif /* LOOPTIMER_H_ */
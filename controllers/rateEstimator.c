@@ -0,0 +1,70 @@
+// *******************************************************
+//
+// rateEstimator.c
+//
+//  This estimates the rate of change of a noisy measurement with an alpha-beta filter.
+//
+//  Each update predicts the position forward by the rate, then corrects the position by alpha and the rate by
+//  beta of the residual between the measurement and the prediction.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rateEstimator.h"
+
+#define MICROSECONDS_PER_SECOND 1000000
+
+
+/** Initialises the estimator, larger gains follow the measurement faster but pass more noise through
+@param estimator the estimator
+@param alpha the position gain in 256ths
+@param beta the rate gain in 256ths */
+void
+rateEstimatorInit(rateEstimator_t* estimator, int32_t alpha, int32_t beta)
+{
+    estimator->alpha = alpha;
+    estimator->beta = beta;
+    estimator->position = 0;
+    estimator->rate = 0;
+    estimator->hasPosition = false;
+}
+
+/** Updates the estimate with a new measurement, called every control loop iteration
+@param estimator the estimator
+@param measurement the new measurement
+@param dtUs the measured time since the last update in microseconds */
+void
+rateEstimatorUpdate(rateEstimator_t* estimator, int32_t measurement, uint32_t dtUs)
+{
+    int32_t predicted;
+    int32_t residual;
+
+    measurement *= RATE_ESTIMATOR_SCALE;
+
+    if (!estimator->hasPosition || dtUs == 0) {
+        estimator->position = measurement;
+        estimator->hasPosition = true;
+        return;
+    }
+
+    predicted = estimator->position + (int32_t)((int64_t)estimator->rate * dtUs / MICROSECONDS_PER_SECOND);
+    residual = measurement - predicted;
+
+    estimator->position = predicted + residual * estimator->alpha / RATE_ESTIMATOR_GAIN_SCALE;
+    estimator->rate += (int32_t)((int64_t)residual * estimator->beta * MICROSECONDS_PER_SECOND
+            / ((int64_t)RATE_ESTIMATOR_GAIN_SCALE * dtUs));
+}
+
+/** Returns the estimated rate
+@param estimator the estimator
+@return the rate in measurement units per second */
+int32_t
+getEstimatedRate(const rateEstimator_t* estimator)
+{
+    return estimator->rate / RATE_ESTIMATOR_SCALE;
+}
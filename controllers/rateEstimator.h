@@ -0,0 +1,55 @@
+// *******************************************************
+//
+// rateEstimator.h
+//
+//  This estimates the rate of change of a noisy measurement with an alpha-beta filter.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef RATEESTIMATOR_H_
+#define RATEESTIMATOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RATE_ESTIMATOR_GAIN_SCALE 256 // alpha and beta are in 256ths
+#define RATE_ESTIMATOR_SCALE 1000 // the estimate is held in thousandths of the measurement unit
+
+typedef struct {
+
+    // Constants
+    int32_t alpha; // how much of the position residual is taken, in 256ths
+    int32_t beta; // how much of the position residual goes into the rate, in 256ths
+
+    // Current values
+    int32_t position; // the filtered measurement in RATE_ESTIMATOR_SCALE fractions
+    int32_t rate; // the estimated rate in RATE_ESTIMATOR_SCALE fractions per second
+    bool hasPosition; // false until the first measurement
+
+} rateEstimator_t; // an alpha-beta filter tracking a measurement and its rate
+
+
+/** Initialises the estimator, larger gains follow the measurement faster but pass more noise through
+@param estimator the estimator
+@param alpha the position gain in 256ths
+@param beta the rate gain in 256ths */
+void
+rateEstimatorInit(rateEstimator_t* estimator, int32_t alpha, int32_t beta);
+
+/** Updates the estimate with a new measurement, called every control loop iteration
+@param estimator the estimator
+@param measurement the new measurement
+@param dtUs the measured time since the last update in microseconds */
+void
+rateEstimatorUpdate(rateEstimator_t* estimator, int32_t measurement, uint32_t dtUs);
+
+/** Returns the estimated rate
+@param estimator the estimator
+@return the rate in measurement units per second */
+int32_t
+getEstimatedRate(const rateEstimator_t* estimator);
+
+#endif /* RATEESTIMATOR_H_ */
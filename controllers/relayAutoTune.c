@@ -0,0 +1,150 @@
+// *******************************************************
+//
+// relayAutoTune.c
+//
+//  This runs a relay feedback (Astrom-Hagglund) experiment on one axis and computes PID gains from it.
+//
+//  The relay drives the actuator a fixed amount above or below the hover response depending on the sign of the
+//  error, which makes the axis oscillate at its ultimate period. The ultimate gain follows from the relay
+//  amplitude d and the error amplitude a as Ku = 4d / (pi a).
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "relayAutoTune.h"
+
+#define AUTOTUNE_SETTLE_CYCLES 2 // oscillations ignored while the axis settles into the limit cycle
+#define AUTOTUNE_MEASURE_CYCLES 4 // oscillations averaged for the result
+#define AUTOTUNE_TIMEOUT_US 60000000 // give up if the axis hasn't oscillated enough in a minute
+
+#define PI_NUMERATOR 355 // pi as 355 / 113
+#define PI_DENOMINATOR 113
+#define GAIN_SCALE 100 // the ultimate gain is held in hundredths
+
+// Tyreus-Luyben, Kp = Ku / 2.2, Ti = 2.2 Tu, Td = Tu / 6.3, all in tenths
+#define TL_KP_DIVISOR_TENTHS 22
+#define TL_TI_TENTHS 22
+#define TL_TD_DIVISOR_TENTHS 63
+
+
+/** Starts a relay experiment
+@param tuner the experiment
+@param bias the response to switch the relay around
+@param amplitude how far above and below the bias the relay drives
+@param hysteresis how far the error must cross zero before switching */
+void
+relayAutoTuneStart(relayAutoTune_t* tuner, int32_t bias, int32_t amplitude, int32_t hysteresis)
+{
+    tuner->bias = bias;
+    tuner->amplitude = amplitude;
+    tuner->hysteresis = hysteresis;
+
+    tuner->relayState = 1;
+    tuner->state = AUTOTUNE_RUNNING;
+    tuner->cycles = 0;
+    tuner->elapsedUs = 0;
+    tuner->cycleUs = 0;
+    tuner->cycleErrorMax = INT32_MIN;
+    tuner->cycleErrorMin = INT32_MAX;
+    tuner->periodSumUs = 0;
+    tuner->peakToPeakSum = 0;
+
+    tuner->ultimateGain = 0;
+    tuner->ultimatePeriodUs = 0;
+}
+
+/** Works out the ultimate gain and period once enough oscillations have been measured
+@param tuner the experiment */
+static void
+finishExperiment(relayAutoTune_t* tuner)
+{
+    int32_t peakToPeak = tuner->peakToPeakSum / AUTOTUNE_MEASURE_CYCLES;
+
+    if (peakToPeak <= 0) {
+        tuner->state = AUTOTUNE_FAILED;
+        return;
+    }
+
+    // Ku = 4d / (pi a) with a = peakToPeak / 2
+    tuner->ultimateGain = 8 * tuner->amplitude * GAIN_SCALE * PI_DENOMINATOR / (PI_NUMERATOR * peakToPeak);
+    tuner->ultimatePeriodUs = tuner->periodSumUs / AUTOTUNE_MEASURE_CYCLES;
+    tuner->state = AUTOTUNE_DONE;
+}
+
+/** Runs the relay for one control loop iteration, in place of the axis' PID
+@param tuner the experiment
+@param error the target minus the measurement
+@param dtUs the measured time since the last update in microseconds
+@return the response to drive the actuator with */
+int32_t
+relayAutoTuneUpdate(relayAutoTune_t* tuner, int32_t error, uint32_t dtUs)
+{
+    if (tuner->state != AUTOTUNE_RUNNING) {
+        return tuner->bias;
+    }
+
+    tuner->elapsedUs += dtUs;
+    tuner->cycleUs += dtUs;
+    if (tuner->elapsedUs > AUTOTUNE_TIMEOUT_US) {
+        tuner->state = AUTOTUNE_FAILED;
+        return tuner->bias;
+    }
+
+    if (error > tuner->cycleErrorMax) {
+        tuner->cycleErrorMax = error;
+    }
+    if (error < tuner->cycleErrorMin) {
+        tuner->cycleErrorMin = error;
+    }
+
+    if (tuner->relayState > 0 && error < -tuner->hysteresis) {
+        tuner->relayState = -1;
+    } else if (tuner->relayState < 0 && error > tuner->hysteresis) {
+        // Each upward switch ends an oscillation
+        tuner->relayState = 1;
+        tuner->cycles++;
+
+        if (tuner->cycles > AUTOTUNE_SETTLE_CYCLES) {
+            tuner->periodSumUs += tuner->cycleUs;
+            tuner->peakToPeakSum += tuner->cycleErrorMax - tuner->cycleErrorMin;
+
+            if (tuner->cycles >= AUTOTUNE_SETTLE_CYCLES + AUTOTUNE_MEASURE_CYCLES) {
+                finishExperiment(tuner);
+                return tuner->bias;
+            }
+        }
+
+        tuner->cycleUs = 0;
+        tuner->cycleErrorMax = error;
+        tuner->cycleErrorMin = error;
+    }
+
+    return tuner->bias + tuner->relayState * tuner->amplitude;
+}
+
+/** Computes PID gains from the identified ultimate gain and period with the Tyreus-Luyben rules,
+which give less overshoot than Ziegler-Nichols on a rig this lightly damped.
+@param tuner a finished experiment
+@param gains the gains to fill in, in the same scales PIDController.c uses */
+void
+relayAutoTuneGains(const relayAutoTune_t* tuner, PIDGains_t* gains)
+{
+    int64_t ultimateGain = tuner->ultimateGain;
+    int64_t ultimatePeriodUs = tuner->ultimatePeriodUs;
+
+    // Kp is in response per error, the same units as the ultimate gain
+    gains->proportionalGain = (int32_t)(ultimateGain * 10 / (GAIN_SCALE * TL_KP_DIVISOR_TENTHS));
+
+    // Ki = Kp / Ti, scaled to the integral response per error second the PID uses
+    gains->integralGain = (int32_t)(ultimateGain * 10 * PID_INTEGRAL_DIVISOR * PID_INTEGRAL_FRACTION * 10
+            / (GAIN_SCALE * TL_KP_DIVISOR_TENTHS * TL_TI_TENTHS * ultimatePeriodUs));
+
+    // Kd = Kp * Td, scaled to the derivative response per error per second the PID uses
+    gains->derivativeGain = (int32_t)(ultimateGain * 10 * ultimatePeriodUs * 10
+            / ((int64_t)GAIN_SCALE * TL_KP_DIVISOR_TENTHS * TL_TD_DIVISOR_TENTHS * PID_DERIVATIVE_SCALE));
+}
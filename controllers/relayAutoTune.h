@@ -0,0 +1,70 @@
+// *******************************************************
+//
+// relayAutoTune.h
+//
+//  This runs a relay feedback (Astrom-Hagglund) experiment on one axis and computes PID gains from it.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef RELAYAUTOTUNE_H_
+#define RELAYAUTOTUNE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "PIDController.h"
+
+enum autoTuneStates {AUTOTUNE_RUNNING = 0, AUTOTUNE_DONE, AUTOTUNE_FAILED}; // the progress of the experiment
+
+typedef struct {
+
+    // Settings
+    int32_t bias; // the response the relay switches around, the hover response when the experiment starts
+    int32_t amplitude; // how far above and below the bias the relay drives the response
+    int32_t hysteresis; // how far the error has to cross zero before the relay switches
+
+    // Current values
+    int8_t relayState; // 1 while driving up, -1 while driving down
+    volatile uint8_t state; // the progress of the experiment from autoTuneStates, the flight logic polls it
+    uint8_t cycles; // the amount of full oscillations seen
+    uint32_t elapsedUs; // the total time the experiment has run
+    uint32_t cycleUs; // the time since the relay last switched up
+    int32_t cycleErrorMax; // the largest error in the current oscillation
+    int32_t cycleErrorMin; // the smallest error in the current oscillation
+    uint32_t periodSumUs; // the sum of the measured oscillation periods
+    int32_t peakToPeakSum; // the sum of the measured oscillation peak to peaks
+
+    // Results
+    int32_t ultimateGain; // the identified ultimate gain, in response per 100 error
+    uint32_t ultimatePeriodUs; // the identified ultimate period in microseconds
+
+} relayAutoTune_t; // a relay feedback experiment on one axis
+
+
+/** Starts a relay experiment
+@param tuner the experiment
+@param bias the response to switch the relay around
+@param amplitude how far above and below the bias the relay drives
+@param hysteresis how far the error must cross zero before switching */
+void
+relayAutoTuneStart(relayAutoTune_t* tuner, int32_t bias, int32_t amplitude, int32_t hysteresis);
+
+/** Runs the relay for one control loop iteration, in place of the axis' PID
+@param tuner the experiment
+@param error the target minus the measurement
+@param dtUs the measured time since the last update in microseconds
+@return the response to drive the actuator with */
+int32_t
+relayAutoTuneUpdate(relayAutoTune_t* tuner, int32_t error, uint32_t dtUs);
+
+/** Computes PID gains from the identified ultimate gain and period with the Tyreus-Luyben rules,
+which give less overshoot than Ziegler-Nichols on a rig this lightly damped.
+@param tuner a finished experiment
+@param gains the gains to fill in, in the same scales PIDController.c uses */
+void
+relayAutoTuneGains(const relayAutoTune_t* tuner, PIDGains_t* gains);
+
+#endif /* RELAYAUTOTUNE_H_ */
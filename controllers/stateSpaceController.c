@@ -0,0 +1,103 @@
+// *******************************************************
+//
+// stateSpaceController.c
+//
+//  This evaluates a full state feedback (LQR) control law u = trim + K (r - x) in Q15 fixed point.
+//
+//  The state errors are clamped to SS_STATE_LIMIT so each Q15 product fits in 27 bits and the four products summed
+//  for an input can't overflow 32 bits. The sum is then shifted back down from Q15, less the gain shift.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stateSpaceController.h"
+
+
+/** Initialises the controller with a gain matrix
+@param controller the controller
+@param gains the gain matrix K in Q15, one row per input
+@param gainShift the power of two the Q15 gains are scaled by
+@param trim the response for each input at the reference, the hover responses */
+void
+stateSpaceInit(stateSpaceController_t* controller, const int16_t gains[SS_NUM_INPUTS][SS_NUM_STATES], uint8_t gainShift,
+               const int32_t trim[SS_NUM_INPUTS])
+{
+    uint8_t i;
+    uint8_t j;
+
+    for (i = 0; i < SS_NUM_INPUTS; i++) {
+        for (j = 0; j < SS_NUM_STATES; j++) {
+            controller->gains[i][j] = gains[i][j];
+        }
+        controller->trim[i] = trim[i];
+        controller->response[i] = trim[i];
+    }
+
+    controller->gainShift = (gainShift > SS_Q15_SHIFT) ? SS_Q15_SHIFT : gainShift;
+}
+
+/** Clamps a state error so its Q15 product stays inside SS_STATE_LIMIT * 2^15
+@param error the state error
+@return the clamped error */
+static int32_t
+clampStateError(int32_t error)
+{
+    if (error > SS_STATE_LIMIT) {
+        return SS_STATE_LIMIT;
+    } else if (error < -SS_STATE_LIMIT) {
+        return -SS_STATE_LIMIT;
+    }
+    return error;
+}
+
+/** Evaluates the control law for both inputs, u = trim + K (r - x)
+@param controller the controller
+@param reference the reference state, yaw continuous in the same way as the measured yaw
+@param state the measured state
+@return nothing, read the responses with stateSpaceResponse() */
+void
+stateSpaceUpdate(stateSpaceController_t* controller, const int32_t reference[SS_NUM_STATES], const int32_t state[SS_NUM_STATES])
+{
+    uint8_t i;
+
+    for (i = 0; i < SS_NUM_INPUTS; i++) {
+        stateSpaceUpdateInput(controller, i, reference, state);
+    }
+}
+
+/** Evaluates the control law for one input, for when only one axis runs on the state feedback
+@param controller the controller
+@param input the input from stateSpaceInputs
+@param reference the reference state, yaw continuous in the same way as the measured yaw
+@param state the measured state
+@return the response for the input */
+int32_t
+stateSpaceUpdateInput(stateSpaceController_t* controller, uint8_t input, const int32_t reference[SS_NUM_STATES],
+                      const int32_t state[SS_NUM_STATES])
+{
+    int32_t sum = 0;
+    uint8_t j;
+
+    for (j = 0; j < SS_NUM_STATES; j++) {
+        sum += controller->gains[input][j] * clampStateError(reference[j] - state[j]);
+    }
+
+    // Arithmetic shift, rounds towards negative infinity
+    controller->response[input] = controller->trim[input] + (sum >> (SS_Q15_SHIFT - controller->gainShift));
+    return controller->response[input];
+}
+
+/** Returns the response for one input from the last update
+@param controller the controller
+@param input the input from stateSpaceInputs
+@return the response for the input */
+int32_t
+stateSpaceResponse(const stateSpaceController_t* controller, uint8_t input)
+{
+    return controller->response[input];
+}
@@ -0,0 +1,71 @@
+// *******************************************************
+//
+// stateSpaceController.h
+//
+//  This evaluates a full state feedback (LQR) control law u = trim + K (r - x) in Q15 fixed point.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef STATESPACECONTROLLER_H_
+#define STATESPACECONTROLLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SS_Q15_SHIFT 15 // the gains are Q15, 32768 is a gain of 1 before the gain shift
+#define SS_STATE_LIMIT 4096 // state errors are clamped here so the Q15 products can't overflow the sum
+
+enum stateSpaceStates {SS_ALTITUDE = 0, SS_CLIMB_RATE, SS_YAW, SS_YAW_RATE, SS_NUM_STATES}; // the state vector
+enum stateSpaceInputs {SS_MAIN_ROTOR = 0, SS_TAIL_ROTOR, SS_NUM_INPUTS}; // the control inputs
+
+typedef struct {
+
+    // Constants
+    int16_t gains[SS_NUM_INPUTS][SS_NUM_STATES]; // the gain matrix K in Q15, computed offline from the rig model
+    uint8_t gainShift; // the gains are multiplied by 2^gainShift so they can be larger than 1
+    int32_t trim[SS_NUM_INPUTS]; // the response for each input when the state is on the reference
+
+    // Current values
+    int32_t response[SS_NUM_INPUTS]; // the response for each input from the last update
+
+} stateSpaceController_t; // a coupled state feedback controller for both rotors
+
+
+/** Initialises the controller with a gain matrix
+@param controller the controller
+@param gains the gain matrix K in Q15, one row per input
+@param gainShift the power of two the Q15 gains are scaled by
+@param trim the response for each input at the reference, the hover responses */
+void
+stateSpaceInit(stateSpaceController_t* controller, const int16_t gains[SS_NUM_INPUTS][SS_NUM_STATES], uint8_t gainShift,
+               const int32_t trim[SS_NUM_INPUTS]);
+
+/** Evaluates the control law for both inputs, u = trim + K (r - x)
+@param controller the controller
+@param reference the reference state, yaw continuous in the same way as the measured yaw
+@param state the measured state
+@return nothing, read the responses with stateSpaceResponse() */
+void
+stateSpaceUpdate(stateSpaceController_t* controller, const int32_t reference[SS_NUM_STATES], const int32_t state[SS_NUM_STATES]);
+
+/** Evaluates the control law for one input, for when only one axis runs on the state feedback
+@param controller the controller
+@param input the input from stateSpaceInputs
+@param reference the reference state, yaw continuous in the same way as the measured yaw
+@param state the measured state
+@return the response for the input */
+int32_t
+stateSpaceUpdateInput(stateSpaceController_t* controller, uint8_t input, const int32_t reference[SS_NUM_STATES],
+                      const int32_t state[SS_NUM_STATES]);
+
+/** Returns the response for one input from the last update
+@param controller the controller
+@param input the input from stateSpaceInputs
+@return the response for the input */
+int32_t
+stateSpaceResponse(const stateSpaceController_t* controller, uint8_t input);
+
+#endif /* STATESPACECONTROLLER_H_ */
@@ -0,0 +1,152 @@
+// *******************************************************
+//
+// stepMetrics.c
+//
+//  This measures the response to every target change as it happens, the rise time, overshoot, settling time and
+//  integrated absolute error, so tunings can be compared by numbers instead of by eye.
+//
+//  Everything is worked out from the error, with the progress of the step being how much of the starting error has
+//  been taken off. The control loop fills in a step's result once and the background loop reads it, a step that
+//  finishes before the last one was read is dropped rather than overwriting it mid read.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "stepMetrics.h"
+
+#define PERCENT 100
+#define PERMILLE 1000
+#define MICROSECONDS_PER_MILLISECOND 1000
+
+
+/** Finishes the step being measured and publishes its metrics if the last ones have been read
+@param metrics the metrics
+@param settled true if the step settled, false if it timed out */
+static void
+finishStep(stepMetrics_t* metrics, bool settled)
+{
+    int32_t stepMagnitude = abs(metrics->size);
+    int32_t overshoot = metrics->peakProgress - stepMagnitude;
+
+    metrics->running = false;
+
+    if (metrics->hasResult) {
+        return;
+    }
+
+    metrics->result.size = metrics->size;
+    metrics->result.riseTimeMs = (metrics->riseEndUs > 0)
+            ? (metrics->riseEndUs - metrics->riseStartUs) / MICROSECONDS_PER_MILLISECOND : 0;
+    metrics->result.overshootPermille = (overshoot > 0) ? overshoot * PERMILLE / stepMagnitude : 0;
+    metrics->result.settlingTimeMs = metrics->lastOutsideBandUs / MICROSECONDS_PER_MILLISECOND;
+    metrics->result.integratedError = (uint32_t)(metrics->integratedErrorUs / MICROSECONDS_PER_MILLISECOND);
+    metrics->result.settled = settled;
+    metrics->hasResult = true;
+}
+
+/** Initialises the metrics for an axis
+@param metrics the metrics */
+void
+initStepMetrics(stepMetrics_t* metrics)
+{
+    stepMetricsReset(metrics);
+    metrics->hasResult = false;
+}
+
+/** Drops the step being measured and forgets the target, used while the axis isn't under closed loop control
+@param metrics the metrics */
+void
+stepMetricsReset(stepMetrics_t* metrics)
+{
+    metrics->hasTarget = false;
+    metrics->running = false;
+}
+
+/** Updates the metrics, called every control loop iteration. A change of target starts a new step
+@param metrics the metrics
+@param target the target the axis is being driven to, before any profiling
+@param error the error from the target, the shortest way round for yaw
+@param dtUs the measured time since the last update in microseconds */
+void
+stepMetricsUpdate(stepMetrics_t* metrics, int32_t target, int32_t error, uint32_t dtUs)
+{
+    int32_t progress;
+    int32_t stepMagnitude;
+
+    // A new target starts a new step, abandoning any step still being measured
+    if (!metrics->hasTarget || target != metrics->target) {
+        bool isStep = metrics->hasTarget && error != 0;
+
+        metrics->target = target;
+        metrics->hasTarget = true;
+        metrics->running = isStep;
+        if (!isStep) {
+            return;
+        }
+
+        metrics->size = error;
+        metrics->band = abs(error) * STEP_SETTLE_BAND_PERCENT / PERCENT;
+        if (metrics->band < 1) {
+            metrics->band = 1;
+        }
+        metrics->elapsedUs = 0;
+        metrics->riseStartUs = 0;
+        metrics->riseEndUs = 0;
+        metrics->peakProgress = 0;
+        metrics->lastOutsideBandUs = 0;
+        metrics->integratedErrorUs = 0;
+        return;
+    }
+
+    if (!metrics->running) {
+        return;
+    }
+
+    metrics->elapsedUs += dtUs;
+    metrics->integratedErrorUs += (uint64_t)abs(error) * dtUs;
+
+    // Progress is measured in the direction of the step so both directions are handled the same
+    stepMagnitude = abs(metrics->size);
+    progress = (metrics->size > 0) ? metrics->size - error : error - metrics->size;
+
+    if (progress > metrics->peakProgress) {
+        metrics->peakProgress = progress;
+    }
+    if (metrics->riseStartUs == 0 && progress * PERCENT >= stepMagnitude * STEP_RISE_START_PERCENT) {
+        metrics->riseStartUs = metrics->elapsedUs;
+    }
+    if (metrics->riseEndUs == 0 && progress * PERCENT >= stepMagnitude * STEP_RISE_END_PERCENT) {
+        metrics->riseEndUs = metrics->elapsedUs;
+    }
+    if (abs(error) > metrics->band) {
+        metrics->lastOutsideBandUs = metrics->elapsedUs;
+    }
+
+    if (metrics->elapsedUs - metrics->lastOutsideBandUs >= STEP_SETTLE_HOLD_US) {
+        finishStep(metrics, true);
+    } else if (metrics->elapsedUs >= STEP_TIMEOUT_US) {
+        finishStep(metrics, false);
+    }
+}
+
+/** Reads the metrics of the last finished step, each step is only read once
+@param metrics the metrics
+@param result the struct to write the metrics into
+@return true if there was a new finished step */
+bool
+readStepMetrics(stepMetrics_t* metrics, stepResult_t* result)
+{
+    if (!metrics->hasResult) {
+        return false;
+    }
+
+    *result = metrics->result;
+    metrics->hasResult = false;
+    return true;
+}
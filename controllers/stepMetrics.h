@@ -0,0 +1,82 @@
+// *******************************************************
+//
+// stepMetrics.h
+//
+//  This measures the response to every target change as it happens, the rise time, overshoot, settling time and
+//  integrated absolute error, so tunings can be compared by numbers instead of by eye.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef STEPMETRICS_H_
+#define STEPMETRICS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define STEP_RISE_START_PERCENT 10 // the rise time is taken from 10% of the step
+#define STEP_RISE_END_PERCENT 90 // to 90% of the step
+#define STEP_SETTLE_BAND_PERCENT 5 // the step has settled once the error stays inside 5% of the step
+#define STEP_SETTLE_HOLD_US 1000000 // for this long
+#define STEP_TIMEOUT_US 15000000 // steps that haven't settled by now are reported as unsettled
+
+typedef struct {
+    int32_t size; // the step, the error when the target changed
+    uint32_t riseTimeMs; // the time from 10% to 90% of the step, 0 if it never got to 90%
+    uint32_t overshootPermille; // the furthest past the target in thousandths of the step
+    uint32_t settlingTimeMs; // the time from the target change until the error stayed inside the band
+    uint32_t integratedError; // the integrated absolute error in units times seconds, thousandths
+    bool settled; // false if the step timed out before settling
+} stepResult_t; // the metrics of one finished step
+
+
+typedef struct {
+
+    // Step being measured
+    int32_t target; // the target the step is towards
+    bool hasTarget; // false until the first target has been seen
+    bool running; // true while a step is being measured
+    int32_t size; // the error when the target changed
+    int32_t band; // the settling band in units, at least 1
+    uint32_t elapsedUs; // the time since the target changed
+    uint32_t riseStartUs; // when the response got to 10% of the step, 0 if it hasn't yet
+    uint32_t riseEndUs; // when the response got to 90% of the step, 0 if it hasn't yet
+    int32_t peakProgress; // the furthest the response has moved in the direction of the step
+    uint32_t lastOutsideBandUs; // the last time the error was outside the settling band
+    uint64_t integratedErrorUs; // the integrated absolute error in units times microseconds
+
+    // Finished step
+    stepResult_t result; // the metrics of the last finished step
+    volatile bool hasResult; // true until the finished step has been read
+
+} stepMetrics_t; // the step response measurement for one axis
+
+
+/** Initialises the metrics for an axis
+@param metrics the metrics */
+void
+initStepMetrics(stepMetrics_t* metrics);
+
+/** Drops the step being measured and forgets the target, used while the axis isn't under closed loop control
+@param metrics the metrics */
+void
+stepMetricsReset(stepMetrics_t* metrics);
+
+/** Updates the metrics, called every control loop iteration. A change of target starts a new step
+@param metrics the metrics
+@param target the target the axis is being driven to, before any profiling
+@param error the error from the target, the shortest way round for yaw
+@param dtUs the measured time since the last update in microseconds */
+void
+stepMetricsUpdate(stepMetrics_t* metrics, int32_t target, int32_t error, uint32_t dtUs);
+
+/** Reads the metrics of the last finished step, each step is only read once
+@param metrics the metrics
+@param result the struct to write the metrics into
+@return true if there was a new finished step */
+bool
+readStepMetrics(stepMetrics_t* metrics, stepResult_t* result);
+
+#endif /* STEPMETRICS_H_ */
@@ -0,0 +1,233 @@
+// *******************************************************
+//
+// thrustLinearisation.c
+//
+//  This straightens out the main rotor's thrust curve. The controller's response is treated as a thrust command and
+//  an inverse thrust table turns it into the duty that gives that thrust, so one set of gains works across the
+//  whole altitude range. The table is measured per rig by stepping the duty and recording where the altitude settles.
+//
+//  The settled altitude stands in for thrust. The table maps commands between the lowest and highest calibrated duty
+//  onto a straight line between the altitudes those duties settled at, and looks up the duty giving each altitude on
+//  the line from the measured steps. Outside that range commands pass straight through, the duty clamp takes them.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "driverlib/interrupt.h"
+
+#include "thrustLinearisation.h"
+#include "../IO/pwm.h"
+
+#define THRUST_COMMAND_MAX ((THRUST_TABLE_POINTS - 1) << THRUST_TABLE_SHIFT)
+#define THRUST_CAL_DUTY_MIN (PWM_DUTY_MIN * (PWM_PERMILLE / 100))
+#define THRUST_CAL_DUTY_MAX (PWM_DUTY_MAX * (PWM_PERMILLE / 100))
+
+
+/** Returns the duty held at a calibration step
+@param step the step
+@return the duty in permille */
+static int32_t
+stepDuty(uint8_t step)
+{
+    return THRUST_CAL_DUTY_MIN + step * (THRUST_CAL_DUTY_MAX - THRUST_CAL_DUTY_MIN) / (THRUST_CAL_STEPS - 1);
+}
+
+/** Initialises a table that passes the command straight through as the duty
+@param table the table */
+void
+thrustTableInit(thrustTable_t* table)
+{
+    uint8_t i;
+
+    for (i = 0; i < THRUST_TABLE_POINTS; i++) {
+        table->duty[i] = i << THRUST_TABLE_SHIFT;
+    }
+}
+
+/** Returns the duty that gives the commanded thrust, interpolating with shifts only
+@param table the table
+@param command the thrust command in permille
+@return the duty in permille */
+int32_t
+thrustTableLookup(const thrustTable_t* table, int32_t command)
+{
+    int32_t index;
+    int32_t offset;
+
+    if (command < 0) {
+        command = 0;
+    } else if (command > THRUST_COMMAND_MAX) {
+        command = THRUST_COMMAND_MAX;
+    }
+
+    index = command >> THRUST_TABLE_SHIFT;
+    if (index >= THRUST_TABLE_POINTS - 1) {
+        index = THRUST_TABLE_POINTS - 2;
+    }
+    offset = command - (index << THRUST_TABLE_SHIFT);
+
+    return table->duty[index] + (((table->duty[index + 1] - table->duty[index]) * offset) >> THRUST_TABLE_SHIFT);
+}
+
+/** Returns the thrust command a duty gives, the inverse of thrustTableLookup(). This one divides, it is only needed
+when a duty had to be changed after the lookup
+@param table the table
+@param duty the duty in permille
+@return the thrust command in permille */
+int32_t
+thrustTableCommand(const thrustTable_t* table, int32_t duty)
+{
+    int32_t index;
+    int32_t span;
+
+    if (duty <= table->duty[0]) {
+        return 0;
+    }
+
+    for (index = 0; index < THRUST_TABLE_POINTS - 1; index++) {
+        if (duty <= table->duty[index + 1]) {
+            span = table->duty[index + 1] - table->duty[index];
+            return (index << THRUST_TABLE_SHIFT) + ((span > 0) ? (duty - table->duty[index]) * THRUST_TABLE_SPACING / span : 0);
+        }
+    }
+    return THRUST_COMMAND_MAX;
+}
+
+/** Builds the table from the settled altitudes of the calibration steps
+@param calibration the calibration
+@return true if the steps covered enough altitude to build a table from */
+static bool
+buildTable(thrustCalibration_t* calibration)
+{
+    int32_t* altitude = calibration->stepAltitude;
+    int32_t lowest;
+    int32_t range;
+    int32_t command;
+    int32_t target;
+    uint8_t i;
+    uint8_t step;
+
+    // Thrust only goes up with duty, so flatten out any dips from noise or the rig catching
+    for (step = 1; step < THRUST_CAL_STEPS; step++) {
+        if (altitude[step] < altitude[step - 1]) {
+            altitude[step] = altitude[step - 1];
+        }
+    }
+
+    lowest = altitude[0];
+    range = altitude[THRUST_CAL_STEPS - 1] - lowest;
+    if (range < THRUST_CAL_MIN_RANGE) {
+        return false;
+    }
+
+    for (i = 0; i < THRUST_TABLE_POINTS; i++) {
+        command = i << THRUST_TABLE_SHIFT;
+        if (command <= THRUST_CAL_DUTY_MIN || command >= THRUST_CAL_DUTY_MAX) {
+            calibration->table->duty[i] = command;
+            continue;
+        }
+
+        // The altitude the command should give on a straight line across the calibrated range
+        target = lowest + range * (command - THRUST_CAL_DUTY_MIN) / (THRUST_CAL_DUTY_MAX - THRUST_CAL_DUTY_MIN);
+
+        // The duty that settled at that altitude, between the two steps either side of it
+        step = 0;
+        while (step < THRUST_CAL_STEPS - 2 && altitude[step + 1] < target) {
+            step++;
+        }
+        if (altitude[step + 1] == altitude[step]) {
+            calibration->table->duty[i] = stepDuty(step);
+        } else {
+            calibration->table->duty[i] = stepDuty(step) + (stepDuty(step + 1) - stepDuty(step))
+                    * (target - altitude[step]) / (altitude[step + 1] - altitude[step]);
+        }
+    }
+
+    return true;
+}
+
+/** Starts a calibration. The table is set straight through while it runs so the duty steps reach the rotor unchanged.
+Safe to call while the control loop is looking the table up
+@param calibration the calibration
+@param table the table to calibrate */
+void
+thrustCalibrationStart(thrustCalibration_t* calibration, thrustTable_t* table)
+{
+    // The control loop looks the table up while flying, so it can't see it half replaced
+    IntMasterDisable();
+    calibration->table = table;
+    calibration->previous = *table;
+    thrustTableInit(table);
+    IntMasterEnable();
+
+    calibration->step = 0;
+    calibration->stepElapsedUs = 0;
+    calibration->altitudeSum = 0;
+    calibration->altitudeSamples = 0;
+    calibration->state = THRUST_CAL_RUNNING;
+}
+
+/** Runs the calibration, called every control loop iteration in place of the altitude controller
+@param calibration the calibration
+@param altitude the altitude in permille
+@param dtUs the measured time since the last update in microseconds
+@return the duty to hold the main rotor at in permille */
+int32_t
+thrustCalibrationUpdate(thrustCalibration_t* calibration, int32_t altitude, uint32_t dtUs)
+{
+    if (calibration->state != THRUST_CAL_RUNNING) {
+        return THRUST_CAL_DUTY_MIN;
+    }
+
+    calibration->stepElapsedUs += dtUs;
+
+    // Average the altitude once the step has had time to settle
+    if (calibration->stepElapsedUs > THRUST_CAL_SETTLE_US) {
+        calibration->altitudeSum += altitude;
+        calibration->altitudeSamples++;
+    }
+
+    if (calibration->stepElapsedUs >= THRUST_CAL_SETTLE_US + THRUST_CAL_AVERAGE_US) {
+        calibration->stepAltitude[calibration->step] = (calibration->altitudeSamples > 0)
+                ? calibration->altitudeSum / (int32_t)calibration->altitudeSamples : altitude;
+        calibration->step++;
+        calibration->stepElapsedUs = 0;
+        calibration->altitudeSum = 0;
+        calibration->altitudeSamples = 0;
+
+        if (calibration->step >= THRUST_CAL_STEPS) {
+            if (buildTable(calibration)) {
+                calibration->state = THRUST_CAL_DONE;
+            } else {
+                thrustCalibrationAbort(calibration);
+                calibration->state = THRUST_CAL_FAILED;
+            }
+            return THRUST_CAL_DUTY_MIN;
+        }
+    }
+
+    return stepDuty(calibration->step);
+}
+
+/** Abandons a calibration and puts the table back how it was, safe to call while the control loop is looking it up
+@param calibration the calibration */
+void
+thrustCalibrationAbort(thrustCalibration_t* calibration)
+{
+    // Called from the main loop as well as the control loop, which looks the table up as soon as it is flying again
+    bool wasDisabled = IntMasterDisable();
+
+    if (calibration->state == THRUST_CAL_RUNNING) {
+        *calibration->table = calibration->previous;
+    }
+    calibration->state = THRUST_CAL_IDLE;
+
+    if (!wasDisabled) {
+        IntMasterEnable();
+    }
+}
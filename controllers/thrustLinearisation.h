@@ -0,0 +1,93 @@
+// *******************************************************
+//
+// thrustLinearisation.h
+//
+//  This straightens out the main rotor's thrust curve. The controller's response is treated as a thrust command and
+//  an inverse thrust table turns it into the duty that gives that thrust, so one set of gains works across the
+//  whole altitude range. The table is measured per rig by stepping the duty and recording where the altitude settles.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef THRUSTLINEARISATION_H_
+#define THRUSTLINEARISATION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define THRUST_TABLE_SHIFT 6 // the table has an entry every 2^6 = 64 permille of command, so lookups only shift
+#define THRUST_TABLE_SPACING (1 << THRUST_TABLE_SHIFT)
+#define THRUST_TABLE_POINTS (1024 / THRUST_TABLE_SPACING + 1) // entries at 0, 64 ... 1024 permille
+
+#define THRUST_CAL_STEPS 9 // the duty levels measured, evenly spaced from PWM_DUTY_MIN to PWM_DUTY_MAX
+#define THRUST_CAL_SETTLE_US 3000000 // the time each duty is held before the altitude is averaged
+#define THRUST_CAL_AVERAGE_US 1000000 // the time the altitude is averaged over at each duty
+#define THRUST_CAL_MIN_RANGE 100 // the least altitude change over the steps, in permille, for a usable table
+
+enum thrustCalibrationStates {THRUST_CAL_IDLE = 0, THRUST_CAL_RUNNING, THRUST_CAL_DONE, THRUST_CAL_FAILED}; // the calibration progress
+
+typedef struct {
+    int32_t duty[THRUST_TABLE_POINTS]; // the duty in permille for each command, entry i is at i * THRUST_TABLE_SPACING
+} thrustTable_t; // the inverse thrust curve
+
+
+typedef struct {
+
+    thrustTable_t* table; // the table being calibrated
+    thrustTable_t previous; // the table before the calibration, put back if it doesn't finish
+    volatile uint8_t state; // the progress from thrustCalibrationStates, the main loop waits on it
+
+    // Current step
+    uint8_t step; // the duty level being measured
+    uint32_t stepElapsedUs; // the time the duty has been held
+    int32_t altitudeSum; // the sum of the altitudes averaged so far
+    uint32_t altitudeSamples; // the number of altitudes summed
+
+    int32_t stepAltitude[THRUST_CAL_STEPS]; // the settled altitude at each duty level in permille
+
+} thrustCalibration_t; // the measurement of a rig's thrust curve
+
+
+/** Initialises a table that passes the command straight through as the duty
+@param table the table */
+void
+thrustTableInit(thrustTable_t* table);
+
+/** Returns the duty that gives the commanded thrust, interpolating with shifts only
+@param table the table
+@param command the thrust command in permille
+@return the duty in permille */
+int32_t
+thrustTableLookup(const thrustTable_t* table, int32_t command);
+
+/** Returns the thrust command a duty gives, the inverse of thrustTableLookup(). This one divides, it is only needed
+when a duty had to be changed after the lookup
+@param table the table
+@param duty the duty in permille
+@return the thrust command in permille */
+int32_t
+thrustTableCommand(const thrustTable_t* table, int32_t duty);
+
+/** Starts a calibration. The table is set straight through while it runs so the duty steps reach the rotor unchanged.
+Safe to call while the control loop is looking the table up
+@param calibration the calibration
+@param table the table to calibrate */
+void
+thrustCalibrationStart(thrustCalibration_t* calibration, thrustTable_t* table);
+
+/** Runs the calibration, called every control loop iteration in place of the altitude controller
+@param calibration the calibration
+@param altitude the altitude in permille
+@param dtUs the measured time since the last update in microseconds
+@return the duty to hold the main rotor at in permille */
+int32_t
+thrustCalibrationUpdate(thrustCalibration_t* calibration, int32_t altitude, uint32_t dtUs);
+
+/** Abandons a calibration and puts the table back how it was, safe to call while the control loop is looking it up
+@param calibration the calibration */
+void
+thrustCalibrationAbort(thrustCalibration_t* calibration);
+
+#endif /* THRUSTLINEARISATION_H_ */
@@ -0,0 +1,127 @@
+// *******************************************************
+//
+// trajectory.c
+//
+//  This generates rate and acceleration limited setpoint profiles between the user targets and the controllers.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "trajectory.h"
+
+#define MICROSECONDS_PER_SECOND 1000000
+#define TRAJECTORY_SNAP_DISTANCE (TRAJECTORY_SCALE / 100) // a slow profile this close to the goal stops on it
+
+
+/** Initialises a profile with its limits, sitting still at the start position
+@param trajectory the profile
+@param maxVelocity the fastest the profile moves in units per second
+@param maxAcceleration the fastest the profile accelerates in units per second squared
+@param wrap the period the position wraps at, 0 for none. Wrapping profiles take the shortest path to the goal
+@param start the starting position in units */
+void
+trajectoryInit(trajectory_t* trajectory, int32_t maxVelocity, int32_t maxAcceleration, int32_t wrap, int32_t start)
+{
+    trajectory->maxVelocity = maxVelocity * TRAJECTORY_SCALE;
+    trajectory->maxAcceleration = maxAcceleration * TRAJECTORY_SCALE;
+    trajectory->wrap = wrap * TRAJECTORY_SCALE;
+    trajectoryReset(trajectory, start);
+}
+
+/** Puts the profile at a position sitting still, used to pick the profile up from where the helicopter is
+@param trajectory the profile
+@param position the position in units */
+void
+trajectoryReset(trajectory_t* trajectory, int32_t position)
+{
+    trajectory->position = position * TRAJECTORY_SCALE;
+    trajectory->velocity = 0;
+    trajectory->positionRemainder = 0;
+}
+
+/** Returns the distance from the position to the goal, the shortest way round for wrapping profiles
+@param trajectory the profile
+@param goal the goal in TRAJECTORY_SCALE fractions
+@return the signed distance to go */
+static int32_t
+distanceToGoal(const trajectory_t* trajectory, int32_t goal)
+{
+    int32_t distance = goal - trajectory->position;
+
+    if (trajectory->wrap > 0) {
+        distance %= trajectory->wrap;
+        if (distance > trajectory->wrap / 2) {
+            distance -= trajectory->wrap;
+        } else if (distance < -trajectory->wrap / 2) {
+            distance += trajectory->wrap;
+        }
+    }
+    return distance;
+}
+
+/** Moves the profile one control loop iteration towards the goal. It speeds up at the acceleration limit to the
+velocity limit and brakes once the stopping distance reaches the distance left, giving a trapezoidal profile.
+@param trajectory the profile
+@param goal the position to move to in units
+@param dtUs the measured time since the last update in microseconds
+@return the new profile position rounded to units, for use as the controller setpoint */
+int32_t
+trajectoryUpdate(trajectory_t* trajectory, int32_t goal, uint32_t dtUs)
+{
+    int32_t distance = distanceToGoal(trajectory, goal * TRAJECTORY_SCALE);
+    int32_t direction = (distance > 0) ? 1 : -1;
+    int32_t velocityStep = (int32_t)((int64_t)trajectory->maxAcceleration * dtUs / MICROSECONDS_PER_SECOND);
+    int32_t positionStep = (int32_t)((int64_t)trajectory->velocity * dtUs / MICROSECONDS_PER_SECOND);
+    int64_t stoppingDistance;
+    int64_t travel;
+
+    // Close enough and slow enough to stop this iteration
+    if (distance == 0
+            || ((abs(distance) <= abs(positionStep) || abs(distance) <= TRAJECTORY_SNAP_DISTANCE)
+                && abs(trajectory->velocity) <= 2 * velocityStep)) {
+        trajectory->position += distance;
+        trajectory->velocity = 0;
+        trajectory->positionRemainder = 0;
+    } else {
+        // Brake when v^2 >= 2 a d while heading to the goal, otherwise speed up towards it
+        stoppingDistance = (int64_t)trajectory->velocity * trajectory->velocity;
+        if (trajectory->velocity * direction > 0
+                && stoppingDistance >= 2 * (int64_t)trajectory->maxAcceleration * abs(distance)) {
+            trajectory->velocity -= direction * velocityStep;
+        } else {
+            trajectory->velocity += direction * velocityStep;
+        }
+
+        if (trajectory->velocity > trajectory->maxVelocity) {
+            trajectory->velocity = trajectory->maxVelocity;
+        } else if (trajectory->velocity < -trajectory->maxVelocity) {
+            trajectory->velocity = -trajectory->maxVelocity;
+        }
+
+        // Carry the fraction of a step over so slow profiles still move
+        travel = (int64_t)trajectory->velocity * dtUs + trajectory->positionRemainder;
+        positionStep = (int32_t)(travel / MICROSECONDS_PER_SECOND);
+        trajectory->positionRemainder = (int32_t)(travel - (int64_t)positionStep * MICROSECONDS_PER_SECOND);
+        trajectory->position += positionStep;
+    }
+
+    if (trajectory->wrap > 0) {
+        if (trajectory->position >= trajectory->wrap) {
+            trajectory->position -= trajectory->wrap;
+        } else if (trajectory->position < 0) {
+            trajectory->position += trajectory->wrap;
+        }
+    }
+
+    // Round to the nearest unit
+    if (trajectory->position >= 0) {
+        return (trajectory->position + TRAJECTORY_SCALE / 2) / TRAJECTORY_SCALE;
+    }
+    return (trajectory->position - TRAJECTORY_SCALE / 2) / TRAJECTORY_SCALE;
+}
@@ -0,0 +1,59 @@
+// *******************************************************
+//
+// trajectory.h
+//
+//  This generates rate and acceleration limited setpoint profiles between the user targets and the controllers.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRAJECTORY_SCALE 1000 // positions, rates and accelerations are held in thousandths of a unit
+
+typedef struct {
+
+    // Limits
+    int32_t maxVelocity; // the fastest the profile moves in units per second
+    int32_t maxAcceleration; // the fastest the profile speeds up or slows down in units per second squared
+    int32_t wrap; // the period the position wraps at in units (360 for yaw) or 0 for no wrapping
+
+    // Current values
+    int32_t position; // the profile position in TRAJECTORY_SCALE fractions of a unit
+    int32_t velocity; // the profile velocity in TRAJECTORY_SCALE fractions of a unit per second
+    int32_t positionRemainder; // the part of the last position step too small to move the position, carried to the next
+
+} trajectory_t; // a trapezoidal profile towards a goal
+
+
+/** Initialises a profile with its limits, sitting still at the start position
+@param trajectory the profile
+@param maxVelocity the fastest the profile moves in units per second
+@param maxAcceleration the fastest the profile accelerates in units per second squared
+@param wrap the period the position wraps at, 0 for none. Wrapping profiles take the shortest path to the goal
+@param start the starting position in units */
+void
+trajectoryInit(trajectory_t* trajectory, int32_t maxVelocity, int32_t maxAcceleration, int32_t wrap, int32_t start);
+
+/** Puts the profile at a position sitting still, used to pick the profile up from where the helicopter is
+@param trajectory the profile
+@param position the position in units */
+void
+trajectoryReset(trajectory_t* trajectory, int32_t position);
+
+/** Moves the profile one control loop iteration towards the goal. It speeds up at the acceleration limit to the
+velocity limit and brakes once the stopping distance reaches the distance left, giving a trapezoidal profile.
+@param trajectory the profile
+@param goal the position to move to in units
+@param dtUs the measured time since the last update in microseconds
+@return the new profile position rounded to units, for use as the controller setpoint */
+int32_t
+trajectoryUpdate(trajectory_t* trajectory, int32_t goal, uint32_t dtUs);
+
+#endif /* TRAJECTORY_H_ */
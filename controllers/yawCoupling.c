@@ -0,0 +1,165 @@
+// *******************************************************
+//
+// yawCoupling.c
+//
+//  This feeds the main rotor torque forward to the tail rotor and calibrates how strongly the two are coupled.
+//
+//  The calibration sorts steady state samples into bins by main rotor response and keeps the average tail response
+//  in each bin. A least squares line through the bin averages gives the coupling gain and offset, so one long hover
+//  can't outweigh a short one at a different altitude.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "yawCoupling.h"
+
+#define COUPLING_BIN_WIDTH 100 // the main rotor response covered by each bin (10% duty)
+#define COUPLING_BINS 10 // enough bins to cover a full main rotor response
+#define COUPLING_BIN_MAX_SAMPLES 1000 // bins stop growing here so they keep following the rig
+#define COUPLING_STEADY_SAMPLES 100 // how many steady samples in a row before they are used
+#define COUPLING_MIN_BINS 2 // the least amount of bins needed to fit a line
+#define COUPLING_MIN_SPAN 2 // the least amount of bins the fitted points have to span
+
+static int32_t couplingGain; // the tail response per main response in hundredths
+static int32_t couplingOffset; // the tail response when the main rotor is off
+
+static int32_t binTailSum[COUPLING_BINS]; // the sum of the tail responses recorded in each bin
+static int32_t binCount[COUPLING_BINS]; // the amount of samples recorded in each bin
+static uint32_t steadySamples; // how many steady samples have been seen in a row
+
+
+/** Initialises the feedforward with a coupling line, tail = gain * main / YAW_COUPLING_FACTOR_SCALE + offset
+@param gain the tail response per main response in hundredths
+@param offset the tail response when the main rotor is off */
+void
+initYawCoupling(int32_t gain, int32_t offset)
+{
+    uint8_t i;
+
+    couplingGain = gain;
+    couplingOffset = offset;
+
+    for (i = 0; i < COUPLING_BINS; i++) {
+        binTailSum[i] = 0;
+        binCount[i] = 0;
+    }
+    steadySamples = 0;
+}
+
+/** Returns the tail rotor response needed to cancel the main rotor torque
+@param mainResponse the response the main rotor is being driven with
+@return the feedforward to add to the tail rotor response */
+int32_t
+yawCouplingFeedforward(int32_t mainResponse)
+{
+    return couplingGain * mainResponse / YAW_COUPLING_FACTOR_SCALE + couplingOffset;
+}
+
+/** Records a sample for the coupling calibration. Only samples taken after the helicopter has held
+its targets for a while are used, so the tail response is what the main rotor torque needs.
+@param mainResponse the response the main rotor is being driven with
+@param tailResponse the total response the tail rotor is being driven with
+@param isSteady true if the altitude and yaw are both on target */
+void
+yawCouplingCalibrationSample(int32_t mainResponse, int32_t tailResponse, bool isSteady)
+{
+    int32_t bin;
+
+    if (!isSteady) {
+        steadySamples = 0;
+        return;
+    }
+
+    if (steadySamples < COUPLING_STEADY_SAMPLES) {
+        steadySamples++;
+        return;
+    }
+
+    bin = mainResponse / COUPLING_BIN_WIDTH;
+    if (bin < 0 || bin >= COUPLING_BINS) {
+        return;
+    }
+
+    // Once full the bin becomes a running average
+    if (binCount[bin] >= COUPLING_BIN_MAX_SAMPLES) {
+        binTailSum[bin] -= binTailSum[bin] / binCount[bin];
+        binCount[bin]--;
+    }
+    binTailSum[bin] += tailResponse;
+    binCount[bin]++;
+}
+
+/** Fits a line through the calibration samples and uses it as the new feedforward.
+Nothing changes unless samples were recorded over enough of the main rotor range.
+@return true if the coupling was updated */
+bool
+yawCouplingCalibrationApply(void)
+{
+    int64_t n = 0;
+    int64_t sumX = 0;
+    int64_t sumY = 0;
+    int64_t sumXX = 0;
+    int64_t sumXY = 0;
+    int64_t denominator;
+    int32_t lowestBin = COUPLING_BINS;
+    int32_t highestBin = -1;
+    int32_t x;
+    int32_t y;
+    int32_t i;
+
+    for (i = 0; i < COUPLING_BINS; i++) {
+        if (binCount[i] == 0) {
+            continue;
+        }
+
+        // Each bin counts once, at its centre
+        x = i * COUPLING_BIN_WIDTH + COUPLING_BIN_WIDTH / 2;
+        y = binTailSum[i] / binCount[i];
+
+        n++;
+        sumX += x;
+        sumY += y;
+        sumXX += (int64_t)x * x;
+        sumXY += (int64_t)x * y;
+
+        if (i < lowestBin) {
+            lowestBin = i;
+        }
+        highestBin = i;
+    }
+
+    if (n < COUPLING_MIN_BINS || highestBin - lowestBin < COUPLING_MIN_SPAN) {
+        return false;
+    }
+
+    denominator = n * sumXX - sumX * sumX;
+    if (denominator == 0) {
+        return false;
+    }
+
+    couplingGain = (int32_t)((n * sumXY - sumX * sumY) * YAW_COUPLING_FACTOR_SCALE / denominator);
+    couplingOffset = (int32_t)((sumY * YAW_COUPLING_FACTOR_SCALE - couplingGain * sumX) / (n * YAW_COUPLING_FACTOR_SCALE));
+
+    return true;
+}
+
+/** Returns the current coupling gain
+@return the tail response per main response in hundredths */
+int32_t
+getYawCouplingGain(void)
+{
+    return couplingGain;
+}
+
+/** Returns the current coupling offset
+@return the tail response when the main rotor is off */
+int32_t
+getYawCouplingOffset(void)
+{
+    return couplingOffset;
+}
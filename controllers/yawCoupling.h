@@ -0,0 +1,56 @@
+// *******************************************************
+//
+// yawCoupling.h
+//
+//  This feeds the main rotor torque forward to the tail rotor and calibrates how strongly the two are coupled.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef YAWCOUPLING_H_
+#define YAWCOUPLING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define YAW_COUPLING_FACTOR_SCALE 100 // the coupling gain is in hundredths of tail response per main response
+
+/** Initialises the feedforward with a coupling line, tail = gain * main / YAW_COUPLING_FACTOR_SCALE + offset
+@param gain the tail response per main response in hundredths
+@param offset the tail response when the main rotor is off */
+void
+initYawCoupling(int32_t gain, int32_t offset);
+
+/** Returns the tail rotor response needed to cancel the main rotor torque
+@param mainResponse the response the main rotor is being driven with
+@return the feedforward to add to the tail rotor response */
+int32_t
+yawCouplingFeedforward(int32_t mainResponse);
+
+/** Records a sample for the coupling calibration. Only samples taken after the helicopter has held
+its targets for a while are used, so the tail response is what the main rotor torque needs.
+@param mainResponse the response the main rotor is being driven with
+@param tailResponse the total response the tail rotor is being driven with
+@param isSteady true if the altitude and yaw are both on target */
+void
+yawCouplingCalibrationSample(int32_t mainResponse, int32_t tailResponse, bool isSteady);
+
+/** Fits a line through the calibration samples and uses it as the new feedforward.
+Nothing changes unless samples were recorded over enough of the main rotor range.
+@return true if the coupling was updated */
+bool
+yawCouplingCalibrationApply(void);
+
+/** Returns the current coupling gain
+@return the tail response per main response in hundredths */
+int32_t
+getYawCouplingGain(void);
+
+/** Returns the current coupling offset
+@return the tail response when the main rotor is off */
+int32_t
+getYawCouplingOffset(void);
+
+#endif /* YAWCOUPLING_H_ */
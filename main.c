@@ -32,6 +32,19 @@
 #include "controllers/yawController.h"
 #include "controllers/yawPIDController.h"
 #include "controllers/PIDController.h"
+#include "controllers/loopTimer.h"
+#include "controllers/gainSchedule.h"
+#include "controllers/yawCoupling.h"
+#include "controllers/relayAutoTune.h"
+#include "controllers/trajectory.h"
+#include "controllers/rateEstimator.h"
+#include "controllers/controlStrategy.h"
+#include "controllers/controlBenchmark.h"
+#include "controllers/stepMetrics.h"
+#include "controllers/disturbanceObserver.h"
+#include "controllers/thrustLinearisation.h"
+#include "controllers/carrierSweep.h"
+#include "controllers/flightRecorder.h"
 
 // IO
 #include "IO/controls.h"
@@ -40,6 +53,9 @@
 #include "IO/display.h"
 #include "IO/uart.h"
 #include "IO/pwm.h"
+#include "IO/telemetry.h"
+#include "IO/commandParser.h"
+#include "IO/log.h"
 
 // Other
 #include "circBufT.h"
@@ -47,15 +63,23 @@
 //*****************************************************************************
 // Constants
 //*****************************************************************************
-#define SYS_TICK_INTERRUPT_RATE_HZ 300 // The interrupt rate in HZ
+#define SYS_TICK_INTERRUPT_RATE_HZ (2 * CONTROLLER_RATE_HZ) // The ADC trigger rate in HZ, a multiple of the loop rate so every iteration gets new samples
 #define PACER_RATE_HZ 6000 // The pacer rate in HZ
-#define CONTROLLER_RATE_HZ 10 //slower than systick // play with this
-#define ADC_MEAN_SAMPLE_RATE_HZ 600 // The ADC mean sample rate in HZ
+#define CONTROLLER_RATE_HZ 500 // The control loop timer rate in HZ, up to LOOP_TIMER_MAX_RATE_HZ
 #define FLIGHT_LOGIC_RATE_HZ 200 // The update rate of the flight logic controller
 #define DISPLAY_UPDATE_RATE_HZ 100 // The update rate for the controls in HZ
 #define UART_RATE_HZ 20 // The send rate of the serial interface
-
-#define UART_MAX_LENGTH 64
+#define TELEMETRY_RATE_HZ 30 // The send rate of the binary status frames, a frame is 25 bytes
+#define TELEMETRY_MAX_RATE_HZ 1000 // The fastest the TELEMETRY command can set the status frames to
+#define TELEMETRY_BINARY true // send the status as binary frames for tools/telemetryDecode instead of text lines
+#define COMMAND_QUEUE_LENGTH 8 // The most Uart commands held between flight logic ticks
+#define LOG_FLUSH_RATE_HZ 100 // The rate the log ring is emptied onto the Uart
+#define LOG_FLUSH_RECORDS 2 // The most log records sent per flush, keeps a burst from filling the Uart ring
+#define LOOP_OVERRUN_US (2 * 1000000 / CONTROLLER_RATE_HZ) // a control loop dt over this is logged as an overrun
+#define RECORDER_TRIGGER_STATE LANDING_STATE // entering this state triggers the flight recorder
+#define RECORDER_DUMP_TX_SPACE (2 * UART_MAX_LENGTH) // the Uart room left for the status and log while dumping
+
+#define UART_MAX_LENGTH 128 // fits the longest status, expanded log and recorder lines
 
 //PID controller gains
 #define ALT_KP 15
@@ -64,6 +88,80 @@
 #define YAW_KP 80
 #define YAW_KI 120
 #define YAW_KD 0
+
+// Altitude climb rate cascade gains, used when built with ALT_CONTROL_STRATEGY=CONTROL_STRATEGY_CASCADE
+#define ALT_OUTER_KP 2 // percent per second of climb per percent of altitude error
+#define ALT_OUTER_KI 0
+#define ALT_OUTER_KD 0
+#define ALT_INNER_KP 6 // response per percent per second of climb rate error
+#define ALT_INNER_KI 40
+#define ALT_INNER_KD 0
+#define ALT_CASCADE_MAX_RATE 30 // percent per second
+
+// Yaw rate cascade gains, used when built with YAW_CONTROL_STRATEGY=CONTROL_STRATEGY_CASCADE
+#define YAW_OUTER_KP 8 // degrees per second of turn per degree of yaw error
+#define YAW_OUTER_KI 0
+#define YAW_OUTER_KD 0
+#define YAW_INNER_KP 8 // response per degree per second of yaw rate error
+#define YAW_INNER_KI 40
+#define YAW_INNER_KD 0
+#define YAW_CASCADE_MAX_RATE 90 // degrees per second, the yaw profile's top rate
+
+// Climb rate estimate from the ADC stream, alpha-beta filter gains in 256ths
+#define ALT_RATE_ALPHA 64
+#define ALT_RATE_BETA 8
+
+// Yaw rate estimate from the decoder angle, alpha-beta filter gains in 256ths
+#define YAW_RATE_ALPHA 64
+#define YAW_RATE_BETA 8
+
+// Full state feedback, used by the axes built with CONTROL_STRATEGY_STATE_SPACE. The gains are the controller
+// response per unit of state error in hundredths, the LQR design tools/controlSim.c prints for its rig model. Rerun it
+// with the rig's identified model and paste its output here.
+#define SS_GAIN_SHIFT 8 // the largest gain magnitude is 2^SS_GAIN_SHIFT
+#define SS_Q15_GAIN(hundredths) ((int16_t)((int32_t)(hundredths) * 32768 / 100 / (1 << SS_GAIN_SHIFT)))
+#define SS_MAIN_ALT_GAIN 4826 // per percent
+#define SS_MAIN_CLIMB_RATE_GAIN 1336 // per percent per second, the matrix entry is scaled to the permille per second state
+#define SS_MAIN_YAW_GAIN -699 // per degree
+#define SS_MAIN_YAW_RATE_GAIN -114 // per degree per second
+#define SS_TAIL_ALT_GAIN 1175 // per percent
+#define SS_TAIL_CLIMB_RATE_GAIN 426 // per percent per second, the matrix entry is scaled to the permille per second state
+#define SS_TAIL_YAW_GAIN 2906 // per degree
+#define SS_TAIL_YAW_RATE_GAIN 675 // per degree per second
+#define SS_MAIN_TRIM 400 // the main rotor response that holds a hover
+#define SS_TAIL_TRIM 400 // the tail rotor response that holds the heading at hover
+
+// Rotor actuator limits, the slew rates keep aggressive climbs from pulling current spikes off the supply
+#define MAIN_ROTOR_SLEW_RATE 400 // permille duty per second
+#define TAIL_ROTOR_SLEW_RATE 1000 // permille duty per second
+#define ROTOR_SPIN_UP_US 2000000 // the take off ramp from the minimum to the maximum duty
+#define PWM_DITHER true // spread the duty below a single count over successive pwm periods
+
+// Disturbance observers, the model gains are the acceleration per 100 response about the hover trims. A model gain of
+// 0 turns an observer off, identify the gains on the rig before turning them on.
+#define ALT_DOB_MODEL_GAIN 0 // percent per second squared per 100 response
+#define ALT_DOB_BANDWIDTH 40 // radians per second
+#define ALT_DOB_LIMIT 300 // the most response the observer can add or take off
+#define YAW_DOB_MODEL_GAIN 0 // degrees per second squared per 100 response
+#define YAW_DOB_BANDWIDTH 40 // radians per second
+#define YAW_DOB_LIMIT 300 // the most response the observer can add or take off
+
+// Two degree of freedom PID options, setpoint weights in percent and the derivative filter time constant
+#define ALT_SETPOINT_WEIGHT_P 100
+#define ALT_SETPOINT_WEIGHT_D 0 // derivative-on-measurement
+#define ALT_DERIVATIVE_FILTER_US 20000
+#define YAW_SETPOINT_WEIGHT_P 100
+#define YAW_SETPOINT_WEIGHT_D 0 // derivative-on-measurement
+#if YAW_SETPOINT_WEIGHT_P != PID_WEIGHT_FULL
+#error "The yaw setpoint is the unwrapped angle, a proportional weight would scale the turns flown. Keep it at 100"
+#endif
+#define YAW_DERIVATIVE_FILTER_US 20000
+
+// Anti-windup, the back-calculation tracking time constants
+#define ALT_ANTIWINDUP_MODE PID_ANTIWINDUP_BACK_CALCULATION
+#define ALT_TRACKING_TIME_US 100000
+#define YAW_ANTIWINDUP_MODE PID_ANTIWINDUP_BACK_CALCULATION
+#define YAW_TRACKING_TIME_US 100000
  
 #define HIGH_ALT_ADC_OFFSET 1500 // The highest altitude offset for the ADC
 
@@ -72,30 +170,97 @@
 #define ALT_STEP 10
 #define YAW_STEP 15
 
+// Setpoint profile limits, steps are spread out so the rotors stay out of saturation
+#define ALT_TRAJECTORY_MAX_RATE 25 // percent per second
+#define ALT_TRAJECTORY_MAX_ACCEL 50 // percent per second squared
+#define YAW_TRAJECTORY_MAX_RATE 90 // degrees per second
+#define YAW_TRAJECTORY_MAX_ACCEL 180 // degrees per second squared
+
+// Main to tail rotor coupling, recalibrated from the steady hovers of every flight
+#define YAW_COUPLING_GAIN 0 // hundredths of tail response per main response
+#define YAW_COUPLING_OFFSET 0
+#define COUPLING_STEADY_ALT_ERROR 2 // the altitude error under which a hover counts as steady
+#define COUPLING_STEADY_YAW_ERROR 2 // the yaw error under which a hover counts as steady
+
+// Relay auto-tune, the relay amplitudes are in controller response (tenths of a percent duty)
+#define ALT_RELAY_AMPLITUDE 50
+#define ALT_RELAY_HYSTERESIS 1
+#define YAW_RELAY_AMPLITUDE 50
+#define YAW_RELAY_HYSTERESIS 2
+
 
 //#define CONTROLLER_RESPONSE_SCALE_FACTOR 100
-//#define YAW_COUPLING_FACTOR_SCALE 100
 
 
 //*****************************************************************************
 // Global variables
 //*****************************************************************************
 static int32_t low_alt_ADC_limit; // the lower altitude limit for the ADC
-static int16_t heightPercent = 0; // the highest percentage
-static int16_t yawAngle = 0; // the initial yaw angle
+volatile static int16_t heightPercent = 0; // the highest percentage
+volatile static int16_t yawAngle = 0; // the initial yaw angle
+static int32_t yawContinuous = 0; // the yaw angle without wrapping at 360, so the PID sees a continuous measurement
 static int32_t heightRawAvg; // the average of the height
-static uint16_t slowSysTickCounter; // used for calculations for the PID controller while not flying  
+static int32_t heightPermille; // the height in tenths of a percent, finer than heightPercent for the climb rate estimate
+static rateEstimator_t altRateEstimator; // the climb rate estimate
+static int32_t altitudeRate; // the estimated climb rate in permille per second
+static rateEstimator_t yawRateEstimator; // the yaw rate estimate
+static int32_t yawRate; // the estimated yaw rate in degrees per second
+static disturbanceObserver_t altObserver; // the disturbance estimate on the altitude axis
+static disturbanceObserver_t yawObserver; // the disturbance estimate on the yaw axis
+static thrustTable_t mainThrustTable; // the duty for each main rotor thrust command, straight through until calibrated
+static thrustCalibration_t thrustCalibration; // the measurement of the main rotor thrust curve
+static carrierSweep_t carrierSweep; // the altitude noise measurement across the pwm carrier frequencies
+static flightRecorder_t flightRecorder; // every control loop iteration of the last moments of the flight
+static bool recorderDumping = false; // true while the frozen recorder is being sent
+static uint16_t recorderDumpIndex; // the next record to send
 
 static int16_t heightTarget = 0; // the target for the height
 static int16_t yawTarget = 0; // the target yaw 
 
-static uint16_t slowSysTickMax; // the max amount that the slow systick can acchive
-
-static PIDController_t altController; // the controller for the main rotor
-static PIDController_t yawController; // the controller for the back rotor
-
-static uint8_t currentPwmAlt = 0; // the current pwm signal for the main rotor
-static uint8_t currentPwmYaw = 0; // the current pwm signal for the back rotor
+static altControl_t altController; // the controller for the main rotor, the law is picked by ALT_CONTROL_STRATEGY
+static yawControl_t yawController; // the controller for the back rotor, the law is picked by YAW_CONTROL_STRATEGY
+
+static const int16_t stateSpaceGains[SS_NUM_INPUTS][SS_NUM_STATES] = {
+    // altitude, climb rate, yaw, yaw rate
+    {SS_Q15_GAIN(SS_MAIN_ALT_GAIN), SS_Q15_GAIN(SS_MAIN_CLIMB_RATE_GAIN) / CONTROL_ALT_RATE_SCALE,
+     SS_Q15_GAIN(SS_MAIN_YAW_GAIN), SS_Q15_GAIN(SS_MAIN_YAW_RATE_GAIN)}, // main rotor
+    {SS_Q15_GAIN(SS_TAIL_ALT_GAIN), SS_Q15_GAIN(SS_TAIL_CLIMB_RATE_GAIN) / CONTROL_ALT_RATE_SCALE,
+     SS_Q15_GAIN(SS_TAIL_YAW_GAIN), SS_Q15_GAIN(SS_TAIL_YAW_RATE_GAIN)}, // tail rotor
+}; // the gain matrix K
+static const int32_t stateSpaceTrim[SS_NUM_INPUTS] = {SS_MAIN_TRIM, SS_TAIL_TRIM}; // the hover responses
+
+static const controlConfig_t altControlConfig = {
+    {ALT_KP, ALT_KI, ALT_KD}, ALT_SETPOINT_WEIGHT_P, ALT_SETPOINT_WEIGHT_D, ALT_DERIVATIVE_FILTER_US,
+    ALT_ANTIWINDUP_MODE, ALT_TRACKING_TIME_US,
+    {ALT_OUTER_KP, ALT_OUTER_KI, ALT_OUTER_KD}, {ALT_INNER_KP, ALT_INNER_KI, ALT_INNER_KD}, ALT_CASCADE_MAX_RATE,
+    stateSpaceGains, SS_GAIN_SHIFT, stateSpaceTrim,
+}; // the settings for the altitude law
+static const controlConfig_t yawControlConfig = {
+    {YAW_KP, YAW_KI, YAW_KD}, YAW_SETPOINT_WEIGHT_P, YAW_SETPOINT_WEIGHT_D, YAW_DERIVATIVE_FILTER_US,
+    YAW_ANTIWINDUP_MODE, YAW_TRACKING_TIME_US,
+    {YAW_OUTER_KP, YAW_OUTER_KI, YAW_OUTER_KD}, {YAW_INNER_KP, YAW_INNER_KI, YAW_INNER_KD}, YAW_CASCADE_MAX_RATE,
+    stateSpaceGains, SS_GAIN_SHIFT, stateSpaceTrim,
+}; // the settings for the yaw law
+
+// Altitude gain scales in percent of the tuned gains, one entry every GAIN_SCHEDULE_SPACING percent from the ground up.
+// These start flat, raise or lower entries per rig for ground effect near 0% and the top of travel.
+static const gainSchedule_t altGainSchedule = {{
+    {100, 100, 100}, // 0%
+    {100, 100, 100}, // 25%
+    {100, 100, 100}, // 50%
+    {100, 100, 100}, // 75%
+    {100, 100, 100}, // 100%
+}}; // the gain scales for the main rotor
+static const gainSchedule_t yawGainSchedule = {{
+    {100, 100, 100}, // 0%
+    {100, 100, 100}, // 25%
+    {100, 100, 100}, // 50%
+    {100, 100, 100}, // 75%
+    {100, 100, 100}, // 100%
+}}; // the gain scales for the back rotor
+
+static uint16_t currentPwmAlt = 0; // the current pwm duty for the main rotor in permille
+static uint16_t currentPwmYaw = 0; // the current pwm duty for the back rotor in permille
 
 //uint16_t yawOffsetCalc_prev = 0; // not used
 //uint8_t yawOffsetCalc_count = 0; // not used
@@ -103,27 +268,81 @@ static uint8_t currentPwmYaw = 0; // the current pwm signal for the back rotor
 volatile static bool calibrating = true; // checks the state of the heli to see if it has found the calibration point
 static bool isCalibrated = false;
 volatile static bool isModeFlying = false; // holds the state for the helicopter to see if it is flying
+static bool isModeAutoTune = false; // holds the state of the auto-tune switch
+static bool autoTuneLatched = false; // set once an auto-tune has run so the switch has to be cycled to run another
+static bool thrustCalibrationRequested = false; // set by taking off with the auto-tune switch already on
+
+enum autoTuneAxes {AUTOTUNE_NONE = 0, AUTOTUNE_ALT, AUTOTUNE_YAW}; // the axis the relay experiment is running on
+volatile static uint8_t autoTuneAxis = AUTOTUNE_NONE; // the axis the relay is driving in place of its PID
+static relayAutoTune_t autoTuner; // the relay experiment
+
+static trajectory_t altTrajectory; // the profile from the height target to the altitude controller
+static trajectory_t yawTrajectory; // the shortest path profile from the yaw target to the yaw controller
 
+static stepMetrics_t altStepMetrics; // the response to height target changes
+static stepMetrics_t yawStepMetrics; // the response to yaw target changes
 
-enum states {STARTUP_STATE = 0, LANDED_STATE, CALIBRATION_STATE, FLYING_STATE, LANDING_STATE};// the state machine holding the different state for the helicopter
+
+enum states {STARTUP_STATE = 0, LANDED_STATE, CALIBRATION_STATE, FLYING_STATE, LANDING_STATE, AUTOTUNE_STATE, THRUST_CALIBRATION_STATE};// the state machine holding the different state for the helicopter
 static uint8_t currentState = STARTUP_STATE; // the current state of the helicopter. landed, Take Off, Flying, landing used for the Enum above
+static uint8_t loggedState = STARTUP_STATE; // the state last written to the log
 
 char UARTbuffer[UART_MAX_LENGTH]; // The buffer to hold the output chars for the Uart terminal
-
-/** Updates the duty cycle within the Main rotors structure and then clamps in between selected values
-@param controllerResponse the change in response for the main rotor */
+static bool binaryTelemetry = TELEMETRY_BINARY; // true while the status goes out as binary frames instead of text
+static uint32_t telemetryMaxTicks = PACER_RATE_HZ / TELEMETRY_RATE_HZ; // the pacer ticks between status frames
+
+static commandParser_t commandParser; // the progress through the command line being received
+static command_t pendingCommands[COMMAND_QUEUE_LENGTH]; // the commands received since the last flight logic tick
+static uint8_t pendingCommandCount = 0; // the amount of commands waiting
+
+enum remoteModes {REMOTE_MODE_NONE = 0, REMOTE_MODE_FLY, REMOTE_MODE_LAND}; // the mode set over the Uart
+static uint8_t remoteMode = REMOTE_MODE_NONE; // the mode set over the Uart in place of the flying switch
+static bool remoteModeSwitch; // the flying switch position when the mode was set, moving it takes the mode back
+
+/** Updates the duty cycle within the Main rotors structure, clamps it in between selected values, linearises the
+thrust and stages it through the rotor's slew limit
+@param controllerResponse the change in response for the main rotor
+@param compensation the disturbance compensation added on top of the controller response
+@param dtUs the measured time since the last update in microseconds */
 void
-getMainRotorDutyCycle(int32_t controllerResponse)
+getMainRotorDutyCycle(int32_t controllerResponse, int32_t compensation, uint32_t dtUs)
 {
-    currentPwmAlt = clampDutyCycle(controllerResponse / CONTROLLER_RESPONSE_SCALE);
+    // The response is a thrust command in tenths of a percent, the table turns it into the permille duty
+    int32_t command = clampDutyPermille(controllerResponse + compensation);
+    int32_t duty = thrustTableLookup(&mainThrustTable, command);
+    currentPwmAlt = pwmActuatorUpdate(PWM_ROTOR_MAIN, duty, dtUs);
+
+    // The observer and controller work in thrust commands, only go back through the table if the slew limit bit
+    int32_t appliedCommand = (currentPwmAlt == duty) ? command : thrustTableCommand(&mainThrustTable, currentPwmAlt);
+    disturbanceObserverApplied(&altObserver, appliedCommand);
+    if (autoTuneAxis != AUTOTUNE_ALT && currentState != THRUST_CALIBRATION_STATE) {
+        ALT_STRATEGY(Feedback)(&altController, appliedCommand - compensation);
+    }
 }
 
-/** Updates the duty cycle within the back rotors structure and then clamps in between selected values
-@param controllerResponse the change in responce for the back rotor */
+/** Updates the duty cycle within the back rotors structure, clamps it in between selected values and stages it
+through the rotor's slew limit
+@param controllerResponse the change in responce for the back rotor
+@param feedforward the coupling feedforward and disturbance compensation added on top of the controller response
+@param dtUs the measured time since the last update in microseconds */
 void
-getTailRotorDutyCycle(int32_t controllerResponse)
+getTailRotorDutyCycle(int32_t controllerResponse, int32_t feedforward, uint32_t dtUs)
 {
-    currentPwmYaw = clampDutyCycle(controllerResponse / CONTROLLER_RESPONSE_SCALE);
+    currentPwmYaw = pwmActuatorUpdate(PWM_ROTOR_TAIL, clampDutyPermille(controllerResponse + feedforward), dtUs);
+    disturbanceObserverApplied(&yawObserver, currentPwmYaw);
+    if (autoTuneAxis != AUTOTUNE_YAW) {
+        YAW_STRATEGY(Feedback)(&yawController, currentPwmYaw - feedforward);
+    }
+}
+
+/** Control loop task: calculate the (approximate) mean of the values in the
+circular buffer and convert it to the height percentage. */
+void 
+adcMeanSampleUpdateTick(void)
+{
+    heightRawAvg = readSampleAverageBuffer();
+    heightPercent = (-(heightRawAvg - low_alt_ADC_limit) * 100) / (HIGH_ALT_ADC_OFFSET);
+    heightPermille = (-(heightRawAvg - low_alt_ADC_limit) * 1000) / (HIGH_ALT_ADC_OFFSET);
 }
 
 /** the handler for systick */
@@ -132,34 +351,128 @@ SysTickIntHandler(void)
 {
 
     ADCProcessorTrigger(ADC0_BASE, 3);
-
-    // Don't execute the slow SysTick if the helicopter is still calibrating
-    if (calibrating) {
-        return;
-    }
-
-    if((slowSysTickCounter >= slowSysTickMax) && (currentState == FLYING_STATE || currentState ==  LANDING_STATE)) { // Only run PID controller while flying, avoids windup issues when landed
-        IntTrigger(INT_EMAC0_TM4C129);
-        slowSysTickCounter = 0;
-    }
-    slowSysTickCounter++;
 }
 
-/** the handler for the Pid changes 
+/** the handler for the control loop timer
 reads the angle and height values and changes the responce of the system accordingly */
 void PidIntHandler(void) {
 
+    uint32_t dtUs = loopTimerUpdate();
+
+    if (dtUs > LOOP_OVERRUN_US) {
+        LOG(LOG_LOOP_OVERRUN, dtUs, 1000000 / CONTROLLER_RATE_HZ);
+        flightRecorderTrigger(&flightRecorder, FLIGHT_RECORDER_CAUSE_OVERRUN);
+    }
+
+    // Read the inputs every tick so the measurements stay fresh for the flight logic and display
+    adcMeanSampleUpdateTick();
+    rateEstimatorUpdate(&altRateEstimator, heightPermille, dtUs);
+    altitudeRate = getEstimatedRate(&altRateEstimator);
+    int16_t previousYawAngle = yawAngle;
     yawAngle = getAngle();
+    yawContinuous += getShortestYawError(previousYawAngle, yawAngle);
+    rateEstimatorUpdate(&yawRateEstimator, yawContinuous, dtUs);
+    yawRate = getEstimatedRate(&yawRateEstimator);
+
+    // The sweep steps the carrier before anything is staged, so this tick's duties are worked out for the new period
+    carrierSweepUpdate(&carrierSweep, heightPermille, dtUs);
+
+    // Don't run the controllers if the helicopter is still calibrating
+    // Only run PID controller while flying, avoids windup issues when landed
+    if (calibrating || (currentState != FLYING_STATE && currentState != LANDING_STATE && currentState != AUTOTUNE_STATE
+                        && currentState != THRUST_CALIBRATION_STATE)) {
+        // Keep the profiles on the helicopter so they start from where it is on take off
+        trajectoryReset(&altTrajectory, heightPercent);
+        trajectoryReset(&yawTrajectory, yawAngle);
+        stepMetricsReset(&altStepMetrics);
+        stepMetricsReset(&yawStepMetrics);
+        disturbanceObserverReset(&altObserver);
+        disturbanceObserverReset(&yawObserver);
+        flightRecorderIdle(&flightRecorder);
+        return;
+    }
 
-    int32_t altResponse = returnNewResponse(&altController, heightTarget - heightPercent);
-    getMainRotorDutyCycle(altResponse);
-    setMainPWM(currentPwmAlt);
+    // Estimate the disturbances from the rates in thousandths, the altitude estimator runs in tenths of a percent
+    disturbanceObserverUpdate(&altObserver, altRateEstimator.rate / 10, dtUs);
+    disturbanceObserverUpdate(&yawObserver, yawRateEstimator.rate, dtUs);
 
+    // Only steps the controllers fly are measured, not the landing descent or a relay experiment
+    if (currentState == FLYING_STATE && autoTuneAxis == AUTOTUNE_NONE) {
+        stepMetricsUpdate(&altStepMetrics, heightTarget, heightTarget - heightPercent, dtUs);
+        stepMetricsUpdate(&yawStepMetrics, yawTarget, getShortestYawError(yawAngle, yawTarget), dtUs);
+    } else {
+        stepMetricsReset(&altStepMetrics);
+        stepMetricsReset(&yawStepMetrics);
+    }
 
+    // Profile the targets so a button press ramps the setpoint instead of stepping it
+    int32_t altReference = trajectoryUpdate(&altTrajectory, heightTarget, dtUs);
+    int32_t yawReference = trajectoryUpdate(&yawTrajectory, yawTarget, dtUs);
+
+    // Scale the staged gains on the current altitude, the update is bumpless so this can run every tick
+    PIDGains_t gainScale;
+    gainScheduleLookup(&altGainSchedule, heightPercent, &gainScale);
+    ALT_STRATEGY(ScaleGains)(&altController, &gainScale);
+    gainScheduleLookup(&yawGainSchedule, heightPercent, &gainScale);
+    YAW_STRATEGY(ScaleGains)(&yawController, &gainScale);
+
+    // The yaw target is taken the shortest way round from the current angle
+    int32_t yawSetpoint = yawContinuous + getShortestYawError(yawAngle, yawReference);
+
+    // Every law gets the whole state, the profile velocities are the rate references
+    controlState_t controlInput = {
+        {altReference, altTrajectory.velocity / (TRAJECTORY_SCALE / CONTROL_ALT_RATE_SCALE), yawSetpoint,
+         yawTrajectory.velocity / TRAJECTORY_SCALE},
+        {heightPercent, altitudeRate, yawContinuous, yawRate},
+    };
+    controlBenchmarkRecord(&controlInput, dtUs);
+
+    // While auto-tuning the relay drives the axis under test in place of its PID, the thrust calibration steps the
+    // main rotor duty open loop
+    int32_t altResponse;
+    bool altOpenLoop = (autoTuneAxis == AUTOTUNE_ALT || currentState == THRUST_CALIBRATION_STATE);
+    if (currentState == THRUST_CALIBRATION_STATE) {
+        altResponse = thrustCalibrationUpdate(&thrustCalibration, heightPermille, dtUs);
+        trajectoryReset(&altTrajectory, heightPercent);
+    } else if (autoTuneAxis == AUTOTUNE_ALT) {
+        altResponse = relayAutoTuneUpdate(&autoTuner, altReference - heightPercent, dtUs);
+    } else {
+        altResponse = ALT_STRATEGY(Response)(&altController, CONTROL_AXIS_ALT, &controlInput, dtUs);
+    }
+    // The experiments need the raw plant, so the axis under test isn't compensated
+    int32_t altCompensation = altOpenLoop ? 0 : getDisturbanceCompensation(&altObserver);
+    getMainRotorDutyCycle(altResponse, altCompensation, dtUs);
 
-    int32_t yawResponse = returnNewResponse(&yawController, getShortestYawError(yawAngle, yawTarget) );
-    getTailRotorDutyCycle(yawResponse);
-    setTailPWM(currentPwmYaw);
+    int32_t yawResponse;
+    if (autoTuneAxis == AUTOTUNE_YAW) {
+        yawResponse = relayAutoTuneUpdate(&autoTuner, yawSetpoint - yawContinuous, dtUs);
+    } else {
+        yawResponse = YAW_STRATEGY(Response)(&yawController, CONTROL_AXIS_YAW, &controlInput, dtUs);
+    }
+    int32_t yawCompensation = (autoTuneAxis == AUTOTUNE_YAW) ? 0 : getDisturbanceCompensation(&yawObserver);
+    getTailRotorDutyCycle(yawResponse, yawCouplingFeedforward(currentPwmAlt) + yawCompensation, dtUs);
+
+    // Both duties are staged, write them together so they change at the end of this pwm period
+    commitPWM();
+
+    // Snapshot the iteration, the terms are the controllers' even while an experiment drives the rotor
+    controlTerms_t altTerms;
+    controlTerms_t yawTerms;
+    flightRecord_t record;
+    ALT_STRATEGY(Terms)(&altController, CONTROL_AXIS_ALT, &altTerms);
+    YAW_STRATEGY(Terms)(&yawController, CONTROL_AXIS_YAW, &yawTerms);
+    record.adcMean = heightRawAvg;
+    record.altError = flightRecorderField(altReference - heightPercent);
+    record.yawError = flightRecorderField(yawSetpoint - yawContinuous);
+    record.altProportional = flightRecorderField(altTerms.proportional);
+    record.altIntegral = flightRecorderField(altTerms.integral);
+    record.altDerivative = flightRecorderField(altTerms.derivative);
+    record.yawProportional = flightRecorderField(yawTerms.proportional);
+    record.yawIntegral = flightRecorderField(yawTerms.integral);
+    record.yawDerivative = flightRecorderField(yawTerms.derivative);
+    record.mainDuty = currentPwmAlt;
+    record.tailDuty = currentPwmYaw;
+    flightRecorderUpdate(&flightRecorder, &record);
 }
 
 
@@ -168,11 +481,113 @@ void
 switchesUpdate(void)
 {
     updateSwitches();
-    if (isFlyingSelected()) {
+
+    // A mode set over the Uart holds until someone moves the flying switch
+    if (remoteMode != REMOTE_MODE_NONE && isFlyingSelected() != remoteModeSwitch) {
+        remoteMode = REMOTE_MODE_NONE;
+    }
+
+    if (remoteMode != REMOTE_MODE_NONE) {
+        isModeFlying = (remoteMode == REMOTE_MODE_FLY);
+    } else if (isFlyingSelected()) {
         isModeFlying = true;
     } else {
         isModeFlying = false;
     }
+    isModeAutoTune = isAutoTuneSelected();
+}
+
+/** starts a relay experiment on one axis, switching around the response the axis is hovering with
+@param axis the axis to tune from autoTuneAxes */
+void
+startAutoTune(uint8_t axis)
+{
+    // The relay has to switch the rotor in one step, the duty is still clamped
+    if (axis == AUTOTUNE_ALT) {
+        relayAutoTuneStart(&autoTuner, ALT_STRATEGY(LastResponse)(&altController, CONTROL_AXIS_ALT),
+                           ALT_RELAY_AMPLITUDE, ALT_RELAY_HYSTERESIS);
+        pwmActuatorSlewLimit(PWM_ROTOR_MAIN, false);
+    } else {
+        relayAutoTuneStart(&autoTuner, YAW_STRATEGY(LastResponse)(&yawController, CONTROL_AXIS_YAW),
+                           YAW_RELAY_AMPLITUDE, YAW_RELAY_HYSTERESIS);
+        pwmActuatorSlewLimit(PWM_ROTOR_TAIL, false);
+    }
+    autoTuneAxis = axis; // set last, the control loop picks the experiment up from here
+}
+
+/** hands the axis under test back to its controller. The controller's last derivative input is from before the
+experiment, so it is dropped to stop a derivative kick on the first update */
+void
+stopAutoTune(void)
+{
+    if (autoTuneAxis == AUTOTUNE_ALT) {
+        ALT_STRATEGY(Restart)(&altController);
+    } else if (autoTuneAxis == AUTOTUNE_YAW) {
+        YAW_STRATEGY(Restart)(&yawController);
+    }
+    autoTuneAxis = AUTOTUNE_NONE;
+    pwmActuatorSlewLimit(PWM_ROTOR_MAIN, true);
+    pwmActuatorSlewLimit(PWM_ROTOR_TAIL, true);
+}
+
+/** runs the auto-tune sequence, altitude first then yaw, staging each axis' new gains as it finishes
+@return true once the sequence is over, whether it finished or failed */
+bool
+autoTuneUpdate(void)
+{
+    PIDGains_t tunedGains;
+    PIDGains_t baseGains;
+    relayAutoTune_t finished;
+
+    if (autoTuner.state == AUTOTUNE_RUNNING) {
+        return false;
+    }
+
+    // The control loop owns the experiment, take a consistent copy of its results
+    IntMasterDisable();
+    finished = autoTuner;
+    IntMasterEnable();
+
+    if (finished.state == AUTOTUNE_DONE) {
+        // The gains were found at this altitude, stage the base gains the schedule scales back to them here
+        relayAutoTuneGains(&finished, &tunedGains);
+        if (autoTuneAxis == AUTOTUNE_ALT) {
+            gainScheduleBaseGains(&altGainSchedule, heightPercent, &tunedGains, &baseGains);
+            ALT_STRATEGY(StageGains)(&altController, &baseGains);
+            stopAutoTune();
+            startAutoTune(AUTOTUNE_YAW);
+            return false;
+        }
+        gainScheduleBaseGains(&yawGainSchedule, heightPercent, &tunedGains, &baseGains);
+        YAW_STRATEGY(StageGains)(&yawController, &baseGains);
+    }
+
+    stopAutoTune();
+    return true;
+}
+
+/** logs the calibrated main rotor thrust table, to copy into the start up table for the rig */
+void
+logThrustTable(void)
+{
+    int32_t args[LOG_MAX_ARGS];
+    uint8_t first;
+    uint8_t count;
+    uint8_t i;
+
+    // The first two arguments say where the entries belong, the rest of each record carries the entries
+    for (first = 0; first < THRUST_TABLE_POINTS; first += LOG_MAX_ARGS - 2) {
+        count = THRUST_TABLE_POINTS - first;
+        if (count > LOG_MAX_ARGS - 2) {
+            count = LOG_MAX_ARGS - 2;
+        }
+        args[0] = first * THRUST_TABLE_SPACING;
+        args[1] = count;
+        for (i = 0; i < count; i++) {
+            args[2 + i] = mainThrustTable.duty[first + i];
+        }
+        logWrite(LOG_THRUST_TABLE, args, 2 + count);
+    }
 }
 
 /** updates all of the buttons 
@@ -180,6 +595,11 @@ then checks if there has been a button push and handles that change */
 void buttonsUpdate(void) {
     updateButtons();
 
+    // Record the first step of the flight for the controller benchmark
+    if (isUpButtonPressed() || isDownButtonPressed() || isRightButtonPressed() || isLeftButtonPressed()) {
+        controlBenchmarkArm();
+    }
+
     if (isUpButtonPressed()) {
         heightTarget += ALT_STEP;
         if (heightTarget > 100) {
@@ -210,10 +630,144 @@ void buttonsUpdate(void) {
     }
 }
 
+/** applies a command received over the Uart and replies to it
+@param command the command
+@param newHeightTarget the height target the commands so far this tick have set
+@param newYawTarget the yaw target the commands so far this tick have set */
+void
+applyCommand(const command_t* command, int16_t* newHeightTarget, int16_t* newYawTarget)
+{
+    bool accepted = true;
+    PIDGains_t gains;
+    PIDGains_t baseGains;
+
+    switch (command->type) {
+        case COMMAND_ALT:
+            accepted = (currentState == FLYING_STATE && command->args[0] >= 0 && command->args[0] <= 100);
+            if (accepted) {
+                *newHeightTarget = command->args[0];
+            }
+            break;
+        case COMMAND_YAW:
+            accepted = (currentState == FLYING_STATE && command->args[0] >= 0 && command->args[0] < 360);
+            if (accepted) {
+                *newYawTarget = command->args[0];
+            }
+            break;
+        case COMMAND_GAIN_ALT:
+        case COMMAND_GAIN_YAW:
+            // The auto-tune stages its own gains while it runs
+            // Bounded so the schedule and the control loop's products can't overflow
+            accepted = (currentState != AUTOTUNE_STATE && command->args[0] >= 0 && command->args[0] <= PID_GAIN_MAX
+                        && command->args[1] >= 0 && command->args[1] <= PID_GAIN_MAX
+                        && command->args[2] >= 0 && command->args[2] <= PID_GAIN_MAX);
+            if (accepted) {
+                gains.proportionalGain = command->args[0];
+                gains.integralGain = command->args[1];
+                gains.derivativeGain = command->args[2];
+                if (command->type == COMMAND_GAIN_ALT) {
+                    gainScheduleBaseGains(&altGainSchedule, heightPercent, &gains, &baseGains);
+                    ALT_STRATEGY(StageGains)(&altController, &baseGains);
+                } else {
+                    gainScheduleBaseGains(&yawGainSchedule, heightPercent, &gains, &baseGains);
+                    YAW_STRATEGY(StageGains)(&yawController, &baseGains);
+                }
+            }
+            break;
+        case COMMAND_TELEMETRY_RATE:
+            accepted = (command->args[0] > 0 && command->args[0] <= TELEMETRY_MAX_RATE_HZ);
+            if (accepted) {
+                telemetryMaxTicks = PACER_RATE_HZ / command->args[0];
+            }
+            break;
+        case COMMAND_TELEMETRY_BINARY:
+            binaryTelemetry = true;
+            LOG(LOG_CLOCK, SysCtlClockGet()); // a capture started from here still gets the timestamp rate
+            break;
+        case COMMAND_TELEMETRY_TEXT:
+            binaryTelemetry = false;
+            break;
+        case COMMAND_MODE_FLY:
+        case COMMAND_MODE_LAND:
+            remoteMode = (command->type == COMMAND_MODE_FLY) ? REMOTE_MODE_FLY : REMOTE_MODE_LAND;
+            remoteModeSwitch = isFlyingSelected();
+            break;
+        case COMMAND_MODE_SWITCH:
+            remoteMode = REMOTE_MODE_NONE;
+            break;
+        case COMMAND_PWM:
+            if (carrierSweep.state != CARRIER_SWEEP_RUNNING && pwmSetFrequency(command->args[0])) {
+                usprintf (UARTbuffer, "PWM     | carrier: %d Hz \r\n", pwmGetFrequency());
+            } else {
+                usprintf (UARTbuffer, "PWM     | %d Hz refused, %d-%d Hz in steps of %d \r\n", command->args[0],
+                          PWM_RATE_MIN_HZ, PWM_RATE_MAX_HZ, PWM_RATE_STEP_HZ);
+            }
+            UARTSend(UARTbuffer);
+            return;
+        case COMMAND_SWEEP:
+            accepted = (carrierSweep.state != CARRIER_SWEEP_RUNNING);
+            carrierSweepStart(&carrierSweep);
+            break;
+        case COMMAND_BAUD_OFFER:
+            uartSendBaudOffer();
+            return;
+        case COMMAND_BAUD:
+            uartBaudAccept(command->args[0]);
+            return;
+        case COMMAND_BAUD_SYNC:
+            uartBaudSync();
+            return;
+        case COMMAND_RECORD_TRIGGER:
+            accepted = (flightRecorder.state == FLIGHT_RECORDER_ARMED);
+            flightRecorderTrigger(&flightRecorder, FLIGHT_RECORDER_CAUSE_COMMAND);
+            break;
+        case COMMAND_RECORD_DUMP:
+            accepted = (flightRecorder.state == FLIGHT_RECORDER_FROZEN);
+            if (accepted) {
+                LOG(LOG_RECORDER_DUMP, flightRecorder.count, flightRecorder.triggerRecord, flightRecorder.cause);
+                recorderDumpIndex = 0;
+                recorderDumping = true;
+            }
+            break;
+        case COMMAND_RECORD_ARM:
+            recorderDumping = false;
+            flightRecorderArm(&flightRecorder);
+            break;
+    }
+
+    UARTSend(accepted ? "OK\r\n" : "REFUSED\r\n");
+}
+
+/** applies the commands received since the last tick. The targets from all of them change in one step so the
+control loop never flies a half applied set */
+void
+applyPendingCommands(void)
+{
+    int16_t newHeightTarget = heightTarget;
+    int16_t newYawTarget = yawTarget;
+    uint8_t i;
+
+    if (pendingCommandCount == 0) {
+        return;
+    }
+
+    for (i = 0; i < pendingCommandCount; i++) {
+        applyCommand(&pendingCommands[i], &newHeightTarget, &newYawTarget);
+    }
+    pendingCommandCount = 0;
+
+    IntMasterDisable();
+    heightTarget = newHeightTarget;
+    yawTarget = newYawTarget;
+    IntMasterEnable();
+}
+
 /** updates the FSM for the flight controller */
 void
 flightLogicControllerUpdateTick(void)
 {
+    applyPendingCommands();
+
     switch (currentState) {
         case STARTUP_STATE:
             switchesUpdate();
@@ -230,6 +784,11 @@ flightLogicControllerUpdateTick(void)
             currentPwmAlt = 0;
             currentPwmYaw = 0;
             if (isModeFlying == true) {
+                // Taking off with the auto-tune switch already on measures the thrust curve instead
+                thrustCalibrationRequested = isModeAutoTune;
+                autoTuneLatched = isModeAutoTune;
+                recorderDumping = false;
+                flightRecorderArm(&flightRecorder); // record this flight, dump the last one before taking off
                 if (isCalibrated) {
                     currentState = FLYING_STATE;
                     startUpPwmRotors();
@@ -249,10 +808,53 @@ flightLogicControllerUpdateTick(void)
         case FLYING_STATE:
             buttonsUpdate();
             switchesUpdate();
+            if (thrustCalibrationRequested) {
+                thrustCalibrationRequested = false;
+                thrustCalibrationStart(&thrustCalibration, &mainThrustTable);
+                currentState = THRUST_CALIBRATION_STATE; // set last, the control loop picks the calibration up from here
+                break;
+            }
+            if (!isModeAutoTune) {
+                autoTuneLatched = false;
+            } else if (!autoTuneLatched && isModeFlying) {
+                autoTuneLatched = true;
+                startAutoTune(AUTOTUNE_ALT);
+                currentState = AUTOTUNE_STATE;
+                break;
+            }
+            yawCouplingCalibrationSample(currentPwmAlt, currentPwmYaw,
+                                         abs(heightTarget - heightPercent) <= COUPLING_STEADY_ALT_ERROR
+                                         && abs(getShortestYawError(yawAngle, yawTarget)) <= COUPLING_STEADY_YAW_ERROR
+                                         && currentPwmYaw > PWM_DUTY_MIN * CONTROLLER_RESPONSE_SCALE
+                                         && currentPwmYaw < PWM_DUTY_MAX * CONTROLLER_RESPONSE_SCALE);
             if (isModeFlying == false) {
                 currentState = LANDING_STATE;
             }
             break;
+        case AUTOTUNE_STATE:
+            switchesUpdate();
+            if (!isModeFlying || !isModeAutoTune) {
+                stopAutoTune(); // abandon the experiment, the PIDs take back over
+                currentState = FLYING_STATE;
+            } else if (autoTuneUpdate()) {
+                currentState = FLYING_STATE;
+            }
+            break;
+        case THRUST_CALIBRATION_STATE:
+            switchesUpdate();
+            heightTarget = heightPercent; // hold wherever the calibration leaves the helicopter when it hands back
+            if (!isModeFlying || !isModeAutoTune) {
+                currentState = FLYING_STATE; // leave the state first so the control loop stops updating the calibration
+                thrustCalibrationAbort(&thrustCalibration);
+                ALT_STRATEGY(Restart)(&altController);
+            } else if (thrustCalibration.state != THRUST_CAL_RUNNING) {
+                if (thrustCalibration.state == THRUST_CAL_DONE) {
+                    logThrustTable();
+                }
+                ALT_STRATEGY(Restart)(&altController);
+                currentState = FLYING_STATE;
+            }
+            break;
         case LANDING_STATE:
             yawTarget = 0;
             if (abs(getShortestYawError(yawAngle, yawTarget)) < 3) {
@@ -263,10 +865,19 @@ flightLogicControllerUpdateTick(void)
             }
 
             if (heightPercent < 2) {
+                yawCouplingCalibrationApply(); // use this flight's coupling from the next flight on
                 currentState = LANDED_STATE;
             }
             break;
     }
+
+    if (currentState != loggedState) {
+        LOG(LOG_STATE, loggedState, currentState);
+        loggedState = currentState;
+        if (currentState == RECORDER_TRIGGER_STATE) {
+            flightRecorderTrigger(&flightRecorder, FLIGHT_RECORDER_CAUSE_STATE);
+        }
+    }
 }
 
 /** changes the screen to the current screen received from getCurrentScreen() */
@@ -287,47 +898,185 @@ displayUpdateTick(void)
     }
 }
 
-/** Background task: calculate the (approximate) mean of the values in the
-circular buffer and display it, together with the sample number. */
-void 
-adcMeanSampleUpdateTick(void)
+/** displays the information required onto the termal using UART */
+void
+uartUpdateTick(void)
 {
-    heightRawAvg = readSampleAverageBuffer();
-    heightPercent = (-(heightRawAvg - low_alt_ADC_limit) * 100) / (HIGH_ALT_ADC_OFFSET);
+    loopJitter_t jitter;
+    benchmarkResult_t benchmark[CONTROL_BENCHMARK_LAWS];
+    stepResult_t step;
+    carrierSweepResult_t sweep;
+
+    uartBaudTick(1000 / UART_RATE_HZ);
+
+    // The status goes out in the binary frames instead, only the reports below are still text
+    if (!binaryTelemetry) {
+        usprintf (UARTbuffer, "FLIGHT MODE: %d \r\n", currentState);
+        UARTSend(UARTbuffer);
+
+        usprintf (UARTbuffer, "ALTITUDE| current: %d target: %d \r\n", heightPercent, heightTarget);
+        UARTSend(UARTbuffer);
+
+        usprintf (UARTbuffer, "YAW     | current: %d target: %d \r\n", yawAngle, yawTarget);
+        UARTSend(UARTbuffer);
+
+        usprintf (UARTbuffer, "DUTY CYC| altitude: %d.%d yaw: %d.%d \r\n", currentPwmAlt / 10, currentPwmAlt % 10,
+                  currentPwmYaw / 10, currentPwmYaw % 10);
+        UARTSend(UARTbuffer);
+
+        readLoopJitter(&jitter);
+        usprintf (UARTbuffer, "LOOP    | dt: %d-%d us jitter: %d us uart drops: %d lost: %d log drops: %d \r\n",
+                  jitter.minDt, jitter.maxDt, jitter.maxJitter, uartDroppedFrames(), uartRxOverflows(),
+                  logDroppedRecords());
+        UARTSend(UARTbuffer);
+    }
+
+    // The reports are logged and go out with the rest of the log in logFlushTick()
+    if (readStepMetrics(&altStepMetrics, &step)) {
+        LOG(LOG_STEP_ALT, step.size, step.riseTimeMs, step.overshootPermille, step.settlingTimeMs, step.settled,
+            step.integratedError);
+    }
+    if (readStepMetrics(&yawStepMetrics, &step)) {
+        LOG(LOG_STEP_YAW, step.size, step.riseTimeMs, step.overshootPermille, step.settlingTimeMs, step.settled,
+            step.integratedError);
+    }
+
+    if (readCarrierSweep(&carrierSweep, &sweep)) {
+        LOG(LOG_SWEEP, sweep.frequency, sweep.noise);
+    }
+
+    if (readControlBenchmark(CONTROL_STRATEGY_INT_PID, &benchmark[CONTROL_STRATEGY_INT_PID])) {
+        readControlBenchmark(CONTROL_STRATEGY_FLOAT_PID, &benchmark[CONTROL_STRATEGY_FLOAT_PID]);
+        readControlBenchmark(CONTROL_STRATEGY_CASCADE, &benchmark[CONTROL_STRATEGY_CASCADE]);
+        readControlBenchmark(CONTROL_STRATEGY_STATE_SPACE, &benchmark[CONTROL_STRATEGY_STATE_SPACE]);
+        LOG(LOG_BENCH,
+            benchmark[CONTROL_STRATEGY_INT_PID].averageCycles, benchmark[CONTROL_STRATEGY_INT_PID].maxCycles,
+            benchmark[CONTROL_STRATEGY_FLOAT_PID].averageCycles, benchmark[CONTROL_STRATEGY_FLOAT_PID].maxCycles,
+            benchmark[CONTROL_STRATEGY_CASCADE].averageCycles, benchmark[CONTROL_STRATEGY_CASCADE].maxCycles,
+            benchmark[CONTROL_STRATEGY_STATE_SPACE].averageCycles, benchmark[CONTROL_STRATEGY_STATE_SPACE].maxCycles);
+    }
 }
 
-/** displays the information required onto the termal using UART */
+/** sends the oldest log records, as binary frames for tools/telemetryDecode or as text lines in text mode */
 void
-uartUpdateTick(void)
+logFlushTick(void)
 {
-    usprintf (UARTbuffer, "FLIGHT MODE: %d \r\n", currentState);
-    UARTSend(UARTbuffer);
+    logRecord_t record;
+    uint8_t sent;
+
+    for (sent = 0; sent < LOG_FLUSH_RECORDS && logRead(&record); sent++) {
+        if (binaryTelemetry) {
+            telemetrySendLog(&record);
+        } else {
+            logFormatText(&record, UARTbuffer, UART_MAX_LENGTH);
+            UARTSend(UARTbuffer);
+        }
+    }
+}
 
-    usprintf (UARTbuffer, "ALTITUDE| current: %d target: %d \r\n", heightPercent, heightTarget);
-    UARTSend(UARTbuffer);
+/** sends the status as a binary telemetry frame, no string formatting */
+void
+telemetryUpdateTick(void)
+{
+    loopJitter_t jitter;
+    telemetryStatus_t status;
 
-    usprintf (UARTbuffer, "YAW     | current: %d target: %d \r\n", yawAngle, yawTarget);
-    UARTSend(UARTbuffer);
+    if (!binaryTelemetry) {
+        return;
+    }
 
-    usprintf (UARTbuffer, "DUTY CYC| altitude: %d yaw: %d \r\n", currentPwmAlt, currentPwmYaw);
-    UARTSend(UARTbuffer);
+    readLoopJitter(&jitter);
+    status.state = currentState;
+    status.altitude = heightPercent;
+    status.altitudeTarget = heightTarget;
+    status.yaw = yawAngle;
+    status.yawTarget = yawTarget;
+    status.mainDuty = currentPwmAlt;
+    status.tailDuty = currentPwmYaw;
+    status.loopJitter = (jitter.maxJitter > UINT16_MAX) ? UINT16_MAX : jitter.maxJitter;
+    status.uartDrops = uartDroppedFrames();
+    telemetrySendStatus(&status);
+}
+
+/** sends the next record of a flight recorder dump, as a binary frame for tools/telemetryDecode or as a text line in
+text mode. Waits while the Uart ring is nearly full rather than have records dropped */
+void
+recorderDumpTick(void)
+{
+    flightRecord_t record;
+
+    if (!recorderDumping || uartTxSpace() < RECORDER_DUMP_TX_SPACE) {
+        return;
+    }
+
+    if (!flightRecorderRead(&flightRecorder, recorderDumpIndex, &record)) {
+        recorderDumping = false;
+        return;
+    }
+
+    if (binaryTelemetry) {
+        telemetrySendRecord(recorderDumpIndex, &record);
+    } else {
+        usnprintf (UARTbuffer, UART_MAX_LENGTH, "RECORD  | %d tick: %d adc: %d err: %d %d alt: %d %d %d yaw: %d %d %d duty: %d %d \r\n",
+                   recorderDumpIndex, record.tick, record.adcMean, record.altError, record.yawError,
+                   record.altProportional, record.altIntegral, record.altDerivative,
+                   record.yawProportional, record.yawIntegral, record.yawDerivative, record.mainDuty, record.tailDuty);
+        UARTSend(UARTbuffer);
+    }
+    recorderDumpIndex++;
+}
+
+/** feeds the chars received over the Uart to the command parser and queues each finished command for the next
+flight logic tick. The commands are listed in IO/commandParser.h */
+void
+uartCommandTick(void)
+{
+    char received;
+    command_t command;
+
+    while (uartReadChar(&received)) {
+        switch (commandParserFeed(&commandParser, received, &command)) {
+            case COMMAND_PARSE_DONE:
+                if (pendingCommandCount < COMMAND_QUEUE_LENGTH) {
+                    pendingCommands[pendingCommandCount++] = command;
+                } else {
+                    UARTSend("BUSY\r\n");
+                }
+                break;
+            case COMMAND_PARSE_ERROR:
+                UARTSend("ERR\r\n");
+                break;
+        }
+    }
 }
 
 /** initializes all of the PID controllers */
 void
 initPIDControllers(void)
 {
-    // Calculate the slow system tick max ticks.
-    slowSysTickMax = SYS_TICK_INTERRUPT_RATE_HZ / CONTROLLER_RATE_HZ;
-
     // Initiate the controller struts.
-    controllerPIDInit(&altController, SYS_TICK_INTERRUPT_RATE_HZ / CONTROLLER_RATE_HZ, ALT_KP, ALT_KI, ALT_KD);
-    controllerPIDInit(&yawController, SYS_TICK_INTERRUPT_RATE_HZ / CONTROLLER_RATE_HZ, YAW_KP, YAW_KI, YAW_KD);
-
-    // Register the PID interrupt handler
-    IntRegister(INT_EMAC0_TM4C129, PidIntHandler);
-    IntPrioritySet(INT_EMAC0_TM4C129, 224);
-    IntEnable(INT_EMAC0_TM4C129);
+    ALT_STRATEGY(Init)(&altController, CONTROL_AXIS_ALT, &altControlConfig);
+    YAW_STRATEGY(Init)(&yawController, CONTROL_AXIS_YAW, &yawControlConfig);
+    initControlBenchmark(&altControlConfig, &yawControlConfig);
+    initYawCoupling(YAW_COUPLING_GAIN, YAW_COUPLING_OFFSET);
+    rateEstimatorInit(&altRateEstimator, ALT_RATE_ALPHA, ALT_RATE_BETA);
+    rateEstimatorInit(&yawRateEstimator, YAW_RATE_ALPHA, YAW_RATE_BETA);
+    initDisturbanceObserver(&altObserver, ALT_DOB_MODEL_GAIN, SS_MAIN_TRIM, ALT_DOB_BANDWIDTH, ALT_DOB_LIMIT);
+    initDisturbanceObserver(&yawObserver, YAW_DOB_MODEL_GAIN, SS_TAIL_TRIM, YAW_DOB_BANDWIDTH, YAW_DOB_LIMIT);
+    trajectoryInit(&altTrajectory, ALT_TRAJECTORY_MAX_RATE, ALT_TRAJECTORY_MAX_ACCEL, 0, 0);
+    trajectoryInit(&yawTrajectory, YAW_TRAJECTORY_MAX_RATE, YAW_TRAJECTORY_MAX_ACCEL, 360, 0);
+    thrustTableInit(&mainThrustTable);
+    initCarrierSweep(&carrierSweep);
+    initFlightRecorder(&flightRecorder);
+    initCommandParser(&commandParser);
+    initStepMetrics(&altStepMetrics);
+    initStepMetrics(&yawStepMetrics);
+
+    pwmActuatorConfigure(PWM_ROTOR_MAIN, MAIN_ROTOR_SLEW_RATE, ROTOR_SPIN_UP_US);
+    pwmActuatorConfigure(PWM_ROTOR_TAIL, TAIL_ROTOR_SLEW_RATE, ROTOR_SPIN_UP_US);
+
+    // Register the PID interrupt handler, the timer is started once the ADC has a ground reference
+    initLoopTimer(CONTROLLER_RATE_HZ, PidIntHandler);
 }
 
 
@@ -358,13 +1107,14 @@ main(void)
 
 	uint32_t displayTick = 0;
 	uint32_t flightLogicControllerTick = 0;
-	uint32_t adcMeanSampleTick = 0;
 	uint32_t uartTick = 0;
+	uint32_t telemetryTick = 0;
+	uint32_t logTick = 0;
 
 	uint32_t displayMaxTicks = PACER_RATE_HZ / DISPLAY_UPDATE_RATE_HZ;
 	uint32_t flightLogicControllerMaxTicks = PACER_RATE_HZ / FLIGHT_LOGIC_RATE_HZ;
-	uint32_t adcMeanSampleMaxTicks = PACER_RATE_HZ / ADC_MEAN_SAMPLE_RATE_HZ;
 	uint32_t uartMaxTicks = PACER_RATE_HZ / UART_RATE_HZ;
+	uint32_t logMaxTicks = PACER_RATE_HZ / LOG_FLUSH_RATE_HZ;
 
 	uint32_t pacerDelay = SysCtlClockGet() / PACER_RATE_HZ;
 
@@ -378,11 +1128,15 @@ main(void)
 	initYawController();
 	initPIDControllers();
 	initPwm();
+	pwmDitherEnable(PWM_DITHER);
 	initUart();
 
     // Enable interrupts to the processor.
     IntMasterEnable();
 
+    // The log timestamps count system clock cycles, tell the host how fast
+    LOG(LOG_CLOCK, SysCtlClockGet());
+
     // ---- Run Calibration Procedure ----
     // Wait until the ADC sample average buffer has filled
     while(bufferIsNotFull()) {
@@ -391,16 +1145,13 @@ main(void)
     // Compute the low altitude ADC value
     low_alt_ADC_limit = readSampleAverageBuffer();
 
+    // Start the control loop now the height can be measured
+    startLoopTimer();
 
 	while (1)
 	{
 	    SysCtlDelay(pacerDelay);
 
-	    if (adcMeanSampleTick >= adcMeanSampleMaxTicks) {
-            adcMeanSampleUpdateTick();
-            adcMeanSampleTick = 0;
-	    }
-
 		if (displayTick >= displayMaxTicks) {
 		    displayUpdateTick();
 		    displayTick = 0;
@@ -411,15 +1162,30 @@ main(void)
 		    flightLogicControllerTick = 0;
 		}
 
+		controlBenchmarkUpdate();
+		uartCommandTick();
+		recorderDumpTick();
+
 		if (uartTick >= uartMaxTicks) {
 		    uartUpdateTick();
 		    uartTick = 0;
 		}
 
+		if (telemetryTick >= telemetryMaxTicks) {
+		    telemetryUpdateTick();
+		    telemetryTick = 0;
+		}
+
+		if (logTick >= logMaxTicks) {
+		    logFlushTick();
+		    logTick = 0;
+		}
+
 		flightLogicControllerTick++;
 		displayTick++;
-        adcMeanSampleTick++;
         uartTick++;
+        telemetryTick++;
+        logTick++;
 
 	}
 
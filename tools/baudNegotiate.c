@@ -0,0 +1,241 @@
+// *******************************************************
+//
+//  baudNegotiate.c
+//
+//  Host side of the Uart baud rate handshake in IO/uart.c. Opens the board's serial port at the rate it starts at,
+//  asks for its offer, picks the fastest rate both ends can run and switches both ends over, confirming the link at
+//  the new rate. Prints the rate the link ended up at, which is what the port has to be opened at afterwards.
+//
+//  Build and run on the host, not the board:
+//      cc -o baudNegotiate tools/baudNegotiate.c
+//      ./baudNegotiate /dev/ttyACM0 [highest rate]
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+
+#include "../IO/uart.h"
+
+#define REPLY_TIMEOUT_MS 1000 // the longest the board takes to answer at 9600 behind a queue of telemetry
+#define SYNC_ATTEMPTS 8 // the syncs sent at the new rate, inside the board's UART_BAUD_SYNC_TIMEOUT_MS
+#define SYNC_INTERVAL_MS 100
+#define LINE_LENGTH 256
+
+typedef struct {
+    uint32_t rate; // the baud rate
+    speed_t speed; // its termios speed
+} hostRate_t; // a rate the host's serial driver can run
+
+static const hostRate_t hostRates[] = {
+#ifdef B2500000
+    {2500000, B2500000},
+#endif
+#ifdef B2000000
+    {2000000, B2000000},
+#endif
+#ifdef B1000000
+    {1000000, B1000000},
+#endif
+#ifdef B921600
+    {921600, B921600},
+#endif
+#ifdef B460800
+    {460800, B460800},
+#endif
+    {230400, B230400},
+    {115200, B115200},
+    {57600, B57600},
+    {38400, B38400},
+    {19200, B19200},
+    {9600, B9600},
+}; // fastest first
+
+
+/** Returns the termios speed for a rate
+@param rate the baud rate
+@param speed where to write the speed
+@return false if the host can't run the rate */
+static bool
+hostSpeed (uint32_t rate, speed_t* speed)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(hostRates) / sizeof(hostRates[0]); i++) {
+        if (hostRates[i].rate == rate) {
+            *speed = hostRates[i].speed;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Sets the port to a rate, 8 bits, 1 stop bit, no parity, raw
+@param port the port
+@param rate the baud rate
+@return false if the port couldn't be set */
+static bool
+setPortRate (int port, uint32_t rate)
+{
+    struct termios options;
+    speed_t speed;
+
+    if (!hostSpeed(rate, &speed) || tcgetattr(port, &options) != 0) {
+        return false;
+    }
+    cfmakeraw(&options);
+    options.c_cflag |= CLOCAL | CREAD;
+    options.c_cflag &= ~(CSTOPB | PARENB);
+    cfsetispeed(&options, speed);
+    cfsetospeed(&options, speed);
+    return tcsetattr(port, TCSANOW, &options) == 0;
+}
+
+/** Sends a command line
+@param port the port
+@param command the command, without its line ending */
+static void
+sendCommand (int port, const char* command)
+{
+    if (write(port, command, strlen(command)) < 0 || write(port, "\r", 1) < 0) {
+        perror("write");
+    }
+    tcdrain(port);
+}
+
+/** Waits for a line from the board starting with a prefix. Everything else on the link, telemetry frames and
+reports, is skipped
+@param port the port
+@param prefix the start of the line wanted
+@param line where to write the line, from the prefix on
+@param timeoutMs the longest to wait
+@return false if no such line arrived in time */
+static bool
+waitForLine (int port, const char* prefix, char* line, uint32_t timeoutMs)
+{
+    char received[LINE_LENGTH];
+    size_t length = 0;
+    struct timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    fd_set ports;
+    char c;
+    char* start;
+
+    for (;;) {
+        FD_ZERO(&ports);
+        FD_SET(port, &ports);
+        if (select(port + 1, &ports, NULL, NULL, &timeout) <= 0 || read(port, &c, 1) != 1) {
+            return false;
+        }
+
+        if (c == '\n' || c == '\r' || c == '\0') {
+            received[length] = '\0';
+            // A line can follow a binary frame with no delimiter of its own, so look for the prefix anywhere in it
+            start = strstr(received, prefix);
+            if (start != NULL) {
+                strcpy(line, start);
+                return true;
+            }
+            length = 0;
+        } else if (length < sizeof(received) - 1) {
+            received[length++] = c;
+        }
+    }
+}
+
+/** Runs the handshake on an open port at BAUD_RATE
+@param port the port
+@param highest the fastest rate to accept, 0 for no limit
+@return the rate the link ended up at */
+uint32_t
+negotiateBaudRate (int port, uint32_t highest)
+{
+    char line[LINE_LENGTH];
+    char command[32];
+    char expected[32];
+    char* next;
+    uint32_t offered;
+    uint32_t chosen = 0;
+    speed_t speed;
+    int attempt;
+
+    // The offer lists the board's rates fastest first, take the first the host can run too
+    sendCommand(port, "BAUD?");
+    if (!waitForLine(port, "BAUD?", line, REPLY_TIMEOUT_MS)) {
+        fprintf(stderr, "no offer from the board\n");
+        return BAUD_RATE;
+    }
+    next = line + strlen("BAUD?");
+    while (chosen == 0 && (offered = strtoul(next, &next, 10)) != 0) {
+        if ((highest == 0 || offered <= highest) && hostSpeed(offered, &speed)) {
+            chosen = offered;
+        }
+    }
+    if (chosen == 0 || chosen == BAUD_RATE) {
+        fprintf(stderr, "no faster rate both ends can run: %s\n", line);
+        return BAUD_RATE;
+    }
+
+    snprintf(command, sizeof(command), "BAUD %u", chosen);
+    snprintf(expected, sizeof(expected), "BAUD OK %u", chosen);
+    sendCommand(port, command);
+    if (!waitForLine(port, expected, line, REPLY_TIMEOUT_MS)) {
+        fprintf(stderr, "the board didn't acknowledge %u\n", chosen);
+        return BAUD_RATE;
+    }
+
+    // The board switches once its acknowledgement has gone out, confirm the link at the new rate before it gives up
+    if (!setPortRate(port, chosen)) {
+        perror("tcsetattr");
+        return BAUD_RATE;
+    }
+    tcflush(port, TCIOFLUSH);
+    for (attempt = 0; attempt < SYNC_ATTEMPTS; attempt++) {
+        sendCommand(port, "BAUD SYNC");
+        if (waitForLine(port, "BAUD SYNC", line, SYNC_INTERVAL_MS)) {
+            return chosen;
+        }
+    }
+
+    fprintf(stderr, "no sync at %u, the board has gone back to %u\n", chosen, BAUD_RATE);
+    setPortRate(port, BAUD_RATE);
+    return BAUD_RATE;
+}
+
+#ifndef BAUD_NEGOTIATE_NO_MAIN // tools/baudTest.c builds this file in to run the handshake against the board's side
+int
+main (int argc, char** argv)
+{
+    int port;
+    uint32_t highest = 0;
+    uint32_t rate;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s port [highest rate]\n", argv[0]);
+        return 2;
+    }
+    if (argc == 3) {
+        highest = strtoul(argv[2], NULL, 10);
+    }
+
+    port = open(argv[1], O_RDWR | O_NOCTTY);
+    if (port < 0 || !setPortRate(port, BAUD_RATE)) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    rate = negotiateBaudRate(port, highest);
+    printf("%u\n", rate);
+    close(port);
+    return (rate != BAUD_RATE) ? 0 : 1;
+}
+#endif
@@ -0,0 +1,257 @@
+// *******************************************************
+//
+//  baudTest.c
+//
+//  Host side check of the Uart baud rate handshake. Opens a pty pair and runs the board's side of the handshake,
+//  IO/baudHandshake.c behind the command parser, on the master end in a child process. The host side in
+//  tools/baudNegotiate.c runs on the slave end. A pty doesn't care about the rate, so the board's side drops
+//  everything both ways while the rate the slave end is set to doesn't match its own, like a real link would garble it.
+//
+//  The runs, in order, exit non-zero if any fails:
+//      a sync while no new rate is waiting is refused
+//      a new rate the host never confirms falls back to BAUD_RATE after UART_BAUD_SYNC_TIMEOUT_MS
+//      the full handshake moves both ends to the fastest rate they share, and the link works at it
+//      a sync after the new rate was confirmed is refused
+//
+//  Build and run on the host, not the board:
+//      cc -o baudTest tools/baudTest.c IO/baudHandshake.c IO/commandParser.c
+//      ./baudTest
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+#define BAUD_NEGOTIATE_NO_MAIN
+#include "baudNegotiate.c"
+
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "../IO/baudHandshake.h"
+#include "../IO/commandParser.h"
+
+#define BOARD_CLOCK_HZ 20000000 // the system clock main.c sets up
+#define BOARD_TICK_MS 10 // how often the board's side runs the rate switch, the Uart pacer rate on the board
+#define FALLBACK_WAIT_MS (UART_BAUD_SYNC_TIMEOUT_MS + 200) // long enough for an unconfirmed rate to be dropped
+
+
+/** Returns the rate the slave end is set to
+@param slave the slave end
+@return the baud rate, 0 if it isn't one the host runs */
+static uint32_t
+slaveRate (int slave)
+{
+    struct termios options;
+    speed_t speed;
+    size_t i;
+
+    if (tcgetattr(slave, &options) != 0) {
+        return 0;
+    }
+    speed = cfgetospeed(&options);
+    for (i = 0; i < sizeof(hostRates) / sizeof(hostRates[0]); i++) {
+        if (hostRates[i].speed == speed) {
+            return hostRates[i].rate;
+        }
+    }
+    return 0;
+}
+
+/** Returns a millisecond count for measuring the time between ticks
+@return the time in milliseconds */
+static uint32_t
+nowMs (void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+/** Sends a reply from the board's side, dropped if the two ends are at different rates. Like uart.c nothing but the
+acknowledgement of the new rate is sent while the switch to it is waiting to happen
+@param handshake the handshake
+@param master the master end
+@param slave the slave end, for its rate
+@param reply the reply line */
+static void
+boardSend (const baudHandshake_t* handshake, int master, int slave, const char* reply)
+{
+    if ((handshake->state == UART_BAUD_SWITCHING && strncmp(reply, "BAUD OK", 7) != 0)
+            || slaveRate(slave) != handshake->rate) {
+        return;
+    }
+    if (write(master, reply, strlen(reply)) < 0) {
+        perror("write");
+    }
+}
+
+/** Runs the board's side of the handshake on the master end until it is killed
+@param master the master end
+@param slave the slave end, for its rate */
+static void
+runBoard (int master, int slave)
+{
+    baudHandshake_t handshake;
+    commandParser_t parser;
+    command_t command;
+    char reply[UART_BAUD_OFFER_LENGTH];
+    uint32_t lastTickMs = nowMs();
+    uint32_t now;
+    struct timeval timeout;
+    fd_set ports;
+    char c;
+
+    baudHandshakeInit(&handshake, BOARD_CLOCK_HZ);
+    initCommandParser(&parser);
+
+    for (;;) {
+        FD_ZERO(&ports);
+        FD_SET(master, &ports);
+        timeout.tv_sec = 0;
+        timeout.tv_usec = BOARD_TICK_MS * 1000;
+        if (select(master + 1, &ports, NULL, NULL, &timeout) > 0) {
+            if (read(master, &c, 1) != 1) {
+                return;
+            }
+            // A char sent at the wrong rate never arrives as itself
+            if (slaveRate(slave) == handshake.rate
+                    && commandParserFeed(&parser, c, &command) == COMMAND_PARSE_DONE) {
+                if (command.type == COMMAND_BAUD_OFFER) {
+                    baudHandshakeOffer(&handshake, reply, sizeof(reply));
+                    boardSend(&handshake, master, slave, reply);
+                } else if (command.type == COMMAND_BAUD) {
+                    baudHandshakeAccept(&handshake, command.args[0], reply, sizeof(reply));
+                    boardSend(&handshake, master, slave, reply);
+                } else if (command.type == COMMAND_BAUD_SYNC) {
+                    baudHandshakeSync(&handshake, reply, sizeof(reply));
+                    boardSend(&handshake, master, slave, reply);
+                }
+            }
+        }
+
+        // The replies go straight out, so the transmit side is always idle by the next tick
+        now = nowMs();
+        if (now - lastTickMs >= BOARD_TICK_MS) {
+            baudHandshakeTick(&handshake, true, now - lastTickMs);
+            lastTickMs = now;
+        }
+    }
+}
+
+/** Prints a run's result
+@param name what the run checks
+@param passed true if it did what it should
+@return passed */
+static bool
+report (const char* name, bool passed)
+{
+    printf("%-44s %s\n", name, passed ? "ok" : "FAIL");
+    return passed;
+}
+
+/** Sends a sync at the port's current rate and checks it is refused
+@param port the slave end
+@return true if the board refused it */
+static bool
+syncRefused (int port)
+{
+    char line[LINE_LENGTH];
+
+    sendCommand(port, "BAUD SYNC");
+    return waitForLine(port, "BAUD ", line, REPLY_TIMEOUT_MS) && strncmp(line, "BAUD REFUSED", 12) == 0;
+}
+
+/** Asks for the offer at the port's current rate, showing whether the board is at the same rate
+@param port the slave end
+@return true if the offer came back */
+static bool
+offerAnswered (int port)
+{
+    char line[LINE_LENGTH];
+
+    tcflush(port, TCIOFLUSH);
+    sendCommand(port, "BAUD?");
+    return waitForLine(port, "BAUD?", line, REPLY_TIMEOUT_MS);
+}
+
+/** Accepts a new rate on the board and then never follows it, checking the board goes back to BAUD_RATE
+@param port the slave end, at BAUD_RATE
+@return true if the board fell back */
+static bool
+unconfirmedRateDropped (int port)
+{
+    char line[LINE_LENGTH];
+
+    sendCommand(port, "BAUD 115200");
+    if (!waitForLine(port, "BAUD OK 115200", line, REPLY_TIMEOUT_MS)) {
+        return false;
+    }
+
+    // Still at the old rate the sync never gets through, and the board isn't answering at it while it waits
+    sendCommand(port, "BAUD SYNC");
+    if (waitForLine(port, "BAUD", line, SYNC_INTERVAL_MS)) {
+        return false;
+    }
+
+    usleep(FALLBACK_WAIT_MS * 1000);
+    return offerAnswered(port);
+}
+
+int
+main (void)
+{
+    int master;
+    int slave;
+    pid_t board;
+    uint32_t rate;
+    uint8_t failures = 0;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0 || !setPortRate(slave, BAUD_RATE)) {
+        perror("ptsname");
+        return 1;
+    }
+
+    board = fork();
+    if (board < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (board == 0) {
+        runBoard(master, slave);
+        _exit(0);
+    }
+
+    if (!report("sync with no new rate waiting is refused", syncRefused(slave))) {
+        failures++;
+    }
+    if (!report("unconfirmed rate falls back to BAUD_RATE", unconfirmedRateDropped(slave))) {
+        failures++;
+    }
+
+    rate = negotiateBaudRate(slave, 0);
+    if (!report("handshake moves both ends to a faster rate", rate != BAUD_RATE && slaveRate(slave) == rate
+                && offerAnswered(slave))) {
+        failures++;
+    }
+    if (!report("sync after the rate was confirmed is refused", syncRefused(slave))) {
+        failures++;
+    }
+    printf("link ended at %u, %u runs failed\n", (unsigned)slaveRate(slave), (unsigned)failures);
+
+    kill(board, SIGTERM);
+    waitpid(board, NULL, 0);
+    close(slave);
+    close(master);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,789 @@
+// *******************************************************
+//
+//  controlSim.c
+//
+//  Host side closed loop simulation of the control laws in controllers/controlStrategy.h against a model of the rig.
+//  Each run drives the laws the way PidIntHandler() in main.c does, through the same setpoint profiles, rate
+//  estimators, duty clamp and slew limit, with the measurements rounded the way the ADC and yaw decoder give them.
+//
+//  The rig model is two rigid axes. The climb acceleration follows the main duty about its hover duty, the yaw
+//  acceleration follows the tail duty about a trim that rises with the main duty, and both have linear drag. The RIG_*
+//  parameters are a nominal model matched to the hover trims and tuning in main.c, replace them with a rig's
+//  identified values and rerun.
+//
+//  It prints:
+//   - The full state feedback gain matrix from an LQR design on the model, in the form main.c takes it.
+//   - The step response of each law against the other, rise time, overshoot, settling time, steady error and the
+//     error the step couples into the other axis.
+//   - A climb held at the bottom stop by a load the main rotor can't lift and then released, with the overshoot and
+//     the time to recover after the release for each anti-windup mode of the single loop PID.
+//   - The cascade against the single loop PID, the same steps and a load added to the rig while it holds a hover,
+//     with the peak error the load causes and the time to recover from it.
+//   - The host time and cycles each law takes per update over the same recorded inputs. The cycles are the x86 time
+//     stamp counter and only printed on x86 hosts. The board's figures come from controllers/controlBenchmark.c.
+//
+//  Build and run on the host, not the board:
+//      cc -O2 -o controlSim tools/controlSim.c controllers/PIDController.c controllers/floatPIDController.c
+//          controllers/cascadeController.c controllers/stateSpaceController.c controllers/rateEstimator.c
+//          controllers/trajectory.c -lm
+//      ./controlSim
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HOST_CYCLES() __rdtsc() // the time stamp counter
+#endif
+
+#include "../controllers/controlStrategy.h"
+#include "../controllers/rateEstimator.h"
+#include "../controllers/trajectory.h"
+#include "../IO/pwm.h"
+
+// The control loop, the same as main.c
+#define LOOP_RATE_HZ 500
+#define LOOP_DT_US (1000000 / LOOP_RATE_HZ)
+#define LOOP_DT_S (1.0 / LOOP_RATE_HZ)
+#define PLANT_STEPS 10 // the rig model is stepped this many times per loop iteration
+
+// The rig model
+#define RIG_THRUST_GAIN 0.5 // percent per second squared of climb per permille of main duty above the hover duty
+#define RIG_HOVER_DUTY 400 // the main duty that holds the altitude, SS_MAIN_TRIM in main.c
+#define RIG_CLIMB_DRAG 2.0 // per second
+#define RIG_TAIL_GAIN 0.5 // degrees per second squared of turn per permille of tail duty above the tail trim
+#define RIG_TAIL_TRIM 400 // the tail duty that holds the heading at the hover duty, SS_TAIL_TRIM in main.c
+#define RIG_TAIL_COUPLING 0.8 // permille of tail trim per permille of main duty above the hover duty
+#define RIG_YAW_DRAG 3.0 // per second
+#define RIG_ALTITUDE_MAX 100.0 // the top of travel in percent, the bottom is 0
+
+// The settings main.c builds the laws with
+#define ALT_KP 15
+#define ALT_KI 40
+#define ALT_KD 0
+#define YAW_KP 80
+#define YAW_KI 120
+#define YAW_KD 0
+#define ALT_OUTER_KP 2
+#define ALT_OUTER_KI 0
+#define ALT_OUTER_KD 0
+#define ALT_INNER_KP 6
+#define ALT_INNER_KI 40
+#define ALT_INNER_KD 0
+#define ALT_CASCADE_MAX_RATE 30
+#define YAW_OUTER_KP 8
+#define YAW_OUTER_KI 0
+#define YAW_OUTER_KD 0
+#define YAW_INNER_KP 8
+#define YAW_INNER_KI 40
+#define YAW_INNER_KD 0
+#define YAW_CASCADE_MAX_RATE 90
+#define ALT_SETPOINT_WEIGHT_P 100
+#define ALT_SETPOINT_WEIGHT_D 0
+#define ALT_DERIVATIVE_FILTER_US 20000
+#define YAW_SETPOINT_WEIGHT_D 0
+#define YAW_DERIVATIVE_FILTER_US 20000
+#define ALT_ANTIWINDUP_MODE PID_ANTIWINDUP_BACK_CALCULATION
+#define ALT_TRACKING_TIME_US 100000
+#define YAW_ANTIWINDUP_MODE PID_ANTIWINDUP_BACK_CALCULATION
+#define YAW_TRACKING_TIME_US 100000
+#define ALT_RATE_ALPHA 64
+#define ALT_RATE_BETA 8
+#define YAW_RATE_ALPHA 64
+#define YAW_RATE_BETA 8
+#define ALT_TRAJECTORY_MAX_RATE 25
+#define ALT_TRAJECTORY_MAX_ACCEL 50
+#define YAW_TRAJECTORY_MAX_RATE 90
+#define YAW_TRAJECTORY_MAX_ACCEL 180
+#define MAIN_ROTOR_SLEW_RATE 400
+#define TAIL_ROTOR_SLEW_RATE 1000
+#define SS_GAIN_SHIFT 8
+#define SS_MAIN_TRIM RIG_HOVER_DUTY
+#define SS_TAIL_TRIM RIG_TAIL_TRIM
+
+// The LQR design, Bryson's rule, each weight is one over the square of the largest error wanted in that state
+#define LQR_ALTITUDE_ERROR 6.0 // percent
+#define LQR_CLIMB_RATE_ERROR 30.0 // percent per second
+#define LQR_YAW_ERROR 10.0 // degrees
+#define LQR_YAW_RATE_ERROR 90.0 // degrees per second
+#define LQR_DUTY_CHANGE 300.0 // permille, the duty either rotor has above or below its trim
+#define LQR_ITERATIONS 200000 // Riccati iterations at the loop rate, far past convergence
+#define LQR_TOLERANCE 1e-9 // the relative change in the cost matrix taken as converged
+
+// The step measurements
+#define SETTLE_FRACTION 0.02 // settled once within this fraction of the step for good
+#define SETTLE_MIN_BAND 1 // and never tighter than one unit, the measurement resolution
+#define FINAL_SECONDS 1 // the steady error is averaged over the end of the run
+#define TIMING_PASSES 2000 // passes over the recorded inputs when timing the laws
+
+enum simAxes {SIM_ALT = 0, SIM_YAW, SIM_AXES};
+
+typedef struct {
+    double altitude; // percent
+    double climbRate; // percent per second
+    double yaw; // degrees, continuous
+    double yawRate; // degrees per second
+} rig_t; // the simulated rig
+
+typedef struct {
+    uint8_t law; // the CONTROL_STRATEGY_* the axis runs
+    PIDController_t intPID;
+    floatPIDController_t floatPID;
+    cascadeController_t cascade;
+    stateSpaceController_t stateSpace;
+} simController_t; // one axis' controller, whichever law it runs
+
+typedef struct {
+    const char* name; // what the run shows
+    uint8_t axis; // the axis stepped, from simAxes
+    int32_t start[SIM_AXES]; // where the rig starts, holding a hover
+    int32_t goal[SIM_AXES]; // the targets set at the start of the run
+    double seconds; // how long the run lasts
+    double loadTime; // seconds into the run the load is added
+    int32_t load[SIM_AXES]; // the extra duty in permille each rotor needs to hold the rig once loaded
+    double releaseTime; // seconds into the run the load is taken off again, zero to leave it on
+} simRun_t; // one closed loop run
+
+typedef struct {
+    double riseTime; // seconds from 10% to 90% of the step, negative if never reached
+    double overshoot; // percent of the step
+    double settleTime; // seconds until the error stays in the settle band, negative if it never does
+    double steadyError; // the mean error over the end of the run, in the axis' units
+    double crossError; // the largest error the step coupled into the other axis
+    double peakError; // the largest error once the load was added
+    double recoveryTime; // seconds from the load until the error stays in the settle band, negative if it never does
+} simResult_t; // the measurements of one run
+
+static const char* const lawNames[] = {"int PID", "float PID", "cascade", "state space"}; // by CONTROL_STRATEGY_*
+
+static int16_t stateSpaceGains[SS_NUM_INPUTS][SS_NUM_STATES]; // the Q15 LQR gains
+static const int32_t stateSpaceTrim[SS_NUM_INPUTS] = {SS_MAIN_TRIM, SS_TAIL_TRIM};
+
+static controlConfig_t altConfig = {
+    {ALT_KP, ALT_KI, ALT_KD}, ALT_SETPOINT_WEIGHT_P, ALT_SETPOINT_WEIGHT_D, ALT_DERIVATIVE_FILTER_US,
+    ALT_ANTIWINDUP_MODE, ALT_TRACKING_TIME_US,
+    {ALT_OUTER_KP, ALT_OUTER_KI, ALT_OUTER_KD}, {ALT_INNER_KP, ALT_INNER_KI, ALT_INNER_KD}, ALT_CASCADE_MAX_RATE,
+    stateSpaceGains, SS_GAIN_SHIFT, stateSpaceTrim,
+}; // the altitude settings, the same as main.c's
+static controlConfig_t yawConfig = {
+    {YAW_KP, YAW_KI, YAW_KD}, PID_WEIGHT_FULL, YAW_SETPOINT_WEIGHT_D, YAW_DERIVATIVE_FILTER_US,
+    YAW_ANTIWINDUP_MODE, YAW_TRACKING_TIME_US,
+    {YAW_OUTER_KP, YAW_OUTER_KI, YAW_OUTER_KD}, {YAW_INNER_KP, YAW_INNER_KI, YAW_INNER_KD}, YAW_CASCADE_MAX_RATE,
+    stateSpaceGains, SS_GAIN_SHIFT, stateSpaceTrim,
+}; // the yaw settings, the same as main.c's
+
+// The inputs of one run are kept for timing the laws over
+#define RECORD_LENGTH (10 * LOOP_RATE_HZ)
+static controlState_t recordedInputs[RECORD_LENGTH];
+static uint16_t recordedCount;
+
+
+// *******************************************************
+// LQR design
+// *******************************************************
+
+/** Multiplies two 4x4 matrices, the result may not be either input
+@param a the left matrix
+@param b the right matrix
+@param result where to write a b */
+static void
+multiply4(const double a[4][4], const double b[4][4], double result[4][4])
+{
+    uint8_t i;
+    uint8_t j;
+    uint8_t k;
+
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            result[i][j] = 0.0;
+            for (k = 0; k < 4; k++) {
+                result[i][j] += a[i][k] * b[k][j];
+            }
+        }
+    }
+}
+
+/** Works out the LQR gain matrix for the rig model at the loop rate, by iterating the discrete Riccati equation
+@param gains where to write K, in duty permille per unit of state error */
+static void
+designLQR(double gains[SS_NUM_INPUTS][SS_NUM_STATES])
+{
+    // x = [altitude, climb rate, yaw, yaw rate], u = [main duty, tail duty] about the trims, Euler discretised
+    double a[4][4] = {
+        {1.0, LOOP_DT_S, 0.0, 0.0},
+        {0.0, 1.0 - RIG_CLIMB_DRAG * LOOP_DT_S, 0.0, 0.0},
+        {0.0, 0.0, 1.0, LOOP_DT_S},
+        {0.0, 0.0, 0.0, 1.0 - RIG_YAW_DRAG * LOOP_DT_S},
+    };
+    double b[4][2] = {
+        {0.0, 0.0},
+        {RIG_THRUST_GAIN * LOOP_DT_S, 0.0},
+        {0.0, 0.0},
+        {-RIG_TAIL_GAIN * RIG_TAIL_COUPLING * LOOP_DT_S, RIG_TAIL_GAIN * LOOP_DT_S},
+    };
+    double q[4] = {
+        1.0 / (LQR_ALTITUDE_ERROR * LQR_ALTITUDE_ERROR), 1.0 / (LQR_CLIMB_RATE_ERROR * LQR_CLIMB_RATE_ERROR),
+        1.0 / (LQR_YAW_ERROR * LQR_YAW_ERROR), 1.0 / (LQR_YAW_RATE_ERROR * LQR_YAW_RATE_ERROR),
+    };
+    double r = 1.0 / (LQR_DUTY_CHANGE * LQR_DUTY_CHANGE);
+    double p[4][4] = {{0.0}};
+    double next[4][4];
+    double pa[4][4];
+    double bp[2][4]; // B' P
+    double bpb[2][2]; // R + B' P B
+    double bpa[2][4]; // B' P A
+    double inverse[2][2];
+    double k[2][4];
+    double determinant;
+    double change;
+    double size;
+    uint32_t iteration;
+    uint8_t i;
+    uint8_t j;
+    uint8_t m;
+
+    for (i = 0; i < 4; i++) {
+        p[i][i] = q[i];
+    }
+
+    for (iteration = 0; iteration < LQR_ITERATIONS; iteration++) {
+        // K = (R + B' P B)^-1 B' P A
+        for (i = 0; i < 2; i++) {
+            for (j = 0; j < 4; j++) {
+                bp[i][j] = 0.0;
+                for (m = 0; m < 4; m++) {
+                    bp[i][j] += b[m][i] * p[m][j];
+                }
+            }
+        }
+        for (i = 0; i < 2; i++) {
+            for (j = 0; j < 2; j++) {
+                bpb[i][j] = (i == j) ? r : 0.0;
+                for (m = 0; m < 4; m++) {
+                    bpb[i][j] += bp[i][m] * b[m][j];
+                }
+            }
+            for (j = 0; j < 4; j++) {
+                bpa[i][j] = 0.0;
+                for (m = 0; m < 4; m++) {
+                    bpa[i][j] += bp[i][m] * a[m][j];
+                }
+            }
+        }
+        determinant = bpb[0][0] * bpb[1][1] - bpb[0][1] * bpb[1][0];
+        inverse[0][0] = bpb[1][1] / determinant;
+        inverse[0][1] = -bpb[0][1] / determinant;
+        inverse[1][0] = -bpb[1][0] / determinant;
+        inverse[1][1] = bpb[0][0] / determinant;
+        for (i = 0; i < 2; i++) {
+            for (j = 0; j < 4; j++) {
+                k[i][j] = inverse[i][0] * bpa[0][j] + inverse[i][1] * bpa[1][j];
+            }
+        }
+
+        // P = Q + A' P (A - B K)
+        double closed[4][4];
+        double transpose[4][4];
+        for (i = 0; i < 4; i++) {
+            for (j = 0; j < 4; j++) {
+                closed[i][j] = a[i][j] - b[i][0] * k[0][j] - b[i][1] * k[1][j];
+                transpose[i][j] = a[j][i];
+            }
+        }
+        multiply4(p, closed, pa);
+        multiply4(transpose, pa, next);
+        change = 0.0;
+        size = 0.0;
+        for (i = 0; i < 4; i++) {
+            next[i][i] += q[i];
+            for (j = 0; j < 4; j++) {
+                change += fabs(next[i][j] - p[i][j]);
+                size += fabs(next[i][j]);
+                p[i][j] = next[i][j];
+            }
+        }
+        if (change <= size * LQR_TOLERANCE) {
+            break;
+        }
+    }
+
+    for (i = 0; i < SS_NUM_INPUTS; i++) {
+        for (j = 0; j < SS_NUM_STATES; j++) {
+            gains[i][j] = k[i][j];
+        }
+    }
+}
+
+/** Loads the LQR gains into the Q15 matrix the state-space law runs on, the climb rate state is in permille per
+second on the board. Prints them in the form main.c takes them
+@param gains K, in duty permille per unit of state error */
+static void
+loadStateSpaceGains(const double gains[SS_NUM_INPUTS][SS_NUM_STATES])
+{
+    static const char* const inputNames[SS_NUM_INPUTS] = {"MAIN", "TAIL"};
+    static const char* const stateNames[SS_NUM_STATES] = {"ALT", "CLIMB_RATE", "YAW", "YAW_RATE"};
+    static const char* const stateUnits[SS_NUM_STATES] = {
+        "percent", "percent per second, the matrix entry is scaled to the permille per second state", "degree",
+        "degree per second",
+    };
+    int32_t hundredths;
+    uint8_t i;
+    uint8_t j;
+
+    printf("LQR gains for main.c, response per unit of state error in hundredths:\n");
+    for (i = 0; i < SS_NUM_INPUTS; i++) {
+        for (j = 0; j < SS_NUM_STATES; j++) {
+            hundredths = (int32_t)lround(gains[i][j] * 100.0);
+            printf("#define SS_%s_%s_GAIN %d // per %s\n", inputNames[i], stateNames[j], (int)hundredths,
+                   stateUnits[j]);
+            stateSpaceGains[i][j] = (int16_t)(hundredths * 32768 / 100 / (1 << SS_GAIN_SHIFT)
+                    / ((j == SS_CLIMB_RATE) ? CONTROL_ALT_RATE_SCALE : 1));
+        }
+    }
+    printf("\n");
+}
+
+// *******************************************************
+// Closed loop runs
+// *******************************************************
+
+/** Sets an axis' controller up with a law
+@param controller the controller
+@param axis the axis, CONTROL_AXIS_ALT or CONTROL_AXIS_YAW
+@param law the law from CONTROL_STRATEGY_*
+@param config the axis' settings */
+static void
+lawInit(simController_t* controller, uint8_t axis, uint8_t law, const controlConfig_t* config)
+{
+    controller->law = law;
+    switch (law) {
+        case CONTROL_STRATEGY_INT_PID:
+            intPIDStrategyInit(&controller->intPID, axis, config);
+            break;
+        case CONTROL_STRATEGY_FLOAT_PID:
+            floatPIDStrategyInit(&controller->floatPID, axis, config);
+            break;
+        case CONTROL_STRATEGY_CASCADE:
+            cascadeStrategyInit(&controller->cascade, axis, config);
+            break;
+        case CONTROL_STRATEGY_STATE_SPACE:
+            stateSpaceStrategyInit(&controller->stateSpace, axis, config);
+            break;
+    }
+}
+
+/** Returns the response of an axis' law, the same call the control loop makes
+@param controller the controller
+@param axis the axis
+@param input the control inputs
+@return the response */
+static int32_t
+lawResponse(simController_t* controller, uint8_t axis, const controlState_t* input)
+{
+    switch (controller->law) {
+        case CONTROL_STRATEGY_INT_PID:
+            return intPIDStrategyResponse(&controller->intPID, axis, input, LOOP_DT_US);
+        case CONTROL_STRATEGY_FLOAT_PID:
+            return floatPIDStrategyResponse(&controller->floatPID, axis, input, LOOP_DT_US);
+        case CONTROL_STRATEGY_CASCADE:
+            return cascadeStrategyResponse(&controller->cascade, axis, input, LOOP_DT_US);
+        case CONTROL_STRATEGY_STATE_SPACE:
+            return stateSpaceStrategyResponse(&controller->stateSpace, axis, input, LOOP_DT_US);
+    }
+    return 0;
+}
+
+/** Passes the applied duty back to an axis' law for its anti-windup
+@param controller the controller
+@param applied the duty after the clamp and slew limit */
+static void
+lawFeedback(simController_t* controller, int32_t applied)
+{
+    switch (controller->law) {
+        case CONTROL_STRATEGY_INT_PID:
+            intPIDStrategyFeedback(&controller->intPID, applied);
+            break;
+        case CONTROL_STRATEGY_FLOAT_PID:
+            floatPIDStrategyFeedback(&controller->floatPID, applied);
+            break;
+        case CONTROL_STRATEGY_CASCADE:
+            cascadeStrategyFeedback(&controller->cascade, applied);
+            break;
+        case CONTROL_STRATEGY_STATE_SPACE:
+            stateSpaceStrategyFeedback(&controller->stateSpace, applied);
+            break;
+    }
+}
+
+/** Clamps a duty and slews the rotor towards it, what clampDutyPermille() and pwmActuatorUpdate() do
+@param duty the rotor's duty, moved towards the command
+@param command the commanded duty in permille
+@param slewRate the fastest the duty can move in permille per second */
+static void
+actuate(double* duty, int32_t command, double slewRate)
+{
+    double step = slewRate * LOOP_DT_S;
+
+    if (command > PWM_DUTY_MAX * (PWM_PERMILLE / 100)) {
+        command = PWM_DUTY_MAX * (PWM_PERMILLE / 100);
+    } else if (command < PWM_DUTY_MIN * (PWM_PERMILLE / 100)) {
+        command = PWM_DUTY_MIN * (PWM_PERMILLE / 100);
+    }
+
+    if (command > *duty + step) {
+        *duty += step;
+    } else if (command < *duty - step) {
+        *duty -= step;
+    } else {
+        *duty = command;
+    }
+}
+
+/** Steps the rig model through one loop iteration
+@param rig the rig
+@param mainDuty the main rotor duty in permille
+@param tailDuty the tail rotor duty in permille
+@param load the extra duty in permille each rotor needs to hold the rig, zero unloaded */
+static void
+stepRig(rig_t* rig, double mainDuty, double tailDuty, const int32_t* load)
+{
+    double dt = LOOP_DT_S / PLANT_STEPS;
+    double hoverDuty = RIG_HOVER_DUTY + load[SIM_ALT];
+    double tailTrim = RIG_TAIL_TRIM + load[SIM_YAW] + RIG_TAIL_COUPLING * (mainDuty - RIG_HOVER_DUTY);
+    uint8_t i;
+
+    for (i = 0; i < PLANT_STEPS; i++) {
+        rig->climbRate += (RIG_THRUST_GAIN * (mainDuty - hoverDuty) - RIG_CLIMB_DRAG * rig->climbRate) * dt;
+        rig->altitude += rig->climbRate * dt;
+        rig->yawRate += (RIG_TAIL_GAIN * (tailDuty - tailTrim) - RIG_YAW_DRAG * rig->yawRate) * dt;
+        rig->yaw += rig->yawRate * dt;
+
+        // The rig runs into the stops at the ends of its travel
+        if (rig->altitude < 0.0 || rig->altitude > RIG_ALTITUDE_MAX) {
+            rig->altitude = (rig->altitude < 0.0) ? 0.0 : RIG_ALTITUDE_MAX;
+            rig->climbRate = 0.0;
+        }
+    }
+}
+
+/** Runs one law on both axes through a run and measures the stepped axis
+@param run the run
+@param law the law from CONTROL_STRATEGY_*, on both axes
+@param result where to write the measurements */
+static void
+simulate(const simRun_t* run, uint8_t law, simResult_t* result)
+{
+    simController_t controllers[SIM_AXES];
+    rateEstimator_t rateEstimators[SIM_AXES];
+    trajectory_t trajectories[SIM_AXES];
+    controlState_t input;
+    rig_t rig = {run->start[SIM_ALT], 0.0, run->start[SIM_YAW], 0.0};
+    double mainDuty = RIG_HOVER_DUTY;
+    double tailDuty = RIG_TAIL_TRIM;
+    uint32_t ticks = (uint32_t)(run->seconds * LOOP_RATE_HZ);
+    uint32_t finalTicks = FINAL_SECONDS * LOOP_RATE_HZ;
+    uint32_t loadTick = (uint32_t)(run->loadTime * LOOP_RATE_HZ);
+    uint32_t releaseTick = (run->releaseTime > 0.0) ? (uint32_t)(run->releaseTime * LOOP_RATE_HZ) : ticks;
+    uint32_t tick;
+    uint8_t axis = run->axis;
+    uint8_t other = (axis == SIM_ALT) ? SIM_YAW : SIM_ALT;
+    double step = run->goal[axis] - run->start[axis];
+    double band = fabs(step) * SETTLE_FRACTION;
+    double position;
+    double progress;
+    double error;
+    double riseStart = -1.0;
+    double settleStart = 0.0;
+    int32_t measured[SIM_AXES];
+    int32_t reference[SIM_AXES];
+    int32_t unloaded[SIM_AXES] = {0, 0};
+    int32_t response;
+
+    if (band < SETTLE_MIN_BAND) {
+        band = SETTLE_MIN_BAND;
+    }
+
+    lawInit(&controllers[SIM_ALT], CONTROL_AXIS_ALT, law, &altConfig);
+    lawInit(&controllers[SIM_YAW], CONTROL_AXIS_YAW, law, &yawConfig);
+    rateEstimatorInit(&rateEstimators[SIM_ALT], ALT_RATE_ALPHA, ALT_RATE_BETA);
+    rateEstimatorInit(&rateEstimators[SIM_YAW], YAW_RATE_ALPHA, YAW_RATE_BETA);
+    trajectoryInit(&trajectories[SIM_ALT], ALT_TRAJECTORY_MAX_RATE, ALT_TRAJECTORY_MAX_ACCEL, 0, run->start[SIM_ALT]);
+    trajectoryInit(&trajectories[SIM_YAW], YAW_TRAJECTORY_MAX_RATE, YAW_TRAJECTORY_MAX_ACCEL, 0, run->start[SIM_YAW]);
+
+    // The integrators start holding the hover, as if the rig had been flying at the start
+    controllers[SIM_ALT].intPID.integralSum = SS_MAIN_TRIM * PID_INTEGRAL_FRACTION;
+    controllers[SIM_YAW].intPID.integralSum = SS_TAIL_TRIM * PID_INTEGRAL_FRACTION;
+    controllers[SIM_ALT].floatPID.integralSum = SS_MAIN_TRIM;
+    controllers[SIM_YAW].floatPID.integralSum = SS_TAIL_TRIM;
+    controllers[SIM_ALT].cascade.inner.integralSum = SS_MAIN_TRIM * PID_INTEGRAL_FRACTION;
+    controllers[SIM_YAW].cascade.inner.integralSum = SS_TAIL_TRIM * PID_INTEGRAL_FRACTION;
+
+    result->riseTime = -1.0;
+    result->overshoot = 0.0;
+    result->settleTime = -1.0;
+    result->steadyError = 0.0;
+    result->crossError = 0.0;
+    result->peakError = 0.0;
+    result->recoveryTime = -1.0;
+    recordedCount = 0;
+
+    for (tick = 0; tick < ticks; tick++) {
+        // The ADC and decoder give whole percent, permille for the climb rate and whole degrees
+        measured[SIM_ALT] = (int32_t)floor(rig.altitude);
+        measured[SIM_YAW] = (int32_t)lround(rig.yaw);
+        rateEstimatorUpdate(&rateEstimators[SIM_ALT], (int32_t)floor(rig.altitude * 10.0), LOOP_DT_US);
+        rateEstimatorUpdate(&rateEstimators[SIM_YAW], measured[SIM_YAW], LOOP_DT_US);
+        reference[SIM_ALT] = trajectoryUpdate(&trajectories[SIM_ALT], run->goal[SIM_ALT], LOOP_DT_US);
+        reference[SIM_YAW] = trajectoryUpdate(&trajectories[SIM_YAW], run->goal[SIM_YAW], LOOP_DT_US);
+
+        input.reference[SS_ALTITUDE] = reference[SIM_ALT];
+        input.reference[SS_CLIMB_RATE] = trajectories[SIM_ALT].velocity / (TRAJECTORY_SCALE / CONTROL_ALT_RATE_SCALE);
+        input.reference[SS_YAW] = reference[SIM_YAW];
+        input.reference[SS_YAW_RATE] = trajectories[SIM_YAW].velocity / TRAJECTORY_SCALE;
+        input.state[SS_ALTITUDE] = measured[SIM_ALT];
+        input.state[SS_CLIMB_RATE] = getEstimatedRate(&rateEstimators[SIM_ALT]);
+        input.state[SS_YAW] = measured[SIM_YAW];
+        input.state[SS_YAW_RATE] = getEstimatedRate(&rateEstimators[SIM_YAW]);
+        if (recordedCount < RECORD_LENGTH) {
+            recordedInputs[recordedCount++] = input;
+        }
+
+        response = lawResponse(&controllers[SIM_ALT], CONTROL_AXIS_ALT, &input);
+        actuate(&mainDuty, response, MAIN_ROTOR_SLEW_RATE);
+        lawFeedback(&controllers[SIM_ALT], (int32_t)lround(mainDuty));
+        response = lawResponse(&controllers[SIM_YAW], CONTROL_AXIS_YAW, &input);
+        actuate(&tailDuty, response, TAIL_ROTOR_SLEW_RATE);
+        lawFeedback(&controllers[SIM_YAW], (int32_t)lround(tailDuty));
+
+        stepRig(&rig, mainDuty, tailDuty, (tick >= loadTick && tick < releaseTick) ? run->load : unloaded);
+
+        // Measure the stepped axis against the goal, the profile is part of the response
+        position = (axis == SIM_ALT) ? rig.altitude : rig.yaw;
+        error = run->goal[axis] - position;
+        if (step != 0.0) {
+            progress = (position - run->start[axis]) / step;
+            if (riseStart < 0.0 && progress >= 0.1) {
+                riseStart = tick * LOOP_DT_S;
+            }
+            if (result->riseTime < 0.0 && progress >= 0.9) {
+                result->riseTime = tick * LOOP_DT_S - riseStart;
+            }
+            if ((progress - 1.0) * 100.0 > result->overshoot) {
+                result->overshoot = (progress - 1.0) * 100.0;
+            }
+        }
+        if (tick >= loadTick && fabs(error) > fabs(result->peakError)) {
+            result->peakError = error;
+        }
+        if (fabs(error) > band) {
+            settleStart = (tick + 1) * LOOP_DT_S;
+        }
+        if (tick >= ticks - finalTicks) {
+            result->steadyError += error / finalTicks;
+        }
+
+        // The error the step couples into the axis held still
+        error = fabs(run->goal[other] - ((other == SIM_ALT) ? rig.altitude : rig.yaw));
+        if (error > result->crossError) {
+            result->crossError = error;
+        }
+    }
+
+    if (settleStart < run->seconds - FINAL_SECONDS) {
+        result->settleTime = settleStart;
+        result->recoveryTime = (settleStart > run->loadTime) ? settleStart - run->loadTime : 0.0;
+    }
+}
+
+/** Prints a time, or a dash if it never happened
+@param seconds the time, negative if it never happened */
+static void
+printTime(double seconds)
+{
+    if (seconds < 0.0) {
+        printf(" %8s", "-");
+    } else {
+        printf(" %7.2fs", seconds);
+    }
+}
+
+/** Runs each law through a step and prints the measurements side by side
+@param run the run
+@param laws the laws to compare, from CONTROL_STRATEGY_*
+@param lawCount the amount of laws */
+static void
+compareStep(const simRun_t* run, const uint8_t* laws, uint8_t lawCount)
+{
+    simResult_t result;
+    const char* unit = (run->axis == SIM_ALT) ? "%" : "deg";
+    const char* otherUnit = (run->axis == SIM_ALT) ? "deg" : "%";
+    uint8_t i;
+
+    printf("%s\n", run->name);
+    printf("  %-12s %9s %9s %9s %9s %11s\n", "law", "rise", "overshoot", "settle", "steady", "other axis");
+    for (i = 0; i < lawCount; i++) {
+        simulate(run, laws[i], &result);
+        printf("  %-12s", lawNames[laws[i]]);
+        printTime(result.riseTime);
+        printf(" %8.1f%%", result.overshoot);
+        printTime(result.settleTime);
+        printf(" %6.2f%-3s %7.2f%-3s\n", result.steadyError, unit, result.crossError, otherUnit);
+    }
+    printf("\n");
+}
+
+/** Runs each law through a load added while holding a hover and prints how well each rejects it
+@param run the run, with its start and goal the same
+@param laws the laws to compare, from CONTROL_STRATEGY_*
+@param lawCount the amount of laws */
+static void
+compareLoad(const simRun_t* run, const uint8_t* laws, uint8_t lawCount)
+{
+    simResult_t result;
+    const char* unit = (run->axis == SIM_ALT) ? "%" : "deg";
+    const char* otherUnit = (run->axis == SIM_ALT) ? "deg" : "%";
+    uint8_t i;
+
+    printf("%s\n", run->name);
+    printf("  %-12s %9s %9s %9s %11s\n", "law", "peak", "recovery", "steady", "other axis");
+    for (i = 0; i < lawCount; i++) {
+        simulate(run, laws[i], &result);
+        printf("  %-12s %6.2f%-3s", lawNames[laws[i]], result.peakError, unit);
+        printTime(result.recoveryTime);
+        printf(" %6.2f%-3s %7.2f%-3s\n", result.steadyError, unit, result.crossError, otherUnit);
+    }
+    printf("\n");
+}
+
+/** Runs the single loop PID with each anti-windup mode through a run that holds the rig in saturation, and prints
+how long each takes to recover once the rig is let go
+@param run the run, with a load the rotor can't hold taken off at its release time */
+static void
+compareAntiWindup(const simRun_t* run)
+{
+    static const char* const modeNames[] = {"clamp only", "back calc", "conditional"}; // by PID_ANTIWINDUP_*
+    static const uint8_t modes[] = {PID_ANTIWINDUP_CLAMP, PID_ANTIWINDUP_BACK_CALCULATION, PID_ANTIWINDUP_CONDITIONAL};
+    controlConfig_t* config = (run->axis == SIM_ALT) ? &altConfig : &yawConfig;
+    uint8_t savedMode = config->antiWindupMode;
+    simResult_t result;
+    uint8_t i;
+
+    printf("%s\n", run->name);
+    printf("  %-12s %9s %9s %9s\n", "anti-windup", "overshoot", "recovery", "steady");
+    for (i = 0; i < sizeof(modes); i++) {
+        config->antiWindupMode = modes[i];
+        simulate(run, CONTROL_STRATEGY_INT_PID, &result);
+        printf("  %-12s %8.1f%%", modeNames[modes[i]], result.overshoot);
+        printTime((result.settleTime < 0.0) ? -1.0
+                  : (result.settleTime > run->releaseTime) ? result.settleTime - run->releaseTime : 0.0);
+        printf(" %6.2f%-3s\n", result.steadyError, (run->axis == SIM_ALT) ? "%" : "deg");
+    }
+    config->antiWindupMode = savedMode;
+    printf("\n");
+}
+
+// *******************************************************
+// Timing
+// *******************************************************
+
+/** Returns a monotonic time in nanoseconds
+@return the time */
+static double
+nowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/** Times each law over the inputs recorded in the last run, both axes per update like controlBenchmark.c
+@param laws the laws to time, from CONTROL_STRATEGY_*
+@param lawCount the amount of laws */
+static void
+timeLaws(const uint8_t* laws, uint8_t lawCount)
+{
+    simController_t controllers[SIM_AXES];
+    volatile int32_t sink = 0; // keeps the responses from being optimised away
+    double updates = (double)TIMING_PASSES * recordedCount;
+    double start;
+    double elapsed;
+    uint32_t pass;
+    uint16_t i;
+    uint8_t law;
+#ifdef HOST_CYCLES
+    uint64_t startCycles;
+    uint64_t cycles;
+#endif
+
+    printf("Host time per update, both axes, over %u recorded iterations\n", recordedCount);
+    for (law = 0; law < lawCount; law++) {
+        start = nowNs();
+#ifdef HOST_CYCLES
+        startCycles = HOST_CYCLES();
+#endif
+        for (pass = 0; pass < TIMING_PASSES; pass++) {
+            lawInit(&controllers[SIM_ALT], CONTROL_AXIS_ALT, laws[law], &altConfig);
+            lawInit(&controllers[SIM_YAW], CONTROL_AXIS_YAW, laws[law], &yawConfig);
+            for (i = 0; i < recordedCount; i++) {
+                sink += lawResponse(&controllers[SIM_ALT], CONTROL_AXIS_ALT, &recordedInputs[i]);
+                sink += lawResponse(&controllers[SIM_YAW], CONTROL_AXIS_YAW, &recordedInputs[i]);
+            }
+        }
+#ifdef HOST_CYCLES
+        cycles = HOST_CYCLES() - startCycles;
+#endif
+        elapsed = nowNs() - start;
+        printf("  %-12s %7.1f ns", lawNames[laws[law]], elapsed / updates);
+#ifdef HOST_CYCLES
+        printf(" %7.1f cycles", cycles / updates);
+#endif
+        printf("\n");
+    }
+    printf("\n");
+}
+
+int
+main(void)
+{
+    static const simRun_t altitudeStep = {"Altitude step 20% to 60%", SIM_ALT, {20, 0}, {60, 0}, 8.0,
+                                          0.0, {0, 0}, 0.0};
+    static const simRun_t yawStep = {"Yaw step 0 to 90 degrees", SIM_YAW, {50, 0}, {50, 90}, 6.0,
+                                     0.0, {0, 0}, 0.0};
+    static const simRun_t altitudeLoad = {"Altitude load of 60 permille main duty at 1s, hovering at 50%", SIM_ALT,
+                                          {50, 0}, {50, 0}, 8.0, 1.0, {60, 0}, 0.0};
+    static const simRun_t yawLoad = {"Yaw load of 60 permille tail duty at 1s, hovering at 50%", SIM_YAW,
+                                     {50, 0}, {50, 0}, 6.0, 1.0, {0, 60}, 0.0};
+    static const simRun_t saturatedClimb = {"Climb to 60% held on the ground for 3s by a 500 permille load",
+                                            SIM_ALT, {0, 0}, {60, 0}, 20.0, 0.0, {500, 0}, 3.0};
+    static const uint8_t stateSpaceLaws[] = {CONTROL_STRATEGY_INT_PID, CONTROL_STRATEGY_STATE_SPACE};
+    static const uint8_t cascadeLaws[] = {CONTROL_STRATEGY_INT_PID, CONTROL_STRATEGY_CASCADE};
+    static const uint8_t allLaws[] = {CONTROL_STRATEGY_INT_PID, CONTROL_STRATEGY_FLOAT_PID, CONTROL_STRATEGY_CASCADE,
+                                      CONTROL_STRATEGY_STATE_SPACE};
+    double gains[SS_NUM_INPUTS][SS_NUM_STATES];
+
+    designLQR(gains);
+    loadStateSpaceGains(gains);
+
+    compareStep(&altitudeStep, stateSpaceLaws, sizeof(stateSpaceLaws));
+    compareStep(&yawStep, stateSpaceLaws, sizeof(stateSpaceLaws));
+
+    compareAntiWindup(&saturatedClimb);
+
+    printf("Cascade against the single loop PID\n\n");
+    compareStep(&altitudeStep, cascadeLaws, sizeof(cascadeLaws));
+    compareLoad(&altitudeLoad, cascadeLaws, sizeof(cascadeLaws));
+    compareStep(&yawStep, cascadeLaws, sizeof(cascadeLaws));
+    compareLoad(&yawLoad, cascadeLaws, sizeof(cascadeLaws));
+
+    timeLaws(allLaws, sizeof(allLaws));
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+// *******************************************************
+//
+//  ditherTest.c
+//
+//  Host side check of the pwm duty dither in IO/pwmDither.c. Runs the dither for a number of pwm periods at each duty
+//  of a sweep, at the loads of the slowest, default and fastest carriers, and checks the average duty over the periods
+//  is within DITHER_TOLERANCE of the Q16 duty it was given. Exits non-zero if any duty is off.
+//
+//  Build and run on the host, not the board:
+//      cc -o ditherTest tools/ditherTest.c IO/pwmDither.c
+//      ./ditherTest [periods]
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../IO/pwmDither.h"
+
+#define PWM_CLOCK_HZ 5000000 // the 20 MHz system clock through the pwm divider of 4
+#define DITHER_PERIODS 10000 // the periods averaged at each duty unless given on the command line
+#define DITHER_SWEEP_STEP 257 // the Q16 step between duties in the sweep, odd so the fractions of a count vary
+#define DITHER_TOLERANCE 0.0001 // 0.01% of the duty
+
+static const uint32_t carriers[] = {PWM_RATE_MIN_HZ, 250, PWM_RATE_MAX_HZ}; // the carrier frequencies checked
+
+
+/** Runs the dither at one duty and returns the average duty it gave
+@param load the generator load
+@param dutyQ16 the duty in Q16
+@param periods the periods to run
+@return the average duty as a fraction of the period */
+static double
+averageDuty(uint32_t load, uint32_t dutyQ16, uint32_t periods)
+{
+    uint32_t residual = 0;
+    uint64_t counts = 0;
+    uint32_t period;
+
+    // The pulse is 2 * (load - compare) counts of the 2 * load count period
+    for (period = 0; period < periods; period++) {
+        counts += load - pwmDitherCompare(load, dutyQ16, &residual);
+    }
+    return (double)counts / ((double)load * periods);
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t periods = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : DITHER_PERIODS;
+    uint32_t failures = 0;
+    uint32_t checked = 0;
+    double worst = 0.0;
+    double target;
+    double error;
+    uint32_t load;
+    uint32_t dutyQ16;
+    uint8_t i;
+
+    if (periods == 0) {
+        fprintf(stderr, "usage: %s [periods]\n", argv[0]);
+        return 2;
+    }
+
+    for (i = 0; i < sizeof(carriers) / sizeof(carriers[0]); i++) {
+        load = PWM_CLOCK_HZ / carriers[i] / 2;
+
+        for (dutyQ16 = 0; dutyQ16 <= PWM_DUTY_Q16_ONE; dutyQ16 += DITHER_SWEEP_STEP) {
+            target = (double)dutyQ16 / PWM_DUTY_Q16_ONE;
+            error = averageDuty(load, dutyQ16, periods) - target;
+            if (error < 0.0) {
+                error = -error;
+            }
+            if (target > 0.0 && error / target > worst) {
+                worst = error / target;
+            }
+            if (error > target * DITHER_TOLERANCE) {
+                printf("FAIL %u Hz load %u duty %u/65536 off by %.6f%%\n", (unsigned)carriers[i], (unsigned)load,
+                       (unsigned)dutyQ16, 100.0 * error / target);
+                failures++;
+            }
+            checked++;
+        }
+    }
+
+    printf("%u of %u duties over %u periods off by more than %.2f%%, worst %.6f%%\n", (unsigned)failures,
+           (unsigned)checked, (unsigned)periods, 100.0 * DITHER_TOLERANCE, 100.0 * worst);
+    return (failures == 0) ? 0 : 1;
+}
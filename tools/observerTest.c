@@ -0,0 +1,122 @@
+// *******************************************************
+//
+//  observerTest.c
+//
+//  Host side check of the disturbance observer in controllers/disturbanceObserver.c. Runs the observer at the control
+//  loop rate against a simulated axis that matches its model, steps a load onto the axis and checks the compensation
+//  cancels it. Runs with a positive and a negative model gain, the tail rotor can push either way, and with a load
+//  past the limit so the compensation has to saturate on the right side. Exits non-zero if any run fails.
+//
+//  Build and run on the host, not the board:
+//      cc -o observerTest tools/observerTest.c controllers/disturbanceObserver.c
+//      ./observerTest
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../controllers/disturbanceObserver.h"
+
+#define LOOP_RATE_HZ 500 // the control loop rate the observer runs at on the board
+#define LOOP_DT_US (1000000 / LOOP_RATE_HZ)
+#define OBSERVER_TRIM 400 // the response that holds the simulated axis still
+#define OBSERVER_BANDWIDTH 40 // radians per second, the default in main.c
+#define OBSERVER_LIMIT 300 // the most response the observer can add or take off
+#define STEP_TICK 50 // the load is stepped on this far into the run
+#define RUN_TICKS 500 // 1 s at the loop rate
+#define SETTLE_TICKS (LOOP_RATE_HZ / 10) // the load should be cancelled within 0.1 s
+#define SETTLE_FRACTION 0.1 // to within this fraction of the load
+#define FINAL_FRACTION 0.02 // and to within this fraction by the end of the run
+
+typedef struct {
+    const char* name; // what the run checks
+    int32_t modelGain; // the observer model gain, the simulated axis matches it
+    double load; // the stepped load in units per second squared
+} observerRun_t; // one simulated load step
+
+
+/** Runs the observer against the simulated axis through a load step
+@param run the run
+@return true if the compensation did what it should */
+static bool
+runObserver(const observerRun_t* run)
+{
+    disturbanceObserver_t observer;
+    double rate = 0.0; // the simulated axis rate in units per second
+    double acceleration = 0.0;
+    double load;
+    int32_t compensation = 0;
+    int32_t expected;
+    int32_t settledTick = -1;
+    uint16_t tick;
+    bool passed = true;
+
+    initDisturbanceObserver(&observer, run->modelGain, OBSERVER_TRIM, OBSERVER_BANDWIDTH, OBSERVER_LIMIT);
+
+    for (tick = 0; tick < RUN_TICKS; tick++) {
+        load = (tick >= STEP_TICK) ? run->load : 0.0;
+
+        // The same order as the control loop, update from the rate then apply the compensation about the trim
+        disturbanceObserverUpdate(&observer, (int32_t)(rate * DOB_SCALE), LOOP_DT_US);
+        compensation = getDisturbanceCompensation(&observer);
+        disturbanceObserverApplied(&observer, OBSERVER_TRIM + compensation);
+
+        acceleration = (double)run->modelGain * compensation / DOB_MODEL_SCALE + load;
+        rate += acceleration * LOOP_DT_US / 1000000.0;
+
+        if (tick >= STEP_TICK && settledTick < 0 && abs((int)acceleration) <= abs((int)(run->load * SETTLE_FRACTION))) {
+            settledTick = tick - STEP_TICK;
+        }
+    }
+
+    // The compensation that cancels the load, as far as the limit allows
+    expected = (int32_t)(-run->load * DOB_MODEL_SCALE / run->modelGain);
+    if (expected > OBSERVER_LIMIT) {
+        expected = OBSERVER_LIMIT;
+    } else if (expected < -OBSERVER_LIMIT) {
+        expected = -OBSERVER_LIMIT;
+    }
+
+    printf("%-26s compensation %5d (expected %5d)", run->name, (int)compensation, (int)expected);
+    if (abs(compensation - expected) > abs(expected) * FINAL_FRACTION + 1) {
+        passed = false;
+    }
+
+    // A load past the limit can't be cancelled, only pushed against as hard as the limit allows
+    if (abs(expected) < OBSERVER_LIMIT) {
+        printf(", settled in %d ms", (settledTick < 0) ? -1 : (int)(settledTick * 1000 / LOOP_RATE_HZ));
+        if (settledTick < 0 || settledTick > SETTLE_TICKS) {
+            passed = false;
+        }
+    }
+    printf(" %s\n", passed ? "ok" : "FAIL");
+    return passed;
+}
+
+int
+main(void)
+{
+    static const observerRun_t runs[] = {
+        {"positive model gain", 100, -50.0},
+        {"negative model gain", -100, -50.0},
+        {"positive gain, saturated", 100, 500.0},
+        {"negative gain, saturated", -100, 500.0},
+    };
+    uint8_t i;
+    uint8_t failures = 0;
+
+    for (i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+        if (!runObserver(&runs[i])) {
+            failures++;
+        }
+    }
+
+    printf("%u of %u runs failed\n", failures, (unsigned)(sizeof(runs) / sizeof(runs[0])));
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// *******************************************************
+//
+//  relayAutoTuneTest.c
+//
+//  Host side check of the relay feedback experiment in controllers/relayAutoTune.c. Runs the relay at the control loop
+//  rate against simulated third order lags, K / (tau s + 1)^3, whose ultimate gain 8 / K and ultimate period
+//  2 pi tau / sqrt(3) are known exactly, with the error rounded to whole units the way the ADC and yaw decoder give
+//  it. Checks the identified values land within tolerance of them, and that an axis that never responds fails the
+//  experiment instead of giving gains. Exits non-zero if any run fails.
+//
+//  The hysteresis, and the half unit the rounding adds to it, moves the oscillation asin(hysteresis / amplitude) off
+//  the phase crossover, to a slightly lower frequency where the lag has more gain. That reads the ultimate gain low and
+//  the period long, by about 8% and 4% at the altitude settings, so the tolerances leave room for it.
+//
+//  Build and run on the host, not the board:
+//      cc -o relayAutoTuneTest tools/relayAutoTuneTest.c controllers/relayAutoTune.c -lm
+//      ./relayAutoTuneTest
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "../controllers/relayAutoTune.h"
+
+#define LOOP_RATE_HZ 500 // the control loop rate the experiment runs at on the board
+#define LOOP_DT_US (1000000 / LOOP_RATE_HZ)
+#define PLANT_STEPS 10 // the simulated axis is stepped this many times per loop iteration
+#define RELAY_BIAS 400 // the hover response the relay switches around
+#define RUN_TICKS (70 * LOOP_RATE_HZ) // past the experiment's own one minute timeout
+#define GAIN_TOLERANCE 0.15 // the identified gain within this fraction of the ultimate gain
+#define PERIOD_TOLERANCE 0.08 // and the period within this fraction of the ultimate period
+
+typedef struct {
+    const char* name; // what the run checks
+    double plantGain; // K, units of measurement per unit of response
+    double timeConstant; // tau in seconds
+    int32_t amplitude; // the relay amplitude
+    int32_t hysteresis; // the relay hysteresis
+    bool converges; // false if the experiment should fail
+} autoTuneRun_t; // one simulated experiment
+
+
+/** Runs the relay against a simulated third order lag
+@param run the run
+@return true if the experiment did what it should */
+static bool
+runAutoTune(const autoTuneRun_t* run)
+{
+    relayAutoTune_t tuner;
+    double stages[3] = {0.0, 0.0, 0.0}; // the outputs of the three lags, the last is the measurement
+    double dt = 1.0 / (LOOP_RATE_HZ * PLANT_STEPS);
+    double input;
+    double expectedGain;
+    double expectedPeriodUs;
+    double gainMiss;
+    double periodMiss;
+    int32_t response;
+    uint32_t tick;
+    uint8_t step;
+    uint8_t i;
+    bool passed = true;
+
+    relayAutoTuneStart(&tuner, RELAY_BIAS, run->amplitude, run->hysteresis);
+
+    for (tick = 0; tick < RUN_TICKS && tuner.state == AUTOTUNE_RUNNING; tick++) {
+        // Holding the target, so the error is the measurement's departure from it
+        response = relayAutoTuneUpdate(&tuner, -(int32_t)lround(stages[2]), LOOP_DT_US);
+
+        input = run->plantGain * (response - RELAY_BIAS);
+        for (step = 0; step < PLANT_STEPS; step++) {
+            for (i = 0; i < 3; i++) {
+                stages[i] += (((i == 0) ? input : stages[i - 1]) - stages[i]) * dt / run->timeConstant;
+            }
+        }
+    }
+
+    printf("%-26s", run->name);
+    if (!run->converges) {
+        passed = (tuner.state == AUTOTUNE_FAILED);
+        printf(" %s after %u ms %s\n", (tuner.state == AUTOTUNE_FAILED) ? "failed" : "did not fail",
+               (unsigned)(tick * 1000 / LOOP_RATE_HZ), passed ? "ok" : "FAIL");
+        return passed;
+    }
+    if (tuner.state != AUTOTUNE_DONE) {
+        printf(" never finished FAIL\n");
+        return false;
+    }
+
+    // The ultimate gain is in response per 100 error
+    expectedGain = 8.0 / run->plantGain * 100.0;
+    expectedPeriodUs = 2.0 * M_PI * run->timeConstant / sqrt(3.0) * 1000000.0;
+    gainMiss = (tuner.ultimateGain - expectedGain) / expectedGain;
+    periodMiss = (tuner.ultimatePeriodUs - expectedPeriodUs) / expectedPeriodUs;
+    if (fabs(gainMiss) > GAIN_TOLERANCE || fabs(periodMiss) > PERIOD_TOLERANCE) {
+        passed = false;
+    }
+
+    printf(" gain %4d (expected %4.0f, %+5.1f%%) period %4u ms (expected %4.0f, %+5.1f%%) %s\n",
+           (int)tuner.ultimateGain, expectedGain, gainMiss * 100.0, (unsigned)(tuner.ultimatePeriodUs / 1000),
+           expectedPeriodUs / 1000.0, periodMiss * 100.0, passed ? "ok" : "FAIL");
+    return passed;
+}
+
+int
+main(void)
+{
+    static const autoTuneRun_t runs[] = {
+        {"no hysteresis", 4.0, 0.2, 50, 0, true},
+        {"altitude settings", 4.0, 0.2, 50, 1, true},
+        {"yaw settings", 4.0, 0.1, 50, 2, true},
+        {"slow axis", 4.0, 0.5, 50, 1, true},
+        {"axis that never responds", 0.0, 0.2, 50, 1, false},
+    };
+    uint8_t i;
+    uint8_t failures = 0;
+
+    for (i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+        if (!runAutoTune(&runs[i])) {
+            failures++;
+        }
+    }
+
+    printf("%u of %u runs failed\n", failures, (unsigned)(sizeof(runs) / sizeof(runs[0])));
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// *******************************************************
+//
+//  telemetryDecode.c
+//
+//  Host side decoder for the binary telemetry frames in IO/telemetry.h. Reads a captured Uart stream and writes one
+//  CSV row per good status frame. Log frames are expanded to text with the format strings from IO/logFormats.h,
+//  the same table the board is built with, and written to stderr with their timestamp. A flight recorder dump is
+//  written as CSV to a second file if one is given. Text lines sent between the frames are passed through to stderr.
+//  Frames that fail their CRC are counted and skipped.
+//
+//  The frames are decoded with tools/telemetryDecoder.c. Build and run on the host, not the board:
+//      cc -o telemetryDecode tools/telemetryDecode.c tools/telemetryDecoder.c
+//      ./telemetryDecode capture.bin > flight.csv
+//      ./telemetryDecode capture.bin recorder.csv > flight.csv
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "telemetryDecoder.h"
+
+#define DEFAULT_TIMESTAMP_HZ 20000000 // the rate the log timestamps are decoded at until the board's LOG_CLOCK arrives
+
+static uint32_t timestampHz = DEFAULT_TIMESTAMP_HZ; // the system clock the log timestamps count, from LOG_CLOCK
+
+
+/** Writes a log record to stderr, its timestamp in seconds then the expanded format string
+@param record the record */
+static void
+printLog (const logRecord_t* record)
+{
+    const int32_t* args = record->args;
+    const char* format = telemetryLogFormat(record->format);
+
+    if (record->format == LOG_CLOCK && args[0] > 0) {
+        timestampHz = args[0];
+    }
+    fprintf(stderr, "%10.6f ", (double)record->timestamp / timestampHz);
+    if (format == NULL) {
+        fprintf(stderr, "LOG     | unknown format %u, decoder older than the board? \n", record->format);
+        return;
+    }
+    fprintf(stderr, format, args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7]);
+}
+
+/** Handles the bytes between two delimiters, a CSV row for a good status frame, log records and text to stderr
+@param chunk the bytes
+@param length the amount of bytes
+@param recorder where to write the flight recorder rows, NULL to skip them
+@param badFrames counts the chunks that are neither a good frame nor text */
+static void
+handleChunk (const uint8_t* chunk, uint16_t length, FILE* recorder, uint32_t* badFrames)
+{
+    telemetryStatusFrame_t frame;
+    telemetryRecordFrame_t recordFrame;
+    logRecord_t record;
+    bool isText = true;
+    uint16_t i;
+
+    if (length == 0) {
+        return; // the gap between the trailing and leading delimiters of two frames
+    }
+
+    if (telemetryDecodeStatus(chunk, length, &frame)) {
+        printf("%u,%u,%d,%d,%d,%d,%u,%u,%u,%u\n", frame.sequence, frame.status.state,
+               frame.status.altitude, frame.status.altitudeTarget, frame.status.yaw, frame.status.yawTarget,
+               frame.status.mainDuty, frame.status.tailDuty, frame.status.loopJitter, frame.status.uartDrops);
+        return;
+    }
+    if (telemetryDecodeLog(chunk, length, &record)) {
+        printLog(&record);
+        return;
+    }
+    if (telemetryDecodeRecord(chunk, length, &recordFrame)) {
+        if (recorder != NULL) {
+            fprintf(recorder, "%u,%u,%u,%d,%d,%d,%d,%d,%d,%d,%d,%u,%u\n", recordFrame.index,
+                    recordFrame.record.tick, recordFrame.record.adcMean, recordFrame.record.altError,
+                    recordFrame.record.yawError, recordFrame.record.altProportional, recordFrame.record.altIntegral,
+                    recordFrame.record.altDerivative, recordFrame.record.yawProportional,
+                    recordFrame.record.yawIntegral, recordFrame.record.yawDerivative, recordFrame.record.mainDuty,
+                    recordFrame.record.tailDuty);
+        }
+        return;
+    }
+
+    for (i = 0; i < length; i++) {
+        if ((chunk[i] < 0x20 || chunk[i] > 0x7E) && chunk[i] != '\r' && chunk[i] != '\n') {
+            isText = false;
+        }
+    }
+    if (isText) {
+        fwrite(chunk, 1, length, stderr);
+    } else {
+        (*badFrames)++;
+    }
+}
+
+int
+main (int argc, char** argv)
+{
+    FILE* input = stdin;
+    FILE* recorder = NULL;
+    uint8_t chunk[TELEMETRY_CHUNK_MAX_LENGTH];
+    uint16_t length = 0;
+    uint32_t badFrames = 0;
+    int byte;
+
+    if (argc > 3) {
+        fprintf(stderr, "usage: %s [capture [recorder.csv]]\n", argv[0]);
+        return 2;
+    }
+    if (argc >= 2 && (input = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (argc == 3) {
+        if ((recorder = fopen(argv[2], "w")) == NULL) {
+            perror(argv[2]);
+            return 1;
+        }
+        fprintf(recorder, "index,tick,adc_mean,alt_error,yaw_error,alt_p,alt_i,alt_d,yaw_p,yaw_i,yaw_d,"
+                "main_duty,tail_duty\n");
+    }
+
+    printf("sequence,state,altitude,altitude_target,yaw,yaw_target,main_duty,tail_duty,loop_jitter_us,uart_drops\n");
+
+    while ((byte = fgetc(input)) != EOF) {
+        if (byte == TELEMETRY_DELIMITER) {
+            handleChunk(chunk, length, recorder, &badFrames);
+            length = 0;
+        } else if (length < TELEMETRY_CHUNK_MAX_LENGTH) {
+            chunk[length++] = byte;
+        }
+    }
+    handleChunk(chunk, length, recorder, &badFrames);
+
+    if (badFrames > 0) {
+        fprintf(stderr, "%u bad frames skipped\n", badFrames);
+    }
+    if (recorder != NULL) {
+        fclose(recorder);
+    }
+    return (input != stdin) ? fclose(input) : 0;
+}
@@ -0,0 +1,193 @@
+// *******************************************************
+//
+//  telemetryDecoder.c
+//
+//  Host side decoder for the binary telemetry frames in IO/telemetry.h. Checks the CRC of the bytes between two
+//  delimiters and unpacks them into the structs the board sent them from. Used by the tools/telemetryDecode.c
+//  command line tool, and for linking into other host tools.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "telemetryDecoder.h"
+
+#define LOG_FORMAT_STRING(name, format) format,
+static const char* const logFormatStrings[] = {LOG_FORMATS(LOG_FORMAT_STRING)}; // indexed by the format ID
+
+
+/** Reads a 16 bit value little-endian
+@param buffer where to read it from
+@return the value */
+static uint16_t
+get16 (const uint8_t* buffer)
+{
+    return buffer[0] | ((uint16_t)buffer[1] << 8);
+}
+
+/** Reads a 32 bit value little-endian
+@param buffer where to read it from
+@return the value */
+static uint32_t
+get32 (const uint8_t* buffer)
+{
+    return get16(buffer) | ((uint32_t)get16(buffer + 2) << 16);
+}
+
+/** Returns the CRC16-CCITT of some bytes, the same as the board's
+@param data the bytes
+@param length the amount of bytes
+@return the CRC */
+uint16_t
+telemetryCrc16 (const uint8_t* data, uint16_t length)
+{
+    uint16_t crc = TELEMETRY_CRC_INIT;
+    uint16_t i;
+    uint8_t bit;
+
+    for (i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ TELEMETRY_CRC_POLYNOMIAL : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/** COBS decodes the bytes between two delimiters
+@param encoded the encoded bytes, without the delimiters
+@param length the amount of encoded bytes
+@param decoded where to write the decoded bytes, at least length bytes long
+@return the amount of decoded bytes, or -1 if the bytes aren't valid COBS */
+int32_t
+telemetryCobsDecode (const uint8_t* encoded, uint16_t length, uint8_t* decoded)
+{
+    uint16_t in = 0;
+    uint16_t out = 0;
+    uint8_t code;
+    uint8_t i;
+
+    while (in < length) {
+        code = encoded[in++];
+        if (code == 0 || in + code - 1 > length) {
+            return -1;
+        }
+        for (i = 1; i < code; i++) {
+            decoded[out++] = encoded[in++];
+        }
+        if (code != 0xFF && in < length) {
+            decoded[out++] = 0;
+        }
+    }
+    return out;
+}
+
+/** Decodes a status frame from the bytes between two delimiters
+@param encoded the encoded bytes, without the delimiters, at most TELEMETRY_CHUNK_MAX_LENGTH
+@param length the amount of encoded bytes
+@param frame the frame to write the values into
+@return true if the bytes were a status frame with a good CRC */
+bool
+telemetryDecodeStatus (const uint8_t* encoded, uint16_t length, telemetryStatusFrame_t* frame)
+{
+    uint8_t payload[TELEMETRY_CHUNK_MAX_LENGTH];
+    int32_t decodedLength = telemetryCobsDecode(encoded, length, payload);
+
+    if (decodedLength != TELEMETRY_STATUS_LENGTH + TELEMETRY_CRC_LENGTH
+            || payload[TELEMETRY_STATUS_TYPE] != TELEMETRY_FRAME_STATUS
+            || get16(&payload[TELEMETRY_STATUS_LENGTH]) != telemetryCrc16(payload, TELEMETRY_STATUS_LENGTH)) {
+        return false;
+    }
+
+    frame->sequence = get16(&payload[TELEMETRY_STATUS_SEQUENCE]);
+    frame->status.state = payload[TELEMETRY_STATUS_STATE];
+    frame->status.altitude = (int16_t)get16(&payload[TELEMETRY_STATUS_ALTITUDE]);
+    frame->status.altitudeTarget = (int16_t)get16(&payload[TELEMETRY_STATUS_ALTITUDE_TARGET]);
+    frame->status.yaw = (int16_t)get16(&payload[TELEMETRY_STATUS_YAW]);
+    frame->status.yawTarget = (int16_t)get16(&payload[TELEMETRY_STATUS_YAW_TARGET]);
+    frame->status.mainDuty = get16(&payload[TELEMETRY_STATUS_MAIN_DUTY]);
+    frame->status.tailDuty = get16(&payload[TELEMETRY_STATUS_TAIL_DUTY]);
+    frame->status.loopJitter = get16(&payload[TELEMETRY_STATUS_LOOP_JITTER]);
+    frame->status.uartDrops = get16(&payload[TELEMETRY_STATUS_UART_DROPS]);
+    return true;
+}
+
+/** Decodes a log frame from the bytes between two delimiters
+@param encoded the encoded bytes, without the delimiters, at most TELEMETRY_CHUNK_MAX_LENGTH
+@param length the amount of encoded bytes
+@param record the record to write the values into
+@return true if the bytes were a log frame with a good CRC */
+bool
+telemetryDecodeLog (const uint8_t* encoded, uint16_t length, logRecord_t* record)
+{
+    uint8_t payload[TELEMETRY_CHUNK_MAX_LENGTH];
+    int32_t decodedLength = telemetryCobsDecode(encoded, length, payload);
+    int32_t payloadLength = decodedLength - TELEMETRY_CRC_LENGTH;
+    uint8_t i;
+
+    if (payloadLength < TELEMETRY_LOG_ARGS
+            || payload[TELEMETRY_LOG_TYPE] != TELEMETRY_FRAME_LOG
+            || payload[TELEMETRY_LOG_ARG_COUNT] > LOG_MAX_ARGS
+            || payloadLength != TELEMETRY_LOG_ARGS + 4 * payload[TELEMETRY_LOG_ARG_COUNT]
+            || get16(&payload[payloadLength]) != telemetryCrc16(payload, payloadLength)) {
+        return false;
+    }
+
+    record->format = get16(&payload[TELEMETRY_LOG_FORMAT]);
+    record->timestamp = get32(&payload[TELEMETRY_LOG_TIMESTAMP]);
+    record->argCount = payload[TELEMETRY_LOG_ARG_COUNT];
+    for (i = 0; i < LOG_MAX_ARGS; i++) {
+        record->args[i] = (i < record->argCount) ? (int32_t)get32(&payload[TELEMETRY_LOG_ARGS + 4 * i]) : 0;
+    }
+    return true;
+}
+
+/** Decodes a flight recorder frame from the bytes between two delimiters
+@param encoded the encoded bytes, without the delimiters, at most TELEMETRY_CHUNK_MAX_LENGTH
+@param length the amount of encoded bytes
+@param frame the frame to write the values into
+@return true if the bytes were a flight recorder frame with a good CRC */
+bool
+telemetryDecodeRecord (const uint8_t* encoded, uint16_t length, telemetryRecordFrame_t* frame)
+{
+    uint8_t payload[TELEMETRY_CHUNK_MAX_LENGTH];
+    int32_t decodedLength = telemetryCobsDecode(encoded, length, payload);
+
+    if (decodedLength != TELEMETRY_RECORD_LENGTH + TELEMETRY_CRC_LENGTH
+            || payload[TELEMETRY_RECORD_TYPE] != TELEMETRY_FRAME_RECORD
+            || get16(&payload[TELEMETRY_RECORD_LENGTH]) != telemetryCrc16(payload, TELEMETRY_RECORD_LENGTH)) {
+        return false;
+    }
+
+    frame->index = get16(&payload[TELEMETRY_RECORD_INDEX]);
+    frame->record.tick = get16(&payload[TELEMETRY_RECORD_TICK]);
+    frame->record.adcMean = get16(&payload[TELEMETRY_RECORD_ADC_MEAN]);
+    frame->record.altError = (int16_t)get16(&payload[TELEMETRY_RECORD_ALT_ERROR]);
+    frame->record.yawError = (int16_t)get16(&payload[TELEMETRY_RECORD_YAW_ERROR]);
+    frame->record.altProportional = (int16_t)get16(&payload[TELEMETRY_RECORD_ALT_PROPORTIONAL]);
+    frame->record.altIntegral = (int16_t)get16(&payload[TELEMETRY_RECORD_ALT_INTEGRAL]);
+    frame->record.altDerivative = (int16_t)get16(&payload[TELEMETRY_RECORD_ALT_DERIVATIVE]);
+    frame->record.yawProportional = (int16_t)get16(&payload[TELEMETRY_RECORD_YAW_PROPORTIONAL]);
+    frame->record.yawIntegral = (int16_t)get16(&payload[TELEMETRY_RECORD_YAW_INTEGRAL]);
+    frame->record.yawDerivative = (int16_t)get16(&payload[TELEMETRY_RECORD_YAW_DERIVATIVE]);
+    frame->record.mainDuty = get16(&payload[TELEMETRY_RECORD_MAIN_DUTY]);
+    frame->record.tailDuty = get16(&payload[TELEMETRY_RECORD_TAIL_DUTY]);
+    return true;
+}
+
+/** Returns the format string of a log record, from the IO/logFormats.h table the decoder was built with
+@param format the record's format ID
+@return the format string, or NULL if the board is newer than the decoder */
+const char*
+telemetryLogFormat (uint16_t format)
+{
+    if (format >= LOG_FORMAT_COUNT) {
+        return NULL;
+    }
+    return logFormatStrings[format];
+}
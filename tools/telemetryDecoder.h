@@ -0,0 +1,80 @@
+// *******************************************************
+//
+//  telemetryDecoder.h
+//
+//  Host side decoder for the binary telemetry frames in IO/telemetry.h. Checks the CRC of the bytes between two
+//  delimiters and unpacks them into the structs the board sent them from. Used by the tools/telemetryDecode.c
+//  command line tool, and for linking into other host tools.
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#ifndef TOOLS_TELEMETRYDECODER_H_
+#define TOOLS_TELEMETRYDECODER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../IO/telemetry.h"
+
+#define TELEMETRY_CHUNK_MAX_LENGTH 512 // the longest run of bytes between delimiters decoded, frames are far shorter
+
+typedef struct {
+    uint16_t sequence; // the frame's sequence number
+    telemetryStatus_t status; // the values in the frame
+} telemetryStatusFrame_t; // a decoded status frame
+
+typedef struct {
+    uint16_t index; // the record counted from the oldest in the dump
+    flightRecord_t record; // the values in the frame
+} telemetryRecordFrame_t; // a decoded flight recorder frame
+
+
+/** Returns the CRC16-CCITT of some bytes, the same as the board's
+@param data the bytes
+@param length the amount of bytes
+@return the CRC */
+uint16_t
+telemetryCrc16 (const uint8_t* data, uint16_t length);
+
+/** COBS decodes the bytes between two delimiters
+@param encoded the encoded bytes, without the delimiters
+@param length the amount of encoded bytes
+@param decoded where to write the decoded bytes, at least length bytes long
+@return the amount of decoded bytes, or -1 if the bytes aren't valid COBS */
+int32_t
+telemetryCobsDecode (const uint8_t* encoded, uint16_t length, uint8_t* decoded);
+
+/** Decodes a status frame from the bytes between two delimiters
+@param encoded the encoded bytes, without the delimiters, at most TELEMETRY_CHUNK_MAX_LENGTH
+@param length the amount of encoded bytes
+@param frame the frame to write the values into
+@return true if the bytes were a status frame with a good CRC */
+bool
+telemetryDecodeStatus (const uint8_t* encoded, uint16_t length, telemetryStatusFrame_t* frame);
+
+/** Decodes a log frame from the bytes between two delimiters
+@param encoded the encoded bytes, without the delimiters, at most TELEMETRY_CHUNK_MAX_LENGTH
+@param length the amount of encoded bytes
+@param record the record to write the values into
+@return true if the bytes were a log frame with a good CRC */
+bool
+telemetryDecodeLog (const uint8_t* encoded, uint16_t length, logRecord_t* record);
+
+/** Decodes a flight recorder frame from the bytes between two delimiters
+@param encoded the encoded bytes, without the delimiters, at most TELEMETRY_CHUNK_MAX_LENGTH
+@param length the amount of encoded bytes
+@param frame the frame to write the values into
+@return true if the bytes were a flight recorder frame with a good CRC */
+bool
+telemetryDecodeRecord (const uint8_t* encoded, uint16_t length, telemetryRecordFrame_t* frame);
+
+/** Returns the format string of a log record, from the IO/logFormats.h table the decoder was built with
+@param format the record's format ID
+@return the format string, or NULL if the board is newer than the decoder */
+const char*
+telemetryLogFormat (uint16_t format);
+
+#endif /* TOOLS_TELEMETRYDECODER_H_ */
@@ -0,0 +1,199 @@
+// *******************************************************
+//
+//  telemetryTest.c
+//
+//  Host side round trip of the binary telemetry. Sends status, log and flight recorder frames with the board's own
+//  IO/telemetry.c, mixed with text lines, into a captured stream. Splits the stream at the delimiters the way
+//  tools/telemetryDecode.c does and checks tools/telemetryDecoder.c gives back every value that was sent, that the
+//  text comes through as text and that a frame with a corrupted byte is rejected. Exits non-zero if any check fails.
+//
+//  Build and run on the host, not the board:
+//      cc -o telemetryTest tools/telemetryTest.c tools/telemetryDecoder.c IO/telemetry.c
+//      ./telemetryTest
+//
+//  Authors Jackson Allred, Pieter Leigh, Dan Brock Ronen.
+//  Last modified:   06.20.1969
+//
+// *******************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "telemetryDecoder.h"
+#include "../IO/uart.h"
+
+#define STREAM_MAX_LENGTH 4096 // the captured stream, far more than the frames sent
+#define CORRUPT_OFFSET 5 // the byte flipped in the corrupted frame, counted from its leading delimiter
+
+enum sentTypes {SENT_STATUS = 0, SENT_LOG, SENT_RECORD, SENT_TEXT, SENT_CORRUPT}; // what went into the stream
+static const char* const sentNames[] = {"status", "log", "record", "text", "corrupt"}; // indexed by sentTypes
+
+typedef struct {
+    uint8_t type; // from sentTypes
+    telemetryStatus_t status; // the values sent, for the type sent
+    logRecord_t log;
+    uint16_t index;
+    flightRecord_t record;
+    const char* text;
+} sent_t; // one thing sent into the stream, in order
+
+static uint8_t stream[STREAM_MAX_LENGTH]; // everything the board queued on the Uart
+static uint16_t streamLength = 0;
+
+
+/** Captures the bytes the board queues on the Uart, in place of uart.c
+@param data the bytes to send
+@param length the amount of bytes */
+void
+UARTSendBytes (const uint8_t* data, uint16_t length)
+{
+    if (streamLength + length <= STREAM_MAX_LENGTH) {
+        memcpy(&stream[streamLength], data, length);
+        streamLength += length;
+    }
+}
+
+/** Sends one thing into the stream the way the board would
+@param sent what to send */
+static void
+send (const sent_t* sent)
+{
+    uint16_t start = streamLength;
+
+    switch (sent->type) {
+        case SENT_STATUS:
+            telemetrySendStatus(&sent->status);
+            break;
+        case SENT_LOG:
+            telemetrySendLog(&sent->log);
+            break;
+        case SENT_RECORD:
+            telemetrySendRecord(sent->index, &sent->record);
+            break;
+        case SENT_TEXT:
+            UARTSendBytes((const uint8_t*)sent->text, strlen(sent->text));
+            break;
+        case SENT_CORRUPT:
+            telemetrySendStatus(&sent->status);
+            stream[start + CORRUPT_OFFSET] ^= 0x10;
+            break;
+    }
+}
+
+/** Checks a chunk between two delimiters decodes to what was sent
+@param chunk the bytes
+@param length the amount of bytes
+@param sent what was sent
+@param sequence the status frame sequence number expected
+@return true if it decoded to the values sent */
+static bool
+checkChunk (const uint8_t* chunk, uint16_t length, const sent_t* sent, uint16_t sequence)
+{
+    telemetryStatusFrame_t statusFrame;
+    telemetryRecordFrame_t recordFrame;
+    logRecord_t log;
+    uint8_t i;
+
+    switch (sent->type) {
+        case SENT_STATUS:
+            return telemetryDecodeStatus(chunk, length, &statusFrame) && statusFrame.sequence == sequence
+                    && statusFrame.status.state == sent->status.state
+                    && statusFrame.status.altitude == sent->status.altitude
+                    && statusFrame.status.altitudeTarget == sent->status.altitudeTarget
+                    && statusFrame.status.yaw == sent->status.yaw
+                    && statusFrame.status.yawTarget == sent->status.yawTarget
+                    && statusFrame.status.mainDuty == sent->status.mainDuty
+                    && statusFrame.status.tailDuty == sent->status.tailDuty
+                    && statusFrame.status.loopJitter == sent->status.loopJitter
+                    && statusFrame.status.uartDrops == sent->status.uartDrops;
+        case SENT_LOG:
+            if (!telemetryDecodeLog(chunk, length, &log) || log.format != sent->log.format
+                    || log.timestamp != sent->log.timestamp || log.argCount != sent->log.argCount
+                    || telemetryLogFormat(log.format) == NULL) {
+                return false;
+            }
+            for (i = 0; i < LOG_MAX_ARGS; i++) {
+                if (log.args[i] != ((i < sent->log.argCount) ? sent->log.args[i] : 0)) {
+                    return false;
+                }
+            }
+            return true;
+        case SENT_RECORD:
+            return telemetryDecodeRecord(chunk, length, &recordFrame) && recordFrame.index == sent->index
+                    && memcmp(&recordFrame.record, &sent->record, sizeof(flightRecord_t)) == 0;
+        case SENT_TEXT:
+            return length == strlen(sent->text) && memcmp(chunk, sent->text, length) == 0;
+        case SENT_CORRUPT:
+            return !telemetryDecodeStatus(chunk, length, &statusFrame) && !telemetryDecodeLog(chunk, length, &log)
+                    && !telemetryDecodeRecord(chunk, length, &recordFrame);
+    }
+    return false;
+}
+
+int
+main (void)
+{
+    static const sent_t sent[] = {
+        {SENT_TEXT, .text = "Heli booting\r\n"},
+        {SENT_STATUS, .status = {3, 42, 50, -179, 180, 512, 0, 1999, 65535}},
+        {SENT_LOG, .log = {0x00000000, LOG_CLOCK, 1, {20000000}}},
+        {SENT_LOG, .log = {0x00FF0001, LOG_STATE, 2, {3, 4}}},
+        {SENT_LOG, .log = {0xFFFFFFFF, LOG_FORMAT_COUNT - 1, LOG_MAX_ARGS,
+                           {0, -1, 255, 256, INT32_MIN, INT32_MAX, 0x01000000, -65536}}},
+        {SENT_LOG, .log = {12345, LOG_STATE, 0, {0}}},
+        {SENT_TEXT, .text = "OK\r\n"},
+        {SENT_RECORD, .index = 767, .record = {65535, 4095, -32768, 32767, 1, -1, 0, 256, -256, 0x7F00, 1000, 0}},
+        {SENT_RECORD, .index = 0, .record = {0}},
+        {SENT_CORRUPT, .status = {1, 0, 0, 0, 0, 0, 0, 0, 0}},
+        {SENT_STATUS, .status = {0, 0, 0, 0, 0, 0, 0, 0, 0}},
+        {SENT_TEXT, .text = "Heli landed\r\n"},
+    };
+    const uint16_t sentCount = sizeof(sent) / sizeof(sent[0]);
+    uint16_t next = 0; // the next thing sent to match a chunk against
+    uint16_t sequence = 0; // the status sequence number the next status frame should carry
+    uint16_t chunkStart = 0;
+    uint16_t i;
+    uint16_t j;
+    uint8_t failures = 0;
+    bool passed;
+
+    for (i = 0; i < sentCount; i++) {
+        send(&sent[i]);
+    }
+
+    // Split at the delimiters like the decoder tool, the empty gaps between back to back frames are skipped
+    for (i = 0; i <= streamLength; i++) {
+        if (i < streamLength && stream[i] != TELEMETRY_DELIMITER) {
+            continue;
+        }
+        if (i > chunkStart) {
+            if (next >= sentCount) {
+                printf("extra chunk at byte %u FAIL\n", chunkStart);
+                failures++;
+            } else {
+                passed = checkChunk(&stream[chunkStart], i - chunkStart, &sent[next], sequence);
+                printf("%2u %-8s %3u bytes %s\n", next, sentNames[sent[next].type], i - chunkStart,
+                       passed ? "ok" : "FAIL");
+                if (!passed) {
+                    failures++;
+                }
+                if (sent[next].type == SENT_STATUS || sent[next].type == SENT_CORRUPT) {
+                    sequence++;
+                }
+                next++;
+            }
+        }
+        chunkStart = i + 1;
+    }
+
+    // A chunk that went missing shows up as the rest of the stream being checked against the wrong thing
+    for (j = next; j < sentCount; j++) {
+        printf("%2u never decoded FAIL\n", j);
+        failures++;
+    }
+
+    printf("%u of %u checks failed\n", failures, sentCount);
+    return (failures == 0) ? 0 : 1;
+}